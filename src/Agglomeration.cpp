@@ -0,0 +1,125 @@
+
+//@HEADER
+// ***************************************************
+//
+// HPCG: High Performance Conjugate Gradient Benchmark
+//
+// Contact:
+// Michael A. Heroux ( maherou@sandia.gov)
+// Jack Dongarra     (dongarra@eecs.utk.edu)
+// Piotr Luszczek    (luszczek@eecs.utk.edu)
+//
+// ***************************************************
+//@HEADER
+
+/*!
+ @file Agglomeration.cpp
+
+ HPCG routines for coarse levels agglomerated onto fewer processes
+ */
+
+#ifndef HPCG_NO_MPI
+#include <mpi.h>
+#endif
+
+#include "Agglomeration.hpp"
+
+#ifndef HPCG_NO_MPI
+static const int agglomerationTag = 97; //!< tag of the share messages, distinct from the halo exchange
+#endif
+
+/*!
+  Returns the buffer for the share of this process with numberOfVectors values per coarse row, interleaved by row.
+  The buffer grows when a block of vectors wider than the previous ones is transferred.
+
+  @param[inout] agglomeration the agglomeration data of the coarse level
+  @param[in]    numberOfVectors number of vectors per row
+
+  @return the start of the share of this process
+*/
+double * GetAgglomerationShare(Agglomeration & agglomeration, int numberOfVectors) {
+  if (numberOfVectors>agglomeration.bufferVectors) {
+    int numberOfShares = agglomeration.numberOfMembers>0 ? agglomeration.numberOfMembers : 1;
+    delete [] agglomeration.buffer;
+    agglomeration.buffer = new double[numberOfShares*agglomeration.shareLength*numberOfVectors];
+    agglomeration.bufferVectors = numberOfVectors;
+  }
+  return agglomeration.buffer;
+}
+
+/*!
+  Collects the shares of the coarse residual that the processes of the block have restricted into their buffers
+  (see GetAgglomerationShare) in the coarse residual of the root.
+
+  @param[inout] agglomeration the agglomeration data of the coarse level, with the share of this process in its buffer
+  @param[in]    geom the geometry of the fine level
+  @param[out]   rc on the root, the coarse residual with numberOfVectors values per row (unused on the other processes)
+  @param[in]    numberOfVectors number of vectors per row
+
+  @return returns 0 upon success and non-zero otherwise
+*/
+int GatherAgglomeratedResidual(Agglomeration & agglomeration, const Geometry & geom, double * rc, int numberOfVectors) {
+
+  const local_int_t shareLength = agglomeration.shareLength;
+  const local_int_t shareSize = shareLength*numberOfVectors;
+  double * const buffer = GetAgglomerationShare(agglomeration, numberOfVectors);
+#ifndef HPCG_NO_MPI
+  if (agglomeration.numberOfMembers==0) {
+    MPI_Send(buffer, shareSize, MPI_DOUBLE, agglomeration.rootRank, agglomerationTag, geom.comm);
+    return 0;
+  }
+  for (int m=1; m<agglomeration.numberOfMembers; ++m)
+    MPI_Irecv(buffer+m*shareSize, shareSize, MPI_DOUBLE, agglomeration.memberRanks[m], agglomerationTag, geom.comm, agglomeration.requests+m);
+  MPI_Waitall(agglomeration.numberOfMembers-1, agglomeration.requests+1, MPI_STATUSES_IGNORE);
+#else
+  (void) geom;
+#endif
+
+  for (int m=0; m<agglomeration.numberOfMembers; ++m) {
+    const local_int_t * const rows = agglomeration.memberRows+m*shareLength;
+    const double * const share = buffer+m*shareSize;
+    for (local_int_t j=0; j<shareLength; ++j)
+      for (int l=0; l<numberOfVectors; ++l) rc[rows[j]*numberOfVectors+l] = share[j*numberOfVectors+l];
+  }
+  return 0;
+}
+
+/*!
+  Hands the coarse correction of the root back to the processes of the block: on return the buffer of every
+  process (see GetAgglomerationShare) holds the correction of its share of the coarse rows.
+
+  @param[inout] agglomeration the agglomeration data of the coarse level
+  @param[in]    geom the geometry of the fine level
+  @param[in]    xc on the root, the coarse correction with numberOfVectors values per row (unused on the other processes)
+  @param[in]    numberOfVectors number of vectors per row
+
+  @return returns 0 upon success and non-zero otherwise
+*/
+int ScatterAgglomeratedCorrection(Agglomeration & agglomeration, const Geometry & geom, const double * xc, int numberOfVectors) {
+
+  const local_int_t shareLength = agglomeration.shareLength;
+  const local_int_t shareSize = shareLength*numberOfVectors;
+  double * const buffer = GetAgglomerationShare(agglomeration, numberOfVectors);
+#ifndef HPCG_NO_MPI
+  if (agglomeration.numberOfMembers==0) {
+    MPI_Recv(buffer, shareSize, MPI_DOUBLE, agglomeration.rootRank, agglomerationTag, geom.comm, MPI_STATUS_IGNORE);
+    return 0;
+  }
+#else
+  (void) geom;
+#endif
+
+  for (int m=0; m<agglomeration.numberOfMembers; ++m) {
+    const local_int_t * const rows = agglomeration.memberRows+m*shareLength;
+    double * const share = buffer+m*shareSize;
+    for (local_int_t j=0; j<shareLength; ++j)
+      for (int l=0; l<numberOfVectors; ++l) share[j*numberOfVectors+l] = xc[rows[j]*numberOfVectors+l];
+#ifndef HPCG_NO_MPI
+    if (m>0) MPI_Isend(share, shareSize, MPI_DOUBLE, agglomeration.memberRanks[m], agglomerationTag, geom.comm, agglomeration.requests+m);
+#endif
+  }
+#ifndef HPCG_NO_MPI
+  MPI_Waitall(agglomeration.numberOfMembers-1, agglomeration.requests+1, MPI_STATUSES_IGNORE);
+#endif
+  return 0;
+}
@@ -0,0 +1,69 @@
+
+//@HEADER
+// ***************************************************
+//
+// HPCG: High Performance Conjugate Gradient Benchmark
+//
+// Contact:
+// Michael A. Heroux ( maherou@sandia.gov)
+// Jack Dongarra     (dongarra@eecs.utk.edu)
+// Piotr Luszczek    (luszczek@eecs.utk.edu)
+//
+// ***************************************************
+//@HEADER
+
+/*!
+ @file Agglomeration.hpp
+
+ HPCG data structure for coarse levels agglomerated onto fewer processes
+ */
+
+#ifndef AGGLOMERATION_HPP
+#define AGGLOMERATION_HPP
+
+#ifndef HPCG_NO_MPI
+#include <mpi.h>
+#endif
+#include "Geometry.hpp"
+
+/*!
+  Describes how the coarse rows computed by the processes of a block of the fine process grid are collected on
+  one process of the block, the root, which owns all of them on the coarse level (see GenerateCoarseProblem).  Every
+  process of the block restricts its fine rows into its share of the coarse level as if there was no agglomeration;
+  the shares are then gathered on the root and, after the coarse solve, the root scatters the correction back.
+  The other processes of the block own no rows on the coarse level and on all coarser levels.
+*/
+struct Agglomeration_STRUCT {
+  local_int_t shareLength; //!< number of coarse rows that each process of the block computes (its share)
+  int rootRank; //!< rank of the process that owns the coarse rows of the block
+  int numberOfMembers; //!< on the root: number of processes of the block, the root first (0 on the other processes)
+  int * memberRanks; //!< on the root: ranks of the processes of the block
+  local_int_t * memberRows; //!< on the root: coarse row of entry j of the share of member m, at m*shareLength+j
+  double * buffer; //!< the share of this process first, followed on the root by the shares of the other members
+  int bufferVectors; //!< number of vectors per row that the buffer can hold
+#ifndef HPCG_NO_MPI
+  MPI_Request * requests; //!< one request per member
+#endif
+};
+typedef struct Agglomeration_STRUCT Agglomeration;
+
+double * GetAgglomerationShare(Agglomeration & agglomeration, int numberOfVectors);
+int GatherAgglomeratedResidual(Agglomeration & agglomeration, const Geometry & geom, double * rc, int numberOfVectors);
+int ScatterAgglomeratedCorrection(Agglomeration & agglomeration, const Geometry & geom, const double * xc, int numberOfVectors);
+
+/*!
+ Deallocates the agglomeration data of a coarse level.
+
+ @param[inout] agglomeration the data structure whose storage is deallocated
+ */
+inline void DeleteAgglomeration(Agglomeration & agglomeration) {
+  delete [] agglomeration.memberRanks;
+  delete [] agglomeration.memberRows;
+  delete [] agglomeration.buffer;
+#ifndef HPCG_NO_MPI
+  delete [] agglomeration.requests;
+#endif
+  return;
+}
+
+#endif // AGGLOMERATION_HPP
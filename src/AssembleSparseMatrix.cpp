@@ -0,0 +1,139 @@
+
+//@HEADER
+// ***************************************************
+//
+// HPCG: High Performance Conjugate Gradient Benchmark
+//
+// Contact:
+// Michael A. Heroux ( maherou@sandia.gov)
+// Jack Dongarra     (dongarra@eecs.utk.edu)
+// Piotr Luszczek    (luszczek@eecs.utk.edu)
+//
+// ***************************************************
+//@HEADER
+
+/*!
+ @file AssembleSparseMatrix.cpp
+
+ HPCG routine
+ */
+
+#ifndef HPCG_NO_MPI
+#include <mpi.h>
+#endif
+
+#ifndef HPCG_NO_OPENMP
+#include <omp.h>
+#endif
+
+#include <cassert>
+#include <limits>
+
+#include "AssembleSparseMatrix.hpp"
+
+/*!
+  Fills the matrix data structure with rows given in compressed sparse row form, using global column indices.
+  This is the counterpart of GenerateProblem for matrices that are not generated from the 27-point stencil:
+  problems read from a file and their aggregation-based coarse levels.
+
+  The rows are the ones assigned to this process by A.geom->rowOffsets (see GenerateRowGeometry).  Local column
+  indices are set by the subsequent call to SetupHalo, which requires a structurally symmetric matrix.
+
+  @param[inout] A             The matrix; A.geom must be set up, all other members are defined on exit
+  @param[in]    rowStart      Offsets of the rows into columnIndices and values (length localNumberOfRows+1)
+  @param[in]    columnIndices Global column index of every nonzero
+  @param[in]    values        Value of every nonzero
+
+  @return Returns zero on success.  Returns 1 if a row has more nonzeros than nonzerosInRow can hold and 2 if a row has
+  no diagonal entry.  The error is agreed on by all processes, and the matrix is left untouched in that case.
+
+  @see GenerateRowGeometry
+*/
+int AssembleSparseMatrix(SparseMatrix & A, const std::vector< local_int_t > & rowStart,
+    const std::vector< global_int_t > & columnIndices, const std::vector< double > & values) {
+
+  local_int_t localNumberOfRows = rowStart.size()-1;
+  assert(localNumberOfRows>=0); // rowStart holds at least the end of the last row; also bounds the allocations below
+  global_int_t rowOffset = A.geom->rowOffsets[A.geom->rank];
+  assert(rowOffset+localNumberOfRows==A.geom->rowOffsets[A.geom->rank+1]);
+
+  // Check rows before allocating anything so that all processes can back out together
+  int ierr = 0;
+  const local_int_t maxNonzerosInRow = std::numeric_limits<char>::max();
+  for (local_int_t i=0; i< localNumberOfRows && ierr==0; ++i) {
+    if (rowStart[i+1]-rowStart[i] > maxNonzerosInRow) ierr = 1;
+    bool hasDiagonal = false;
+    for (local_int_t j=rowStart[i]; j<rowStart[i+1]; ++j)
+      if (columnIndices[j]==rowOffset+i) hasDiagonal = true;
+    if (!hasDiagonal && ierr==0) ierr = 2;
+  }
+#ifndef HPCG_NO_MPI
+  int localErr = ierr;
+  MPI_Allreduce(&localErr, &ierr, 1, MPI_INT, MPI_MAX, A.geom->comm);
+#endif
+  if (ierr) return ierr;
+
+  local_int_t localNumberOfNonzeros = rowStart[localNumberOfRows];
+  char * nonzerosInRow = new char[localNumberOfRows];
+  global_int_t ** mtxIndG = new global_int_t*[localNumberOfRows];
+  local_int_t  ** mtxIndL = new local_int_t*[localNumberOfRows];
+  double ** matrixValues = new double*[localNumberOfRows];
+  double ** matrixDiagonal = new double*[localNumberOfRows];
+
+#ifndef HPCG_CONTIGUOUS_ARRAYS
+  for (local_int_t i=0; i< localNumberOfRows; ++i) {
+    local_int_t numberOfNonzerosInRow = rowStart[i+1]-rowStart[i];
+    mtxIndL[i] = new local_int_t[numberOfNonzerosInRow];
+    matrixValues[i] = new double[numberOfNonzerosInRow];
+    mtxIndG[i] = new global_int_t[numberOfNonzerosInRow];
+  }
+#else
+  mtxIndL[0] = new local_int_t[localNumberOfNonzeros];
+  matrixValues[0] = new double[localNumberOfNonzeros];
+  mtxIndG[0] = new global_int_t[localNumberOfNonzeros];
+  for (local_int_t i=1; i< localNumberOfRows; ++i) {
+    mtxIndL[i] = mtxIndL[0] + rowStart[i];
+    matrixValues[i] = matrixValues[0] + rowStart[i];
+    mtxIndG[i] = mtxIndG[0] + rowStart[i];
+  }
+#endif
+
+  A.localToGlobalMap.resize(localNumberOfRows);
+#ifndef HPCG_NO_OPENMP
+  #pragma omp parallel for
+#endif
+  for (local_int_t i=0; i< localNumberOfRows; ++i) {
+    global_int_t currentGlobalRow = rowOffset+i;
+    nonzerosInRow[i] = (char) (rowStart[i+1]-rowStart[i]);
+    for (local_int_t j=rowStart[i]; j<rowStart[i+1]; ++j) {
+      local_int_t k = j-rowStart[i];
+      mtxIndG[i][k] = columnIndices[j];
+      matrixValues[i][k] = values[j];
+      if (columnIndices[j]==currentGlobalRow) matrixDiagonal[i] = matrixValues[i]+k;
+    }
+    A.localToGlobalMap[i] = currentGlobalRow;
+  }
+  for (local_int_t i=0; i< localNumberOfRows; ++i) A.globalToLocalMap[rowOffset+i] = i;
+
+  global_int_t totalNumberOfNonzeros = 0;
+#ifndef HPCG_NO_MPI
+  long long lnnz = localNumberOfNonzeros, gnnz = 0; // convert to 64 bit for MPI call
+  MPI_Allreduce(&lnnz, &gnnz, 1, MPI_LONG_LONG_INT, MPI_SUM, A.geom->comm);
+  totalNumberOfNonzeros = gnnz;
+#else
+  totalNumberOfNonzeros = localNumberOfNonzeros;
+#endif
+
+  A.totalNumberOfRows = A.geom->rowOffsets[A.geom->size];
+  A.totalNumberOfNonzeros = totalNumberOfNonzeros;
+  A.localNumberOfRows = localNumberOfRows;
+  A.localNumberOfColumns = localNumberOfRows;
+  A.localNumberOfNonzeros = localNumberOfNonzeros;
+  A.nonzerosInRow = nonzerosInRow;
+  A.mtxIndG = mtxIndG;
+  A.mtxIndL = mtxIndL;
+  A.matrixValues = matrixValues;
+  A.matrixDiagonal = matrixDiagonal;
+
+  return 0;
+}
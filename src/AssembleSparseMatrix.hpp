@@ -0,0 +1,23 @@
+
+//@HEADER
+// ***************************************************
+//
+// HPCG: High Performance Conjugate Gradient Benchmark
+//
+// Contact:
+// Michael A. Heroux ( maherou@sandia.gov)
+// Jack Dongarra     (dongarra@eecs.utk.edu)
+// Piotr Luszczek    (luszczek@eecs.utk.edu)
+//
+// ***************************************************
+//@HEADER
+
+#ifndef ASSEMBLESPARSEMATRIX_HPP
+#define ASSEMBLESPARSEMATRIX_HPP
+#include <vector>
+#include "SparseMatrix.hpp"
+
+int AssembleSparseMatrix(SparseMatrix & A, const std::vector< local_int_t > & rowStart,
+    const std::vector< global_int_t > & columnIndices, const std::vector< double > & values);
+
+#endif // ASSEMBLESPARSEMATRIX_HPP
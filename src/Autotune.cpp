@@ -0,0 +1,241 @@
+
+//@HEADER
+// ***************************************************
+//
+// HPCG: High Performance Conjugate Gradient Benchmark
+//
+// Contact:
+// Michael A. Heroux ( maherou@sandia.gov)
+// Jack Dongarra     (dongarra@eecs.utk.edu)
+// Piotr Luszczek    (luszczek@eecs.utk.edu)
+//
+// ***************************************************
+//@HEADER
+
+
+/*!
+ @file Autotune.cpp
+
+ HPCG routine
+ */
+
+#ifndef HPCG_NO_MPI
+#include <mpi.h>
+#endif
+
+#ifndef HPCG_NO_OPENMP
+#include <omp.h>
+#endif
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <vector>
+#include "Autotune.hpp"
+#include "Solver.hpp"
+#include "OptimizeProblem.hpp"
+#include "ReportResults.hpp"
+#include "Vector.hpp"
+#include "mytimer.hpp"
+
+/*!
+  One candidate configuration of the autotuner.
+*/
+struct AutotuneCandidate {
+  local_int_t nx; //!< local grid points in x
+  local_int_t ny; //!< local grid points in y
+  local_int_t nz; //!< local grid points in z
+  int numThreads; //!< OpenMP threads of every process
+};
+
+static bool CompareCandidateVolume(const AutotuneCandidate & a, const AutotuneCandidate & b) {
+  return ((double) a.nx)*a.ny*a.nz < ((double) b.nx)*b.ny*b.nz;
+}
+
+/*!
+  Returns the memory budget of this process in bytes: the value of --mem (in MB) or, by default, half of
+  the physical memory of the node divided by the number of processes on the node.
+*/
+static double AutotuneMemoryCap(const HPCG_Params & params) {
+  if (params.memoryCap>0) return ((double) params.memoryCap)*1024.0*1024.0;
+
+  double physicalMemory = 0.0;
+#if defined(_SC_PHYS_PAGES) && defined(_SC_PAGE_SIZE)
+  long pages = sysconf(_SC_PHYS_PAGES);
+  long pageSize = sysconf(_SC_PAGE_SIZE);
+  if (pages>0 && pageSize>0) physicalMemory = ((double) pages)*((double) pageSize);
+#endif
+  if (physicalMemory<=0.0) physicalMemory = 4.0*1024.0*1024.0*1024.0; // Conservative guess if the system does not say
+
+  int nodeSize = 1;
+#ifndef HPCG_NO_MPI
+  MPI_Comm nodeComm;
+  MPI_Comm_split_type(params.comm, MPI_COMM_TYPE_SHARED, params.comm_rank, MPI_INFO_NULL, &nodeComm);
+  MPI_Comm_size(nodeComm, &nodeSize);
+  MPI_Comm_free(&nodeComm);
+#endif
+  return 0.5*physicalMemory/nodeSize;
+}
+
+/*!
+  Sets up, optimizes and times one candidate with a short CG set of a fixed number of iterations.
+
+  @param[in]  params the run parameters with the candidate's local grid dimensions
+  @param[out] bytesPerProcess the memory of the problem data of this process predicted by the ReportResults model
+  @param[out] gflops the GFLOP/s rate of the CG set from the ReportResults FLOP model, using the slowest process
+
+  @return Returns zero on success and a non-zero value otherwise.
+*/
+static int TimeCandidate(const HPCG_Params & params, double & bytesPerProcess, double & gflops) {
+
+  const int numberOfIterations = 10; // Enough for all kernels to show up, short enough for a wide sweep
+
+  Solver solver;
+  int ierr = solver.Setup(params);
+  if (ierr) return ierr;
+  ierr = solver.Optimize();
+  if (ierr) return ierr;
+
+  const SparseMatrix & A = solver.GetMatrix();
+  int numberOfMgLevels = solver.GetNumberOfMgLevels();
+  std::vector<double> fnbytesPerLevel(numberOfMgLevels);
+  double fnbytes = ComputeMemoryUseModel(A, numberOfMgLevels, 1.0, fnbytesPerLevel) + OptimizeProblemMemoryUse(A);
+  bytesPerProcess = fnbytes/params.comm_size;
+
+  Vector x;
+  InitializeVector(x, A.localNumberOfColumns);
+  int niters = 0;
+  double normr = 0.0, normr0 = 0.0;
+  ZeroVector(x);
+  ierr = solver.Solve(solver.GetRhs(), x, 1, 0.0, niters, normr, normr0); // Warm-up: first touch, caches, halo buffers
+  ZeroVector(x);
+#ifndef HPCG_NO_MPI
+  MPI_Barrier(params.comm);
+#endif
+  double t0 = mytimer();
+  if (!ierr) ierr = solver.Solve(solver.GetRhs(), x, numberOfIterations, 0.0, niters, normr, normr0);
+  double time = mytimer() - t0;
+#ifndef HPCG_NO_MPI
+  MPI_Allreduce(MPI_IN_PLACE, &time, 1, MPI_DOUBLE, MPI_MAX, params.comm);
+#endif
+  DeleteVector(x);
+
+  double fnops_ddot, fnops_waxpby, fnops_sparsemv, fnops_precond;
+  ComputeFlopModel(A, numberOfMgLevels, niters, 1.0, A.mgData!=0 ? A.mgData->cycle : MG_V_CYCLE, fnops_ddot, fnops_waxpby, fnops_sparsemv, fnops_precond);
+  gflops = (fnops_ddot+fnops_waxpby+fnops_sparsemv+fnops_precond)/time/1.0E9;
+  return ierr;
+}
+
+/*!
+  Searches for the local grid dimensions and the number of OpenMP threads that give the highest GFLOP/s rate
+  within the memory budget of each process.
+
+  The candidate local grids have dimensions that are multiples of 8 (so that GenerateCoarseProblem can build
+  all 4 multigrid levels) and are cubes or have aspect ratios of 2, well within the CheckAspectRatio limit.
+  Each is set up, optimized and timed with a short CG set of 10 iterations. Candidates whose memory, extrapolated
+  from the bytes per equation of the ReportResults memory model, exceeds the budget are skipped.  The thread
+  counts are then swept for the best grid.  The results are logged, the best configuration is written to
+  hpcg_tuned.dat in the format of hpcg.dat and stored in params (and in the OpenMP runtime).
+
+  @param[inout] params the run parameters; nx, ny, nz and numThreads are replaced by the best configuration
+
+  @return Returns zero on success and a non-zero value otherwise.
+
+  @see ComputeMemoryUseModel
+  @see ComputeFlopModel
+*/
+int Autotune(HPCG_Params & params) {
+
+  bool doIo = params.comm_rank==0;
+  if (params.matrixFile[0]!='\0') {
+    if (doIo) HPCG_fout << "Autotuning skipped: the problem is read from " << params.matrixFile << std::endl;
+    return 0;
+  }
+
+  double memoryCap = AutotuneMemoryCap(params);
+#ifndef HPCG_NO_MPI
+  MPI_Allreduce(MPI_IN_PLACE, &memoryCap, 1, MPI_DOUBLE, MPI_MIN, params.comm); // All processes use the same grid
+#endif
+  if (doIo) HPCG_fout << "Autotuning with a memory budget of " << memoryCap/1024.0/1024.0 << " MB per process" << std::endl;
+
+  // Cubes and boxes with an aspect ratio of 2, smallest first
+  const int sizes[] = {16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 192, 224, 256, 288, 320, 384, 448, 512, 640, 768};
+  const int numberOfSizes = sizeof(sizes)/sizeof(sizes[0]);
+  std::vector<AutotuneCandidate> candidates;
+  for (int i=0; i<numberOfSizes; ++i) {
+    local_int_t s = sizes[i];
+    AutotuneCandidate cube = {s, s, s, params.numThreads};
+    AutotuneCandidate slab = {2*s, 2*s, s, params.numThreads};
+    AutotuneCandidate bar = {2*s, s, s, params.numThreads};
+    candidates.push_back(cube);
+    candidates.push_back(slab);
+    candidates.push_back(bar);
+  }
+  std::stable_sort(candidates.begin(), candidates.end(), CompareCandidateVolume);
+
+  HPCG_Params candidateParams = params;
+  AutotuneCandidate best = {params.nx, params.ny, params.nz, params.numThreads};
+  double bestGflops = 0.0;
+  double bytesPerEquation = 0.0; // Measured on the first candidate, used to skip the ones that would not fit
+  for (size_t i=0; i<candidates.size(); ++i) {
+    const AutotuneCandidate & c = candidates[i];
+    double fnrow = ((double) c.nx)*c.ny*c.nz;
+    if (bytesPerEquation>0.0 && bytesPerEquation*fnrow>memoryCap) break; // Sorted by volume, all others are larger
+    double ratio = std::min(std::min(c.nx, c.ny), c.nz) / double(std::max(std::max(c.nx, c.ny), c.nz));
+    if (ratio<0.125 || c.nx%8!=0 || c.ny%8!=0 || c.nz%8!=0) continue;
+
+    candidateParams.nx = c.nx;
+    candidateParams.ny = c.ny;
+    candidateParams.nz = c.nz;
+    double bytesPerProcess = 0.0, gflops = 0.0;
+    int ierr = TimeCandidate(candidateParams, bytesPerProcess, gflops);
+    if (ierr) return ierr;
+    bytesPerEquation = bytesPerProcess/fnrow;
+    bool fits = bytesPerProcess<=memoryCap;
+    if (doIo) HPCG_fout << "Autotune candidate " << c.nx << "x" << c.ny << "x" << c.nz << " with " << c.numThreads
+        << " threads: " << gflops << " GFLOP/s, " << bytesPerProcess/1024.0/1024.0 << " MB per process"
+        << (fits ? "" : " (over budget)") << std::endl;
+    if (fits && gflops>bestGflops) {
+      bestGflops = gflops;
+      best = c;
+    }
+  }
+
+#ifndef HPCG_NO_OPENMP
+  // Thread sweep for the best grid over the powers of two below the number the run was started with
+  candidateParams.nx = best.nx;
+  candidateParams.ny = best.ny;
+  candidateParams.nz = best.nz;
+  for (int numThreads=1; numThreads<params.numThreads; numThreads *= 2) {
+    omp_set_num_threads(numThreads);
+    candidateParams.numThreads = numThreads;
+    double bytesPerProcess = 0.0, gflops = 0.0;
+    int ierr = TimeCandidate(candidateParams, bytesPerProcess, gflops);
+    if (ierr) return ierr;
+    if (doIo) HPCG_fout << "Autotune candidate " << best.nx << "x" << best.ny << "x" << best.nz << " with " << numThreads
+        << " threads: " << gflops << " GFLOP/s" << std::endl;
+    if (gflops>bestGflops) {
+      bestGflops = gflops;
+      best.numThreads = numThreads;
+    }
+  }
+  omp_set_num_threads(best.numThreads);
+#endif
+
+  params.nx = best.nx;
+  params.ny = best.ny;
+  params.nz = best.nz;
+  params.numThreads = best.numThreads;
+
+  if (doIo) {
+    HPCG_fout << "Autotuned configuration: " << best.nx << "x" << best.ny << "x" << best.nz << " with " << best.numThreads
+        << " threads, " << bestGflops << " GFLOP/s" << std::endl;
+    std::ofstream tuned("hpcg_tuned.dat");
+    tuned << "HPCG benchmark input file" << std::endl;
+    tuned << "Autotuned for " << params.comm_size << " processes, run with OMP_NUM_THREADS=" << best.numThreads << std::endl;
+    tuned << best.nx << " " << best.ny << " " << best.nz << std::endl;
+    tuned << params.runningTime << std::endl;
+  }
+  return 0;
+}
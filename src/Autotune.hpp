@@ -0,0 +1,28 @@
+
+//@HEADER
+// ***************************************************
+//
+// HPCG: High Performance Conjugate Gradient Benchmark
+//
+// Contact:
+// Michael A. Heroux ( maherou@sandia.gov)
+// Jack Dongarra     (dongarra@eecs.utk.edu)
+// Piotr Luszczek    (luszczek@eecs.utk.edu)
+//
+// ***************************************************
+//@HEADER
+
+
+/*!
+ @file Autotune.hpp
+
+ HPCG routine
+ */
+
+#ifndef AUTOTUNE_HPP
+#define AUTOTUNE_HPP
+#include "hpcg.hpp"
+
+int Autotune(HPCG_Params & params);
+
+#endif // AUTOTUNE_HPP
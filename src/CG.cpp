@@ -26,16 +26,97 @@
 
 #include "CG.hpp"
 #include "mytimer.hpp"
+#include "Trace.hpp"
 #include "ComputeSPMV.hpp"
 #include "ComputeMG.hpp"
 #include "ComputeDotProduct.hpp"
 #include "ComputeWAXPBY.hpp"
+#include "PersistentRegion.hpp"
 
 
 // Use TICK and TOCK to time a code section in MATLAB-like fashion
 #define TICK()  t0 = mytimer() //!< record current time in 't0'
 #define TOCK(t) t += mytimer() - t0 //!< store time difference in 't' using time in 't0'
 
+/*!
+  Performs the iterations of CG, starting from the initial residual in data.r.
+
+  Inside the persistent region (HPCG_PERSISTENT_REGION) all threads of the region call this routine with
+  private arguments; the kernels share the work and give the same scalar results on every thread.
+
+  @param[in]    A    The known system matrix
+  @param[inout] data The data structure with all necessary CG vectors preallocated, data.r holds the initial residual
+  @param[inout] x    On entry: the initial guess; on exit: the new approximate solution
+  @param[in]    max_iter  The maximum number of iterations to perform, even if tolerance is not met.
+  @param[in]    tolerance The stopping criterion to assert convergence: if norm of residual is <= to tolerance.
+  @param[in]    doPreconditioning The flag to indicate whether the preconditioner should be invoked at each iteration.
+  @param[inout] niters    The number of iterations actually performed (unchanged if there are none).
+  @param[inout] normr     On entry: the 2-norm of the initial residual; on exit: the 2-norm of the residual after the last iteration.
+  @param[in]    normr0    The 2-norm of the residual vector before the first iteration.
+  @param[inout] times     The timing information, accumulated as in CG (indices 1 to 5).
+*/
+static void CGIterations(const SparseMatrix & A, CGData & data, Vector & x, const int max_iter, const double tolerance,
+    bool doPreconditioning, int & niters, double & normr, const double normr0, double * times) {
+
+  double rtz = 0.0, oldrtz = 0.0, alpha = 0.0, beta = 0.0, pAp = 0.0;
+  double t0 = 0.0, t1 = 0.0, t2 = 0.0, t3 = 0.0, t4 = 0.0, t5 = 0.0;
+  local_int_t nrow = A.localNumberOfRows;
+  Vector & r = data.r; // Residual vector
+  Vector & z = data.z; // Preconditioned residual vector
+  Vector & p = data.p; // Direction vector (in MPI mode ncol>=nrow)
+  Vector & Ap = data.Ap;
+#ifdef HPCG_DEBUG
+  int print_freq = 1;
+  if (print_freq>50) print_freq=50;
+  if (print_freq<1)  print_freq=1;
+#endif
+
+  for (int k=1; k<=max_iter && normr/normr0 > tolerance; k++ ) {
+    double traceIteration = TraceBegin();
+    TICK();
+    if (doPreconditioning)
+      ComputeMG(A, r, z); // Apply preconditioner
+    else
+      CopyVector (r, z); // copy r to z (no preconditioning)
+    TOCK(t5); // Preconditioner apply time
+
+    if (k == 1) {
+      TICK(); ComputeWAXPBY(nrow, 1.0, z, 0.0, z, p, A.isWaxpbyOptimized); TOCK(t2); // Copy Mr to p
+      TICK(); ComputeDotProduct(*A.geom, nrow, r, z, rtz, t4, A.isDotProductOptimized); TOCK(t1); // rtz = r'*z
+    } else {
+      oldrtz = rtz;
+      TICK(); ComputeDotProduct(*A.geom, nrow, r, z, rtz, t4, A.isDotProductOptimized); TOCK(t1); // rtz = r'*z
+      beta = rtz/oldrtz;
+      TICK(); ComputeWAXPBY (nrow, 1.0, z, beta, p, p, A.isWaxpbyOptimized);  TOCK(t2); // p = beta*p + z
+    }
+
+    TICK(); ComputeSPMV(A, p, Ap); TOCK(t3); // Ap = A*p
+    TICK(); ComputeDotProduct(*A.geom, nrow, p, Ap, pAp, t4, A.isDotProductOptimized); TOCK(t1); // alpha = p'*Ap
+    alpha = rtz/pAp;
+    TICK(); ComputeWAXPBY(nrow, 1.0, x, alpha, p, x, A.isWaxpbyOptimized);// x = x + alpha*p
+            ComputeWAXPBY(nrow, 1.0, r, -alpha, Ap, r, A.isWaxpbyOptimized);  TOCK(t2);// r = r - alpha*Ap
+    TICK(); ComputeDotProduct(*A.geom, nrow, r, r, normr, t4, A.isDotProductOptimized); TOCK(t1);
+    normr = sqrt(normr);
+#ifdef HPCG_DEBUG
+#ifndef HPCG_NO_OPENMP
+    #pragma omp master
+#endif
+    if (A.geom->rank==0 && (k%print_freq == 0 || k == max_iter))
+      HPCG_fout << "Iteration = "<< k << "   Scaled Residual = "<< normr/normr0 << std::endl;
+#endif
+    niters = k;
+    TraceEnd("CG iteration", traceIteration);
+  }
+
+
+  times[1] += t1; // dot-product time
+  times[2] += t2; // WAXPBY time
+  times[3] += t3; // SPMV time
+  times[4] += t4; // AllReduce time
+  times[5] += t5; // preconditioner apply time
+  return;
+}
+
 /*!
   Routine to compute an approximate solution to Ax = b
 
@@ -62,7 +143,6 @@ int CG(const SparseMatrix & A, CGData & data, const Vector & b, Vector & x,
 
   double t_begin = mytimer();  // Start timing right away
   normr = 0.0;
-  double rtz = 0.0, oldrtz = 0.0, alpha = 0.0, beta = 0.0, pAp = 0.0;
 
 
   double t0 = 0.0, t1 = 0.0, t2 = 0.0, t3 = 0.0, t4 = 0.0, t5 = 0.0;
@@ -71,22 +151,16 @@ int CG(const SparseMatrix & A, CGData & data, const Vector & b, Vector & x,
 //#endif
   local_int_t nrow = A.localNumberOfRows;
   Vector & r = data.r; // Residual vector
-  Vector & z = data.z; // Preconditioned residual vector
   Vector & p = data.p; // Direction vector (in MPI mode ncol>=nrow)
   Vector & Ap = data.Ap;
 
   if (!doPreconditioning && A.geom->rank==0) HPCG_fout << "WARNING: PERFORMING UNPRECONDITIONED ITERATIONS" << std::endl;
 
-#ifdef HPCG_DEBUG
-  int print_freq = 1;
-  if (print_freq>50) print_freq=50;
-  if (print_freq<1)  print_freq=1;
-#endif
   // p is of length ncols, copy x to p for sparse MV operation
   CopyVector(x, p);
   TICK(); ComputeSPMV(A, p, Ap); TOCK(t3); // Ap = A*p
   TICK(); ComputeWAXPBY(nrow, 1.0, b, -1.0, Ap, r, A.isWaxpbyOptimized);  TOCK(t2); // r = b - Ax (x stored in p)
-  TICK(); ComputeDotProduct(nrow, r, r, normr, t4, A.isDotProductOptimized); TOCK(t1);
+  TICK(); ComputeDotProduct(*A.geom, nrow, r, r, normr, t4, A.isDotProductOptimized); TOCK(t1);
   normr = sqrt(normr);
 #ifdef HPCG_DEBUG
   if (A.geom->rank==0) HPCG_fout << "Initial Residual = "<< normr << std::endl;
@@ -95,39 +169,26 @@ int CG(const SparseMatrix & A, CGData & data, const Vector & b, Vector & x,
   // Record initial residual for convergence testing
   normr0 = normr;
 
-  // Start iterations
-
-  for (int k=1; k<=max_iter && normr/normr0 > tolerance; k++ ) {
-    TICK();
-    if (doPreconditioning)
-      ComputeMG(A, r, z); // Apply preconditioner
-    else
-      CopyVector (r, z); // copy r to z (no preconditioning)
-    TOCK(t5); // Preconditioner apply time
-
-    if (k == 1) {
-      TICK(); ComputeWAXPBY(nrow, 1.0, z, 0.0, z, p, A.isWaxpbyOptimized); TOCK(t2); // Copy Mr to p
-      TICK(); ComputeDotProduct (nrow, r, z, rtz, t4, A.isDotProductOptimized); TOCK(t1); // rtz = r'*z
-    } else {
-      oldrtz = rtz;
-      TICK(); ComputeDotProduct (nrow, r, z, rtz, t4, A.isDotProductOptimized); TOCK(t1); // rtz = r'*z
-      beta = rtz/oldrtz;
-      TICK(); ComputeWAXPBY (nrow, 1.0, z, beta, p, p, A.isWaxpbyOptimized);  TOCK(t2); // p = beta*p + z
+#ifdef HPCG_PERSISTENT_REGION
+  // All iterations run in one parallel region: every thread follows the iterations with private copies of the
+  // scalars, which the kernels keep identical on all threads, and the master thread reports them.
+  #pragma omp parallel
+  {
+    int threadNiters = niters;
+    double threadNormr = normr, threadTimes[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    BeginPersistentRegion();
+    CGIterations(A, data, x, max_iter, tolerance, doPreconditioning, threadNiters, threadNormr, normr0, threadTimes);
+    EndPersistentRegion();
+    #pragma omp master
+    {
+      niters = threadNiters;
+      normr = threadNormr;
+      for (int i=1; i<6; ++i) times[i] += threadTimes[i];
     }
-
-    TICK(); ComputeSPMV(A, p, Ap); TOCK(t3); // Ap = A*p
-    TICK(); ComputeDotProduct(nrow, p, Ap, pAp, t4, A.isDotProductOptimized); TOCK(t1); // alpha = p'*Ap
-    alpha = rtz/pAp;
-    TICK(); ComputeWAXPBY(nrow, 1.0, x, alpha, p, x, A.isWaxpbyOptimized);// x = x + alpha*p
-            ComputeWAXPBY(nrow, 1.0, r, -alpha, Ap, r, A.isWaxpbyOptimized);  TOCK(t2);// r = r - alpha*Ap
-    TICK(); ComputeDotProduct(nrow, r, r, normr, t4, A.isDotProductOptimized); TOCK(t1);
-    normr = sqrt(normr);
-#ifdef HPCG_DEBUG
-    if (A.geom->rank==0 && (k%print_freq == 0 || k == max_iter))
-      HPCG_fout << "Iteration = "<< k << "   Scaled Residual = "<< normr/normr0 << std::endl;
-#endif
-    niters = k;
   }
+#else
+  CGIterations(A, data, x, max_iter, tolerance, doPreconditioning, niters, normr, normr0, times);
+#endif
 
   // Store times
   times[1] += t1; // dot-product time
@@ -0,0 +1,146 @@
+
+//@HEADER
+// ***************************************************
+//
+// HPCG: High Performance Conjugate Gradient Benchmark
+//
+// Contact:
+// Michael A. Heroux ( maherou@sandia.gov)
+// Jack Dongarra     (dongarra@eecs.utk.edu)
+// Piotr Luszczek    (luszczek@eecs.utk.edu)
+//
+// ***************************************************
+//@HEADER
+
+/*!
+ @file CGMulti.cpp
+
+ HPCG routine
+ */
+
+#include <fstream>
+
+#include <cmath>
+#include <vector>
+
+#include "hpcg.hpp"
+
+#include "CGMulti.hpp"
+#include "mytimer.hpp"
+#include "ComputeSPMVMulti.hpp"
+#include "ComputeMGMulti.hpp"
+#include "ComputeDotProductMulti.hpp"
+#include "ComputeWAXPBYMulti.hpp"
+
+
+// Use TICK and TOCK to time a code section in MATLAB-like fashion
+#define TICK()  t0 = mytimer() //!< record current time in 't0'
+#define TOCK(t) t += mytimer() - t0 //!< store time difference in 't' using time in 't0'
+
+/*!
+  Routine to compute approximate solutions to A*x_j = b_j for a block of right hand sides.
+
+  Each vector of the block follows its own CG recurrence, exactly as in CG, but the matrix, the
+  preconditioner and the vector updates are applied to the whole block at once, so that every pass
+  over the matrix serves all right hand sides, and the dot products of all vectors are combined in a
+  single reduction.  Iterations continue until every vector has converged; converged vectors are
+  left unchanged from then on.
+
+  @param[inout] A    The known system matrix
+  @param[inout] data The data structure with all necessary block CG vectors preallocated
+  @param[in]    b    The known block of right hand sides
+  @param[inout] x    On entry: the initial guesses; on exit: the new approximate solutions
+  @param[in]    max_iter  The maximum number of iterations to perform, even if tolerance is not met.
+  @param[in]    tolerance The stopping criterion to assert convergence: if norm of residual is <= to tolerance.
+  @param[out]   niters    The number of iterations actually performed.
+  @param[out]   normr     The 2-norms of the residual vectors after the last iteration (numberOfVectors values).
+  @param[out]   normr0    The 2-norms of the residual vectors before the first iteration (numberOfVectors values).
+  @param[out]   times     The 7-element vector of the timing information accumulated during all of the iterations.
+  @param[in]    doPreconditioning The flag to indicate whether the preconditioner should be invoked at each iteration.
+
+  @return Returns zero on success and a non-zero value otherwise.
+
+  @see CG()
+*/
+int CGMulti(const SparseMatrix & A, CGMultiData & data, const MultiVector & b, MultiVector & x,
+    const int max_iter, const double tolerance, int & niters, double * normr, double * normr0,
+    double * times, bool doPreconditioning) {
+
+  double t_begin = mytimer();  // Start timing right away
+  const int k = b.numberOfVectors;
+  std::vector< double > rtz(k, 0.0), oldrtz(k, 0.0), pAp(k, 0.0), alpha(k, 0.0), beta(k, 0.0);
+  std::vector< double > ones(k, 1.0), minusOnes(k, -1.0), minusAlpha(k, 0.0);
+  std::vector< bool > active(k, true);
+
+  double t0 = 0.0, t1 = 0.0, t2 = 0.0, t3 = 0.0, t4 = 0.0, t5 = 0.0;
+  local_int_t nrow = A.localNumberOfRows;
+  MultiVector & r = data.r; // Residual vectors
+  MultiVector & z = data.z; // Preconditioned residual vectors
+  MultiVector & p = data.p; // Direction vectors (in MPI mode ncol>=nrow)
+  MultiVector & Ap = data.Ap;
+
+  if (!doPreconditioning && A.geom->rank==0) HPCG_fout << "WARNING: PERFORMING UNPRECONDITIONED ITERATIONS" << std::endl;
+
+  // p is of length ncols, copy x to p for sparse MV operation
+  CopyMultiVector(x, p);
+  TICK(); ComputeSPMVMulti(A, p, Ap); TOCK(t3); // Ap = A*p
+  TICK(); ComputeWAXPBYMulti(nrow, &ones[0], b, &minusOnes[0], Ap, r);  TOCK(t2); // r = b - Ax (x stored in p)
+  TICK(); ComputeDotProductMulti(*A.geom, nrow, r, r, normr, t4); TOCK(t1);
+  bool isConverged = true;
+  for (int l=0; l<k; ++l) {
+    normr[l] = sqrt(normr[l]);
+    normr0[l] = normr[l]; // Record initial residual for convergence testing
+    active[l] = normr[l] > 0.0;
+    if (active[l]) isConverged = false;
+  }
+  niters = 0;
+
+  // Start iterations
+
+  for (int iter=1; iter<=max_iter && !isConverged; iter++ ) {
+    TICK();
+    if (doPreconditioning)
+      ComputeMGMulti(A, r, z, data); // Apply preconditioner
+    else
+      CopyMultiVector(r, z); // copy r to z (no preconditioning)
+    TOCK(t5); // Preconditioner apply time
+
+    for (int l=0; l<k; ++l) oldrtz[l] = rtz[l];
+    TICK(); ComputeDotProductMulti(*A.geom, nrow, r, z, &rtz[0], t4); TOCK(t1); // rtz = r'*z
+    for (int l=0; l<k; ++l) beta[l] = (iter>1 && active[l]) ? rtz[l]/oldrtz[l] : 0.0;
+    TICK(); ComputeWAXPBYMulti(nrow, &ones[0], z, &beta[0], p, p);  TOCK(t2); // p = beta*p + z
+
+    TICK(); ComputeSPMVMulti(A, p, Ap); TOCK(t3); // Ap = A*p
+    TICK(); ComputeDotProductMulti(*A.geom, nrow, p, Ap, &pAp[0], t4); TOCK(t1); // alpha = p'*Ap
+    for (int l=0; l<k; ++l) {
+      alpha[l] = active[l] ? rtz[l]/pAp[l] : 0.0; // Converged vectors are not updated any more
+      minusAlpha[l] = -alpha[l];
+    }
+    TICK(); ComputeWAXPBYMulti(nrow, &ones[0], x, &alpha[0], p, x);// x = x + alpha*p
+            ComputeWAXPBYMulti(nrow, &ones[0], r, &minusAlpha[0], Ap, r);  TOCK(t2);// r = r - alpha*Ap
+    TICK(); ComputeDotProductMulti(*A.geom, nrow, r, r, normr, t4); TOCK(t1);
+    isConverged = true;
+    for (int l=0; l<k; ++l) {
+      normr[l] = sqrt(normr[l]);
+      if (active[l] && normr[l]/normr0[l] <= tolerance) active[l] = false;
+      if (active[l]) isConverged = false;
+    }
+#ifdef HPCG_DEBUG
+    if (A.geom->rank==0) {
+      double worst = 0.0;
+      for (int l=0; l<k; ++l) if (normr0[l]>0.0 && normr[l]/normr0[l]>worst) worst = normr[l]/normr0[l];
+      HPCG_fout << "Iteration = "<< iter << "   Largest Scaled Residual = "<< worst << std::endl;
+    }
+#endif
+    niters = iter;
+  }
+
+  // Store times
+  times[1] += t1; // dot-product time
+  times[2] += t2; // WAXPBY time
+  times[3] += t3; // SPMV time
+  times[4] += t4; // AllReduce time
+  times[5] += t5; // preconditioner apply time
+  times[0] += mytimer() - t_begin;  // Total time. All done...
+  return 0;
+}
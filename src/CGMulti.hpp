@@ -0,0 +1,25 @@
+
+//@HEADER
+// ***************************************************
+//
+// HPCG: High Performance Conjugate Gradient Benchmark
+//
+// Contact:
+// Michael A. Heroux ( maherou@sandia.gov)
+// Jack Dongarra     (dongarra@eecs.utk.edu)
+// Piotr Luszczek    (luszczek@eecs.utk.edu)
+//
+// ***************************************************
+//@HEADER
+
+#ifndef CGMULTI_HPP
+#define CGMULTI_HPP
+#include "SparseMatrix.hpp"
+#include "MultiVector.hpp"
+#include "CGMultiData.hpp"
+
+int CGMulti(const SparseMatrix & A, CGMultiData & data, const MultiVector & b, MultiVector & x,
+    const int max_iter, const double tolerance, int & niters, double * normr, double * normr0,
+    double * times, bool doPreconditioning);
+
+#endif // CGMULTI_HPP
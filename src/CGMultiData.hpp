@@ -0,0 +1,94 @@
+
+//@HEADER
+// ***************************************************
+//
+// HPCG: High Performance Conjugate Gradient Benchmark
+//
+// Contact:
+// Michael A. Heroux ( maherou@sandia.gov)
+// Jack Dongarra     (dongarra@eecs.utk.edu)
+// Piotr Luszczek    (luszczek@eecs.utk.edu)
+//
+// ***************************************************
+//@HEADER
+
+/*!
+ @file CGMultiData.hpp
+
+ HPCG data structure
+ */
+
+#ifndef CGMULTIDATA_HPP
+#define CGMULTIDATA_HPP
+
+#include <vector>
+#include "SparseMatrix.hpp"
+#include "MultiVector.hpp"
+
+struct CGMultiData_STRUCT {
+  MultiVector r; //!< block of residual vectors
+  MultiVector z; //!< block of preconditioned residual vectors
+  MultiVector p; //!< block of direction vectors
+  MultiVector Ap; //!< block of Krylov vectors
+  std::vector< MultiVector > Axf; //!< fine grid residual blocks for the multigrid levels (one per coarse grid)
+  std::vector< MultiVector > rc; //!< coarse grid residual blocks
+  std::vector< MultiVector > xc; //!< coarse grid solution blocks
+};
+typedef struct CGMultiData_STRUCT CGMultiData;
+
+/*!
+ Constructor for the data structure of block CG vectors, including the blocks used on the coarse grids by ComputeMGMulti.
+
+ @param[in]  A    the data structure that describes the problem matrix and its structure
+ @param[in]  numberOfVectors the number of right hand sides solved for together
+ @param[out] data the data structure for block CG vectors that will be allocated to get it ready for use in CGMulti
+ */
+inline void InitializeCGMultiData(SparseMatrix & A, int numberOfVectors, CGMultiData & data) {
+  local_int_t nrow = A.localNumberOfRows;
+  local_int_t ncol = A.localNumberOfColumns;
+  InitializeMultiVector(data.r, nrow, numberOfVectors);
+  InitializeMultiVector(data.z, ncol, numberOfVectors);
+  InitializeMultiVector(data.p, ncol, numberOfVectors);
+#ifndef HPCG_NO_MPI
+  InitializeMultiVectorSendBuffer(data.z, A.totalToBeSent);
+  InitializeMultiVectorSendBuffer(data.p, A.totalToBeSent);
+#endif
+  InitializeMultiVector(data.Ap, nrow, numberOfVectors);
+  for (const SparseMatrix * Af = &A; Af->mgData!=0; Af = Af->Ac) {
+    data.Axf.push_back(MultiVector());
+    data.rc.push_back(MultiVector());
+    data.xc.push_back(MultiVector());
+    InitializeMultiVector(data.Axf.back(), Af->localNumberOfColumns, numberOfVectors);
+    InitializeMultiVector(data.rc.back(), Af->Ac->localNumberOfRows, numberOfVectors);
+    InitializeMultiVector(data.xc.back(), Af->Ac->localNumberOfColumns, numberOfVectors);
+#ifndef HPCG_NO_MPI
+    InitializeMultiVectorSendBuffer(data.Axf.back(), Af->totalToBeSent);
+    InitializeMultiVectorSendBuffer(data.xc.back(), Af->Ac->totalToBeSent);
+#endif
+  }
+  return;
+}
+
+/*!
+ Destructor for the block CG vectors data.
+
+ @param[inout] data the block CG vectors data structure whose storage is deallocated
+ */
+inline void DeleteCGMultiData(CGMultiData & data) {
+
+  DeleteMultiVector(data.r);
+  DeleteMultiVector(data.z);
+  DeleteMultiVector(data.p);
+  DeleteMultiVector(data.Ap);
+  for (size_t i=0; i<data.Axf.size(); ++i) {
+    DeleteMultiVector(data.Axf[i]);
+    DeleteMultiVector(data.rc[i]);
+    DeleteMultiVector(data.xc[i]);
+  }
+  data.Axf.clear();
+  data.rc.clear();
+  data.xc.clear();
+  return;
+}
+
+#endif // CGMULTIDATA_HPP
@@ -0,0 +1,75 @@
+
+//@HEADER
+// ***************************************************
+//
+// HPCG: High Performance Conjugate Gradient Benchmark
+//
+// Contact:
+// Michael A. Heroux ( maherou@sandia.gov)
+// Jack Dongarra     (dongarra@eecs.utk.edu)
+// Piotr Luszczek    (luszczek@eecs.utk.edu)
+//
+// ***************************************************
+//@HEADER
+
+/*!
+ @file CoarseCholesky.hpp
+
+ HPCG data structure for the replicated direct solve of the coarsest multigrid level
+ */
+
+#ifndef COARSECHOLESKY_HPP
+#define COARSECHOLESKY_HPP
+
+#ifdef HPCG_REPLICATED_COARSE_SOLVE
+// The coarsest level has at least 2x2x2 rows, a bare -DHPCG_REPLICATED_COARSE_SOLVE (1) would never apply
+#if HPCG_REPLICATED_COARSE_SOLVE < 8
+#error "HPCG_REPLICATED_COARSE_SOLVE=<n> needs the largest number of coarsest-level rows to solve exactly (at least 8)"
+#endif
+#ifndef HPCG_NO_MPI
+#include <mpi.h>
+#endif
+#include "Geometry.hpp"
+
+/*!
+  The Cholesky factor L of the whole coarsest-level matrix in band storage, held by every process that owns rows of
+  the level.  Row i of the factor keeps the entries L(i,i-bandwidth) to L(i,i) at factor[i*(bandwidth+1)], with the
+  unknowns in global row order.  A solve gathers the right hand side of all processes, runs the two triangular solves
+  locally and keeps the rows of this process.  Processes that own no rows of an agglomerated coarsest level only
+  keep numberOfRows and bandwidth, the other members are 0 (and comm is MPI_COMM_NULL).
+*/
+struct CoarseCholesky_STRUCT {
+  global_int_t numberOfRows; //!< rows of the global coarsest-level system
+  global_int_t bandwidth; //!< largest distance of a nonzero from the diagonal
+  double * factor; //!< the band of L, numberOfRows*(bandwidth+1) entries
+  double * values; //!< right hand side and solution in global row order (numberOfRows entries)
+  double * gathered; //!< right hand side in the order of the processes (numberOfRows entries)
+  global_int_t * gatheredRows; //!< global row of each entry of gathered
+  int * counts; //!< rows of each process of comm
+  int * displacements; //!< start of the rows of each process of comm in gathered
+#ifndef HPCG_NO_MPI
+  MPI_Comm comm; //!< the processes that own rows of the coarsest level
+#endif
+};
+typedef struct CoarseCholesky_STRUCT CoarseCholesky;
+
+/*!
+  Deallocates the factor and the work arrays of the coarsest-level solve.
+
+  @param[inout] cholesky the data structure whose storage is deallocated
+ */
+inline void DeleteCoarseCholesky(CoarseCholesky & cholesky) {
+  delete [] cholesky.factor;
+  delete [] cholesky.values;
+  delete [] cholesky.gathered;
+  delete [] cholesky.gatheredRows;
+  delete [] cholesky.counts;
+  delete [] cholesky.displacements;
+#ifndef HPCG_NO_MPI
+  if (cholesky.comm!=MPI_COMM_NULL) MPI_Comm_free(&cholesky.comm);
+#endif
+  return;
+}
+#endif // HPCG_REPLICATED_COARSE_SOLVE
+
+#endif // COARSECHOLESKY_HPP
@@ -18,8 +18,60 @@
  HPCG routine
  */
 
+#ifdef HPCG_NODE_ALLREDUCE
+#ifndef HPCG_NO_OPENMP
+#include <omp.h>
+#endif
+#include <cassert>
+#include "NodeAllreduce.hpp"
+#endif
+#if defined(HPCG_PERSISTENT_REGION) && !defined(HPCG_NO_MPI) && !defined(HPCG_NODE_ALLREDUCE)
+#include <mpi.h>
+#endif
 #include "ComputeDotProduct.hpp"
 #include "ComputeDotProduct_ref.hpp"
+#include "PerfCounters.hpp"
+#include "PersistentRegion.hpp"
+#include "Trace.hpp"
+
+#ifdef HPCG_PERSISTENT_REGION
+/*!
+  Dot product for the threads of the persistent region of CG: each thread sums its part of an orphaned
+  worksharing loop, the parts are added in thread order and the master thread performs the sum over the
+  processes.  All threads return the result.
+*/
+static int ComputeDotProductInRegion(const Geometry & geom, const local_int_t n, const Vector & x, const Vector & y,
+    double & result, double & time_allreduce) {
+
+  const double * const xv = x.values;
+  const double * const yv = y.values;
+  double thread_result = 0.0;
+  #pragma omp for schedule(static) nowait
+  for (local_int_t i=0; i<n; i++) thread_result += xv[i]*yv[i];
+  double local_result = PersistentRegionSum(thread_result);
+
+#if !defined(HPCG_NO_MPI) || defined(HPCG_NODE_ALLREDUCE)
+  double global_result = 0.0;
+  #pragma omp master
+  {
+    double t0 = mytimer();
+#ifdef HPCG_NODE_ALLREDUCE
+    NodeAllreduceSum(geom, &local_result, &global_result, 1);
+#else
+    MPI_Allreduce(&local_result, &global_result, 1, MPI_DOUBLE, MPI_SUM, geom.comm);
+#endif
+    time_allreduce += mytimer() - t0;
+    TraceEnd("MPI_Allreduce", t0);
+  }
+  result = PersistentRegionBroadcast(global_result);
+#else
+  (void) geom;
+  (void) time_allreduce;
+  result = local_result;
+#endif
+  return 0;
+}
+#endif
 
 /*!
   Routine to compute the dot product of two vectors.
@@ -28,6 +80,7 @@
   can be replaced by a custom routine that is optimized and better suited for
   the target system.
 
+  @param[in]  geom the geometry of the processes the vectors are distributed over
   @param[in]  n the number of vector elements (on this processor)
   @param[in]  x, y the input vectors
   @param[out] result a pointer to scalar value, on exit will contain the result.
@@ -38,10 +91,43 @@
 
   @see ComputeDotProduct_ref
 */
-int ComputeDotProduct(const local_int_t n, const Vector & x, const Vector & y,
+int ComputeDotProduct(const Geometry & geom, const local_int_t n, const Vector & x, const Vector & y,
     double & result, double & time_allreduce, bool & isOptimized) {
 
+  HPCG_PERF_START(PERF_DOT);
+  double traceBegin = TraceBegin();
+#ifdef HPCG_PERSISTENT_REGION
+  if (InPersistentRegion()) {
+    int ierr = ComputeDotProductInRegion(geom, n, x, y, result, time_allreduce);
+    TraceEnd("DDOT", traceBegin);
+    HPCG_PERF_STOP(PERF_DOT);
+    return ierr;
+  }
+#endif
+#ifdef HPCG_NODE_ALLREDUCE
+  // Local sums as in ComputeDotProduct_ref, the sum over processes goes through shared memory within each node
+  assert(x.localLength>=n);
+  assert(y.localLength>=n);
+  double local_result = 0.0;
+  double * xv = x.values;
+  double * yv = y.values;
+#ifndef HPCG_NO_OPENMP
+  #pragma omp parallel for reduction (+:local_result)
+#endif
+  for (local_int_t i=0; i<n; i++) local_result += xv[i]*yv[i];
+
+  double t0 = mytimer();
+  NodeAllreduceSum(geom, &local_result, &result, 1);
+  time_allreduce += mytimer() - t0;
+  TraceEnd("Node allreduce", t0);
+  int ierr = 0;
+  (void) isOptimized; // Not the reference version
+#else
   // This line and the next two lines should be removed and your version of ComputeDotProduct should be used.
   isOptimized = false;
-  return ComputeDotProduct_ref(n, x, y, result, time_allreduce);
+  int ierr = ComputeDotProduct_ref(geom, n, x, y, result, time_allreduce);
+#endif
+  TraceEnd("DDOT", traceBegin);
+  HPCG_PERF_STOP(PERF_DOT);
+  return ierr;
 }
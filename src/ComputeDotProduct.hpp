@@ -15,7 +15,7 @@
 #ifndef COMPUTEDOTPRODUCT_HPP
 #define COMPUTEDOTPRODUCT_HPP
 #include "Vector.hpp"
-int ComputeDotProduct(const local_int_t n, const Vector & x, const Vector & y,
+int ComputeDotProduct(const Geometry & geom, const local_int_t n, const Vector & x, const Vector & y,
     double & result, double & time_allreduce, bool & isOptimized);
 
 #endif // COMPUTEDOTPRODUCT_HPP
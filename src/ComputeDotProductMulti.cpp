@@ -0,0 +1,86 @@
+
+//@HEADER
+// ***************************************************
+//
+// HPCG: High Performance Conjugate Gradient Benchmark
+//
+// Contact:
+// Michael A. Heroux ( maherou@sandia.gov)
+// Jack Dongarra     (dongarra@eecs.utk.edu)
+// Piotr Luszczek    (luszczek@eecs.utk.edu)
+//
+// ***************************************************
+//@HEADER
+
+/*!
+ @file ComputeDotProductMulti.cpp
+
+ HPCG routine
+ */
+
+#ifndef HPCG_NO_MPI
+#include <mpi.h>
+#include "mytimer.hpp"
+#endif
+#ifndef HPCG_NO_OPENMP
+#include <omp.h>
+#endif
+#include <cassert>
+#include <vector>
+#include "ComputeDotProductMulti.hpp"
+#include "NodeAllreduce.hpp"
+
+/*!
+  Routine to compute the dot products of corresponding vectors of two blocks.  The partial sums of
+  all vectors are combined across processes with a single reduction of numberOfVectors values.
+
+  @param[in] geom the geometry of the processes the vectors are distributed over
+  @param[in] n the number of vector elements (on this processor)
+  @param[in] x, y the input blocks of vectors
+  @param[out] result array of numberOfVectors values, on exit result[j] contains the dot product of the j-th vectors.
+  @param[out] time_allreduce the time it took to perform the communication between processes
+
+  @return returns 0 upon success and non-zero otherwise
+
+  @see ComputeDotProduct
+*/
+int ComputeDotProductMulti(const Geometry & geom, const local_int_t n, const MultiVector & x, const MultiVector & y,
+    double * result, double & time_allreduce) {
+  assert(x.localLength>=n); // Test vector lengths
+  assert(y.localLength>=n);
+  assert(x.numberOfVectors==y.numberOfVectors);
+
+  const int k = x.numberOfVectors;
+  const double * const xv = x.values;
+  const double * const yv = y.values;
+  std::vector< double > local_result(k, 0.0);
+
+#ifndef HPCG_NO_OPENMP
+  #pragma omp parallel
+#endif
+  {
+    std::vector< double > thread_result(k, 0.0);
+#ifndef HPCG_NO_OPENMP
+    #pragma omp for
+#endif
+    for (local_int_t i=0; i<n; i++)
+      for (int l=0; l<k; l++) thread_result[l] += xv[i*k+l]*yv[i*k+l];
+#ifndef HPCG_NO_OPENMP
+    #pragma omp critical
+#endif
+    for (int l=0; l<k; l++) local_result[l] += thread_result[l];
+  }
+
+#ifndef HPCG_NO_MPI
+  // One reduction for all vectors of the block
+  double t0 = mytimer();
+  NodeAllreduceSum(geom, &local_result[0], result, k);
+  time_allreduce += mytimer() - t0;
+#else
+  (void) geom;
+  time_allreduce += 0.0;
+  for (int l=0; l<k; l++) result[l] = local_result[l];
+#endif
+
+  return 0;
+}
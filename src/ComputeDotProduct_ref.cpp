@@ -21,6 +21,7 @@
 #ifndef HPCG_NO_MPI
 #include <mpi.h>
 #include "mytimer.hpp"
+#include "Trace.hpp"
 #endif
 #ifndef HPCG_NO_OPENMP
 #include <omp.h>
@@ -34,6 +35,7 @@
   This is the reference dot-product implementation.  It _CANNOT_ be modified for the
   purposes of this benchmark.
 
+  @param[in] geom the geometry of the processes the vectors are distributed over
   @param[in] n the number of vector elements (on this processor)
   @param[in] x, y the input vectors
   @param[in] result a pointer to scalar value, on exit will contain result.
@@ -43,7 +45,7 @@
 
   @see ComputeDotProduct
 */
-int ComputeDotProduct_ref(const local_int_t n, const Vector & x, const Vector & y,
+int ComputeDotProduct_ref(const Geometry & geom, const local_int_t n, const Vector & x, const Vector & y,
     double & result, double & time_allreduce) {
   assert(x.localLength>=n); // Test vector lengths
   assert(y.localLength>=n);
@@ -68,10 +70,12 @@ int ComputeDotProduct_ref(const local_int_t n, const Vector & x, const Vector &
   double t0 = mytimer();
   double global_result = 0.0;
   MPI_Allreduce(&local_result, &global_result, 1, MPI_DOUBLE, MPI_SUM,
-      MPI_COMM_WORLD);
+      geom.comm);
   result = global_result;
   time_allreduce += mytimer() - t0;
+  TraceEnd("MPI_Allreduce", t0);
 #else
+  (void) geom;
   time_allreduce += 0.0;
   result = local_result;
 #endif
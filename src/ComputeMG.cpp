@@ -19,20 +19,405 @@
  */
 
 #include "ComputeMG.hpp"
-#include "ComputeMG_ref.hpp"
+#include "ComputeSYMGS.hpp"
+#include "ComputeSPMV.hpp"
+#include "ComputeRestriction_ref.hpp"
+#include "ComputeProlongation_ref.hpp"
+#include "ExchangeHalo.hpp"
+#include "PersistentRegion.hpp"
+#include "Trace.hpp"
+#include "mytimer.hpp"
+#include <algorithm>
+#include <cassert>
+#ifndef HPCG_NO_MPI
+#include <mpi.h>
+#endif
+#ifndef HPCG_NO_OPENMP
+#include <omp.h>
+#endif
+
+// Use TICK and TOCK to time a code section in MATLAB-like fashion
+#define TICK()  t0 = mytimer() //!< record current time in 't0'
+#define TOCK(t) t += mytimer() - t0 //!< store time difference in 't' using time in 't0'
+
+#ifdef HPCG_PERSISTENT_REGION
+/*!
+  ComputeRestriction_ref, or the full-weighting restriction, for the threads of the persistent region of CG, as
+  orphaned worksharing loops.
+*/
+static int ComputeRestrictionInRegion(const SparseMatrix & A, const Vector & rf) {
+
+  if (A.mgData->fullWeighting!=0) { // The residual is formed in Axf and completed in the halo
+    const FullWeighting & fullWeighting = *A.mgData->fullWeighting;
+    double * const residual = A.mgData->Axf->values;
+    const double * const rv = rf.values;
+    double * const rcv = A.mgData->rc->values;
+    const local_int_t nf = A.localNumberOfRows;
+    const local_int_t nc = A.mgData->rc->localLength;
+    #pragma omp for schedule(static)
+    for (local_int_t i=0; i<nf; ++i) residual[i] = rv[i] - residual[i];
+#ifndef HPCG_NO_MPI
+    #pragma omp master
+    ExchangeHalo(A, *A.mgData->Axf);
+    #pragma omp barrier
+#endif
+    #pragma omp for schedule(static)
+    for (local_int_t i=0; i<nc; ++i) {
+      double sum = 0.0;
+      for (local_int_t j=fullWeighting.restrictionRowStart[i]; j<fullWeighting.restrictionRowStart[i+1]; ++j)
+        sum += fullWeighting.restrictionWeights[j]*residual[fullWeighting.restrictionColumns[j]];
+      rcv[i] = sum;
+    }
+    return 0;
+  }
+
+  const double * const Axfv = A.mgData->Axf->values;
+  const double * const rfv = rf.values;
+  Agglomeration * const agglomeration = A.mgData->agglomeration;
+  double * const rcv = agglomeration ? agglomeration->buffer : A.mgData->rc->values; // The share of this process
+  const local_int_t * const f2c = A.mgData->f2cOperator;
+  const local_int_t * const f2cOffsets = A.mgData->f2cOffsets;
+  const local_int_t nc = agglomeration ? agglomeration->shareLength : A.mgData->rc->localLength;
+
+  #pragma omp for schedule(static)
+  for (local_int_t i=0; i<nc; ++i) {
+    if (f2cOffsets!=0) { // Aggregation
+      double sum = 0.0;
+      for (local_int_t j=f2cOffsets[i]; j<f2cOffsets[i+1]; ++j) sum += rfv[f2c[j]] - Axfv[f2c[j]];
+      rcv[i] = sum;
+    } else
+      rcv[i] = rfv[f2c[i]] - Axfv[f2c[i]];
+  }
+  if (agglomeration!=0) {
+    int ierr = 0;
+    #pragma omp master
+    ierr = GatherAgglomeratedResidual(*agglomeration, *A.geom, A.mgData->rc->values, 1);
+    return PersistentRegionBroadcast(ierr);
+  }
+  return 0;
+}
+
+/*!
+  ComputeProlongation_ref, or the trilinear prolongation, for the threads of the persistent region of CG, as
+  orphaned worksharing loops.
+*/
+static int ComputeProlongationInRegion(const SparseMatrix & Af, Vector & xf) {
+
+  if (Af.mgData->fullWeighting!=0) { // Trilinear, with the coarse halo
+    const FullWeighting & fullWeighting = *Af.mgData->fullWeighting;
+    double * const xfv = xf.values;
+    const double * const xcv = Af.mgData->xc->values;
+    const local_int_t nf = Af.localNumberOfRows;
+#ifndef HPCG_NO_MPI
+    #pragma omp master
+    ExchangeHalo(*Af.Ac, *Af.mgData->xc);
+    #pragma omp barrier
+#endif
+    #pragma omp for schedule(static)
+    for (local_int_t k=0; k<nf; ++k) {
+      double sum = 0.0;
+      for (local_int_t j=fullWeighting.prolongationRowStart[k]; j<fullWeighting.prolongationRowStart[k+1]; ++j)
+        sum += fullWeighting.prolongationWeights[j]*xcv[fullWeighting.prolongationColumns[j]];
+      xfv[k] += sum;
+    }
+    return 0;
+  }
+
+  double * const xfv = xf.values;
+  Agglomeration * const agglomeration = Af.mgData->agglomeration;
+  if (agglomeration!=0) {
+    int ierr = 0;
+    #pragma omp master
+    ierr = ScatterAgglomeratedCorrection(*agglomeration, *Af.geom, Af.mgData->xc->values, 1);
+    ierr = PersistentRegionBroadcast(ierr);
+    if (ierr!=0) return ierr;
+  }
+  const double * const xcv = agglomeration ? agglomeration->buffer : Af.mgData->xc->values; // The share of this process
+  const local_int_t * const f2c = Af.mgData->f2cOperator;
+  const local_int_t * const f2cOffsets = Af.mgData->f2cOffsets;
+  const local_int_t nc = agglomeration ? agglomeration->shareLength : Af.mgData->rc->localLength;
+
+  #pragma omp for schedule(static)
+  for (local_int_t i=0; i<nc; ++i) {
+    if (f2cOffsets!=0) { // Aggregation, aggregates are disjoint
+      for (local_int_t j=f2cOffsets[i]; j<f2cOffsets[i+1]; ++j) xfv[f2c[j]] += xcv[i];
+    } else
+      xfv[f2c[i]] += xcv[i];
+  }
+  return 0;
+}
+#endif
+
+#ifdef HPCG_REPLICATED_COARSE_SOLVE
+/*!
+  Solves the coarsest level exactly with the Cholesky factor that OptimizeProblem replicated on the processes
+  owning its rows: the right hand side of all of them is gathered, every process runs both triangular solves on
+  the band and keeps its own rows of the solution.  Inside the persistent region of CG the master thread solves.
+
+  @param[in] A the coarsest level matrix, with A.coarseCholesky set up
+  @param[in] r the right hand side
+  @param[inout] x on exit, the solution in the rows of this process
+
+  @return returns 0 upon success and non-zero otherwise
+*/
+static int ComputeCoarseCholeskySolve(const SparseMatrix & A, const Vector & r, Vector & x) {
+#ifdef HPCG_PERSISTENT_REGION
+  if (InPersistentRegion()) {
+    #pragma omp master
+    {
+      isInPersistentRegion = false;
+      ComputeCoarseCholeskySolve(A, r, x);
+      isInPersistentRegion = true;
+    }
+    return PersistentRegionBroadcast(0);
+  }
+#endif
+
+  CoarseCholesky & cholesky = *A.coarseCholesky;
+  const global_int_t n = cholesky.numberOfRows;
+  const global_int_t bandwidth = cholesky.bandwidth;
+  const global_int_t width = bandwidth+1;
+  const double * const L = cholesky.factor;
+  double * const y = cholesky.values;
+  const local_int_t nrow = A.localNumberOfRows;
+
+#ifndef HPCG_NO_MPI
+  MPI_Allgatherv(r.values, nrow, MPI_DOUBLE, cholesky.gathered, cholesky.counts, cholesky.displacements, MPI_DOUBLE, cholesky.comm);
+#else
+  for (local_int_t i=0; i<nrow; ++i) cholesky.gathered[i] = r.values[i];
+#endif
+  for (global_int_t k=0; k<n; ++k) y[cholesky.gatheredRows[k]] = cholesky.gathered[k];
+
+  for (global_int_t i=0; i<n; ++i) { // L*y = r, by rows
+    const double * const Li = L + i*width - i + bandwidth; // Li[j] is L(i,j)
+    double sum = y[i];
+    for (global_int_t j=std::max((global_int_t) 0, i-bandwidth); j<i; ++j) sum -= Li[j]*y[j];
+    y[i] = sum/Li[i];
+  }
+  for (global_int_t i=n-1; i>=0; --i) { // L'*x = y, by columns of L'
+    const double * const Li = L + i*width - i + bandwidth;
+    y[i] /= Li[i];
+    for (global_int_t j=std::max((global_int_t) 0, i-bandwidth); j<i; ++j) y[j] -= Li[j]*y[i];
+  }
+
+  for (local_int_t i=0; i<nrow; ++i) x.values[i] = y[A.localToGlobalMap[i]];
+  return 0;
+}
+#endif
+
+/*!
+  Full-weighting restriction (see GenerateFullWeighting): the fine residual is formed in Axf on all fine rows,
+  completed in the halo, and each coarse row sums it with the weights of its 27 fine neighbors.
+
+  @param[inout] A  the fine grid matrix, with A.mgData->fullWeighting set up; on exit mgData->rc holds the coarse residual
+  @param[in]    rf the fine grid right hand side
+
+  @return Returns zero on success and a non-zero value otherwise.
+*/
+static int ComputeFullWeightingRestriction(const SparseMatrix & A, const Vector & rf) {
+
+  const FullWeighting & fullWeighting = *A.mgData->fullWeighting;
+  double * const residual = A.mgData->Axf->values;
+  const double * const rfv = rf.values;
+  double * const rcv = A.mgData->rc->values;
+  const local_int_t nf = A.localNumberOfRows;
+  const local_int_t nc = A.mgData->rc->localLength;
+#ifndef HPCG_NO_OPENMP
+  #pragma omp parallel for
+#endif
+  for (local_int_t i=0; i<nf; ++i) residual[i] = rfv[i] - residual[i];
+#ifndef HPCG_NO_MPI
+  ExchangeHalo(A, *A.mgData->Axf);
+#endif
+#ifndef HPCG_NO_OPENMP
+  #pragma omp parallel for
+#endif
+  for (local_int_t i=0; i<nc; ++i) {
+    double sum = 0.0;
+    for (local_int_t j=fullWeighting.restrictionRowStart[i]; j<fullWeighting.restrictionRowStart[i+1]; ++j)
+      sum += fullWeighting.restrictionWeights[j]*residual[fullWeighting.restrictionColumns[j]];
+    rcv[i] = sum;
+  }
+  return 0;
+}
+
+/*!
+  Trilinear prolongation (see GenerateFullWeighting): every fine row is corrected from the up to 8 coarse rows
+  around it, so the fine rows next to the process boundary need the coarse halo.
+
+  @param[in]    Af the fine grid matrix, with Af.mgData->fullWeighting set up
+  @param[inout] xf the fine grid solution, updated with the coarse grid correction
+
+  @return Returns zero on success and a non-zero value otherwise.
+*/
+static int ComputeTrilinearProlongation(const SparseMatrix & Af, Vector & xf) {
+
+  const FullWeighting & fullWeighting = *Af.mgData->fullWeighting;
+  double * const xfv = xf.values;
+  const double * const xcv = Af.mgData->xc->values;
+  const local_int_t nf = Af.localNumberOfRows;
+#ifndef HPCG_NO_MPI
+  ExchangeHalo(*Af.Ac, *Af.mgData->xc);
+#endif
+#ifndef HPCG_NO_OPENMP
+  #pragma omp parallel for
+#endif
+  for (local_int_t k=0; k<nf; ++k) {
+    double sum = 0.0;
+    for (local_int_t j=fullWeighting.prolongationRowStart[k]; j<fullWeighting.prolongationRowStart[k+1]; ++j)
+      sum += fullWeighting.prolongationWeights[j]*xcv[fullWeighting.prolongationColumns[j]];
+    xfv[k] += sum;
+  }
+  return 0;
+}
+
+/*!
+  Selects the restriction for the calling thread and the transfer operator of the level: the reference version
+  (injection, aggregation or agglomeration) opens a parallel region of its own.
+*/
+static int ComputeRestriction(const SparseMatrix & A, const Vector & rf) {
+#ifdef HPCG_PERSISTENT_REGION
+  if (InPersistentRegion()) return ComputeRestrictionInRegion(A, rf);
+#endif
+  if (A.mgData->fullWeighting!=0) return ComputeFullWeightingRestriction(A, rf);
+  return ComputeRestriction_ref(A, rf);
+}
+
+/*!
+  Selects the prolongation for the calling thread and the transfer operator of the level: the reference version
+  (injection, aggregation or agglomeration) opens a parallel region of its own.
+*/
+static int ComputeProlongation(const SparseMatrix & Af, Vector & xf) {
+#ifdef HPCG_PERSISTENT_REGION
+  if (InPersistentRegion()) return ComputeProlongationInRegion(Af, xf);
+#endif
+  if (Af.mgData->fullWeighting!=0) return ComputeTrilinearProlongation(Af, xf);
+  return ComputeProlongation_ref(Af, xf);
+}
+
+static int ComputeMGLevel(const SparseMatrix  & A, const Vector & r, Vector & x, MGCycle cycle, bool isZeroGuess);
+
+/*!
+  The cycle follows the V-cycle of ComputeMG_ref, with the coarse visits of the selected
+  cycle (see GetCoarseVisits), but calls the optimizable SYMGS and SpMV kernels, so that
+  their replacements (and instrumentation) apply on every level. The time of each phase
+  is accumulated in A.mgData->times (by the master thread inside the persistent region
+  of CG). With HPCG_FUSED_RESIDUAL the residual SpMV is fused into the last presmoother
+  step (see ComputeSYMGSAndSPMV), so its time is counted as pre-smoothing.
+
+  @param[in] A the known system matrix
+  @param[in] r the input vector
+  @param[inout] x On exit contains the result of the multigrid cycle with r as the RHS, x is the approximation to Ax = r.
+  @param[in] cycle the kind of cycle (see MGCycle)
+  @param[in] isZeroGuess if true, x is initialized to zero, otherwise the cycle starts from the values of x
+
+  @return returns 0 upon success and non-zero otherwise
+*/
+static int ComputeCycle(const SparseMatrix  & A, const Vector & r, Vector & x, MGCycle cycle, bool isZeroGuess) {
+
+  // This line should be removed once optimized versions of the kernels below are used.
+#ifdef HPCG_PERSISTENT_REGION
+  if (!InPersistentRegion())
+#endif
+  A.isMgOptimized = false;
+
+  assert(x.localLength==A.localNumberOfColumns); // Make sure x contain space for halo values
+
+  double traceBegin = TraceBegin();
+  if (isZeroGuess) ZeroVector(x); // initialize x to zero
+
+  int ierr = 0;
+  if (A.mgData!=0) { // Go to next coarse level if defined
+    double * times = A.mgData->times;
+#ifdef HPCG_PERSISTENT_REGION
+    double unusedTimes[MG_NUMBER_OF_PHASES] = {0.0}; // The other threads of the persistent region do not record times
+    if (InPersistentRegion() && omp_get_thread_num()!=0) times = unusedTimes;
+#endif
+    double t0 = 0.0;
+    int numberOfPresmootherSteps = A.mgData->numberOfPresmootherSteps;
+#ifdef HPCG_FUSED_RESIDUAL
+    // The last presmoother step also forms Axf from the partial sums of its back sweep
+    TICK();
+    for (int i=0; i< numberOfPresmootherSteps-1; ++i) ierr += ComputeSYMGS(A, r, x);
+    if (numberOfPresmootherSteps>0) ierr += ComputeSYMGSAndSPMV(A, r, x, *A.mgData->Axf);
+    TOCK(times[MG_PRESMOOTH]);
+    if (ierr!=0) return ierr;
+    if (numberOfPresmootherSteps==0) { TICK(); ierr = ComputeSPMV(A, x, *A.mgData->Axf); TOCK(times[MG_RESIDUAL]); if (ierr!=0) return ierr; }
+#else
+    TICK();
+    for (int i=0; i< numberOfPresmootherSteps; ++i) ierr += ComputeSYMGS(A, r, x);
+    TOCK(times[MG_PRESMOOTH]);
+    if (ierr!=0) return ierr;
+    TICK(); ierr = ComputeSPMV(A, x, *A.mgData->Axf); TOCK(times[MG_RESIDUAL]); if (ierr!=0) return ierr;
+#endif
+    TICK(); ierr = ComputeRestriction(A, r); TOCK(times[MG_RESTRICTION]); TraceEnd("Restriction", t0); if (ierr!=0) return ierr;
+    TICK();
+    if (A.Ac->localNumberOfRows>0) { // Skipped by idle processes of agglomerated levels
+      MGCycle visits[2];
+      int numberOfVisits = GetCoarseVisits(cycle, visits);
+      for (int i=0; i<numberOfVisits && ierr==0; ++i) ierr = ComputeMGLevel(*A.Ac,*A.mgData->rc, *A.mgData->xc, visits[i], i==0);
+    }
+    TOCK(times[MG_COARSE_SOLVE]); if (ierr!=0) return ierr;
+    TICK(); ierr = ComputeProlongation(A, x); TOCK(times[MG_PROLONGATION]); TraceEnd("Prolongation", t0); if (ierr!=0) return ierr;
+    int numberOfPostsmootherSteps = A.mgData->numberOfPostsmootherSteps;
+    TICK();
+    for (int i=0; i< numberOfPostsmootherSteps; ++i) ierr += ComputeSYMGS(A, r, x);
+    TOCK(times[MG_POSTSMOOTH]);
+    if (ierr!=0) return ierr;
+  }
+  else {
+#ifdef HPCG_REPLICATED_COARSE_SOLVE
+    if (A.coarseCholesky!=0) ierr = ComputeCoarseCholeskySolve(A, r, x); // Exact solve instead of the SYMGS step
+    else
+#endif
+    ierr = ComputeSYMGS(A, r, x);
+    if (ierr!=0) return ierr;
+  }
+  TraceEnd("MG", traceBegin);
+  return 0;
+}
 
 /*!
+  Applies a multigrid cycle (see ComputeCycle) with the number of OpenMP threads that OptimizeProblem chose for
+  the level in A.numberOfThreads; the setting of the caller is restored on return.  Inside the persistent region
+  of CG the team is fixed and all levels use all of its threads.
+
   @param[in] A the known system matrix
   @param[in] r the input vector
-  @param[inout] x On exit contains the result of the multigrid V-cycle with r as the RHS, x is the approximation to Ax = r.
+  @param[inout] x On exit contains the result of the multigrid cycle with r as the RHS, x is the approximation to Ax = r.
+  @param[in] cycle the kind of cycle (see MGCycle)
+  @param[in] isZeroGuess if true, x is initialized to zero, otherwise the cycle starts from the values of x
+
+  @return returns 0 upon success and non-zero otherwise
+*/
+static int ComputeMGLevel(const SparseMatrix  & A, const Vector & r, Vector & x, MGCycle cycle, bool isZeroGuess) {
+
+#ifndef HPCG_NO_OPENMP
+  const int callerNumberOfThreads = omp_get_max_threads();
+  bool isLevelThreadCount = A.numberOfThreads>0 && A.numberOfThreads!=callerNumberOfThreads;
+#ifdef HPCG_PERSISTENT_REGION
+  if (InPersistentRegion()) isLevelThreadCount = false;
+#endif
+  if (isLevelThreadCount) omp_set_num_threads(A.numberOfThreads);
+  int ierr = ComputeCycle(A, r, x, cycle, isZeroGuess);
+  if (isLevelThreadCount) omp_set_num_threads(callerNumberOfThreads);
+  return ierr;
+#else
+  return ComputeCycle(A, r, x, cycle, isZeroGuess);
+#endif
+}
+
+/*!
+  Applies the multigrid cycle selected in A.mgData->cycle (a V-cycle by default), starting from x = 0.
+
+  @param[in] A the known system matrix
+  @param[in] r the input vector
+  @param[inout] x On exit contains the result of the multigrid cycle with r as the RHS, x is the approximation to Ax = r.
 
   @return returns 0 upon success and non-zero otherwise
 
   @see ComputeMG_ref
 */
 int ComputeMG(const SparseMatrix  & A, const Vector & r, Vector & x) {
-
-  // This line and the next two lines should be removed and your version of ComputeSYMGS should be used.
-  A.isMgOptimized = false;
-  return ComputeMG_ref(A, r, x);
+  return ComputeMGLevel(A, r, x, A.mgData!=0 ? A.mgData->cycle : MG_V_CYCLE, true);
 }
@@ -0,0 +1,190 @@
+
+//@HEADER
+// ***************************************************
+//
+// HPCG: High Performance Conjugate Gradient Benchmark
+//
+// Contact:
+// Michael A. Heroux ( maherou@sandia.gov)
+// Jack Dongarra     (dongarra@eecs.utk.edu)
+// Piotr Luszczek    (luszczek@eecs.utk.edu)
+//
+// ***************************************************
+//@HEADER
+
+/*!
+ @file ComputeMGMulti.cpp
+
+ HPCG routine
+ */
+
+#ifndef HPCG_NO_OPENMP
+#include <omp.h>
+#endif
+
+#include "ComputeMGMulti.hpp"
+#include "ComputeSYMGSMulti.hpp"
+#include "ComputeSPMVMulti.hpp"
+#include "ExchangeHaloMulti.hpp"
+#include <cassert>
+
+/*!
+  Computes the coarse residual block rc = R*(rf - Axf) for all vectors of the block, with simple
+  injection, full weighting or, for aggregation-based coarse levels, summation over each aggregate.  On agglomerated
+  coarse levels the block is gathered on the process that owns the coarse rows.
+
+  @see ComputeRestriction_ref
+*/
+static void ComputeRestrictionMulti(const SparseMatrix & A, const MultiVector & rf, MultiVector & Axf, MultiVector & rc) {
+
+  const int k = rf.numberOfVectors;
+  if (A.mgData->fullWeighting!=0) { // The residual block is formed in Axf and completed in the halo
+    const FullWeighting & fullWeighting = *A.mgData->fullWeighting;
+    const local_int_t nf = A.localNumberOfRows;
+    const local_int_t nc = A.Ac->localNumberOfRows;
+#ifndef HPCG_NO_OPENMP
+#pragma omp parallel for
+#endif
+    for (local_int_t i=0; i<nf*k; ++i) Axf.values[i] = rf.values[i] - Axf.values[i];
+#ifndef HPCG_NO_MPI
+    ExchangeHaloMulti(A, Axf);
+#endif
+#ifndef HPCG_NO_OPENMP
+#pragma omp parallel for
+#endif
+    for (local_int_t i=0; i<nc; ++i) {
+      for (int l=0; l<k; ++l) rc.values[i*k+l] = 0.0;
+      for (local_int_t j=fullWeighting.restrictionRowStart[i]; j<fullWeighting.restrictionRowStart[i+1]; ++j)
+        for (int l=0; l<k; ++l) rc.values[i*k+l] += fullWeighting.restrictionWeights[j]*Axf.values[fullWeighting.restrictionColumns[j]*k+l];
+    }
+    return;
+  }
+  const double * const Axfv = Axf.values;
+  const double * const rfv = rf.values;
+  Agglomeration * const agglomeration = A.mgData->agglomeration;
+  double * const rcv = agglomeration ? GetAgglomerationShare(*agglomeration, k) : rc.values;
+  const local_int_t * const f2c = A.mgData->f2cOperator;
+  const local_int_t * const f2cOffsets = A.mgData->f2cOffsets;
+  const local_int_t nc = agglomeration ? agglomeration->shareLength : A.Ac->localNumberOfRows;
+
+#ifndef HPCG_NO_OPENMP
+#pragma omp parallel for
+#endif
+  for (local_int_t i=0; i<nc; ++i) {
+    local_int_t first = f2cOffsets ? f2cOffsets[i] : i;
+    local_int_t last = f2cOffsets ? f2cOffsets[i+1] : i+1;
+    for (int l=0; l<k; ++l) rcv[i*k+l] = 0.0;
+    for (local_int_t j=first; j<last; ++j)
+      for (int l=0; l<k; ++l) rcv[i*k+l] += rfv[f2c[j]*k+l] - Axfv[f2c[j]*k+l];
+  }
+  if (agglomeration!=0) GatherAgglomeratedResidual(*agglomeration, *A.geom, rc.values, k);
+  return;
+}
+
+/*!
+  Adds the coarse grid correction block to the fine grid block for all vectors of the block, after
+  scattering it from the owning process on agglomerated coarse levels.
+
+  @see ComputeProlongation_ref
+*/
+static void ComputeProlongationMulti(const SparseMatrix & Af, MultiVector & xc, MultiVector & xf) {
+
+  const int k = xf.numberOfVectors;
+  if (Af.mgData->fullWeighting!=0) { // Trilinear, with the coarse halo
+    const FullWeighting & fullWeighting = *Af.mgData->fullWeighting;
+    const local_int_t nf = Af.localNumberOfRows;
+#ifndef HPCG_NO_MPI
+    ExchangeHaloMulti(*Af.Ac, xc);
+#endif
+#ifndef HPCG_NO_OPENMP
+#pragma omp parallel for
+#endif
+    for (local_int_t i=0; i<nf; ++i)
+      for (local_int_t j=fullWeighting.prolongationRowStart[i]; j<fullWeighting.prolongationRowStart[i+1]; ++j)
+        for (int l=0; l<k; ++l) xf.values[i*k+l] += fullWeighting.prolongationWeights[j]*xc.values[fullWeighting.prolongationColumns[j]*k+l];
+    return;
+  }
+  double * const xfv = xf.values;
+  Agglomeration * const agglomeration = Af.mgData->agglomeration;
+  if (agglomeration!=0) ScatterAgglomeratedCorrection(*agglomeration, *Af.geom, xc.values, k);
+  const double * const xcv = agglomeration ? agglomeration->buffer : xc.values;
+  const local_int_t * const f2c = Af.mgData->f2cOperator;
+  const local_int_t * const f2cOffsets = Af.mgData->f2cOffsets;
+  const local_int_t nc = agglomeration ? agglomeration->shareLength : Af.Ac->localNumberOfRows;
+
+#ifndef HPCG_NO_OPENMP
+#pragma omp parallel for
+#endif
+  for (local_int_t i=0; i<nc; ++i) {
+    local_int_t first = f2cOffsets ? f2cOffsets[i] : i;
+    local_int_t last = f2cOffsets ? f2cOffsets[i+1] : i+1;
+    for (local_int_t j=first; j<last; ++j) // Fine rows of different coarse rows are disjoint
+      for (int l=0; l<k; ++l) xfv[f2c[j]*k+l] += xcv[i*k+l];
+  }
+  return;
+}
+
+/*!
+  Multigrid cycle applied to all vectors of a block at once, with the same smoothing, transfer and
+  coarse visits as ComputeMG.  All matrix sweeps are SpMM-style and read every level's matrix once
+  per step for the whole block.
+
+  @param[in] A the known system matrix
+  @param[in] r the input block of vectors
+  @param[inout] x On exit contains the result of the multigrid cycle with r as the RHS
+  @param[inout] data the block CG data holding the work blocks of the coarse levels
+  @param[in] level the multigrid level of A (0 for the finest)
+  @param[in] cycle the kind of cycle (see MGCycle)
+  @param[in] isZeroGuess if true, x is initialized to zero, otherwise the cycle starts from the values of x
+
+  @return returns 0 upon success and non-zero otherwise
+*/
+static int ComputeCycleMulti(const SparseMatrix & A, const MultiVector & r, MultiVector & x, CGMultiData & data, int level,
+    MGCycle cycle, bool isZeroGuess) {
+  assert(x.localLength==A.localNumberOfColumns); // Make sure x contain space for halo values
+
+  if (isZeroGuess) ZeroMultiVector(x); // initialize x to zero
+
+  int ierr = 0;
+  if (A.mgData!=0) { // Go to next coarse level if defined
+    MultiVector & Axf = data.Axf[level];
+    MultiVector & rc = data.rc[level];
+    MultiVector & xc = data.xc[level];
+    int numberOfPresmootherSteps = A.mgData->numberOfPresmootherSteps;
+    for (int i=0; i< numberOfPresmootherSteps; ++i) ierr += ComputeSYMGSMulti(A, r, x);
+    if (ierr!=0) return ierr;
+    ierr = ComputeSPMVMulti(A, x, Axf); if (ierr!=0) return ierr;
+    ComputeRestrictionMulti(A, r, Axf, rc);
+    MGCycle visits[2];
+    int numberOfVisits = GetCoarseVisits(cycle, visits);
+    for (int i=0; i<numberOfVisits; ++i) { // Visits after the first start from the previous correction
+      ierr = ComputeCycleMulti(*A.Ac, rc, xc, data, level+1, visits[i], i==0); if (ierr!=0) return ierr;
+    }
+    ComputeProlongationMulti(A, xc, x);
+    int numberOfPostsmootherSteps = A.mgData->numberOfPostsmootherSteps;
+    for (int i=0; i< numberOfPostsmootherSteps; ++i) ierr += ComputeSYMGSMulti(A, r, x);
+    if (ierr!=0) return ierr;
+  }
+  else {
+    ierr = ComputeSYMGSMulti(A, r, x);
+    if (ierr!=0) return ierr;
+  }
+  return 0;
+}
+
+/*!
+  Applies the multigrid cycle selected in A.mgData->cycle to all vectors of a block, starting from x = 0.
+
+  @param[in] A the known system matrix
+  @param[in] r the input block of vectors
+  @param[inout] x On exit contains the result of the multigrid cycle with r as the RHS
+  @param[inout] data the block CG data holding the work blocks of the coarse levels
+  @param[in] level the multigrid level of A (0 for the finest)
+
+  @return returns 0 upon success and non-zero otherwise
+
+  @see ComputeMG_ref
+*/
+int ComputeMGMulti(const SparseMatrix & A, const MultiVector & r, MultiVector & x, CGMultiData & data, int level) {
+  return ComputeCycleMulti(A, r, x, data, level, A.mgData!=0 ? A.mgData->cycle : MG_V_CYCLE, true);
+}
@@ -0,0 +1,23 @@
+
+//@HEADER
+// ***************************************************
+//
+// HPCG: High Performance Conjugate Gradient Benchmark
+//
+// Contact:
+// Michael A. Heroux ( maherou@sandia.gov)
+// Jack Dongarra     (dongarra@eecs.utk.edu)
+// Piotr Luszczek    (luszczek@eecs.utk.edu)
+//
+// ***************************************************
+//@HEADER
+
+#ifndef COMPUTEMGMULTI_HPP
+#define COMPUTEMGMULTI_HPP
+#include "SparseMatrix.hpp"
+#include "MultiVector.hpp"
+#include "CGMultiData.hpp"
+
+int ComputeMGMulti(const SparseMatrix & A, const MultiVector & r, MultiVector & x, CGMultiData & data, int level = 0);
+
+#endif // COMPUTEMGMULTI_HPP
@@ -0,0 +1,157 @@
+
+//@HEADER
+// ***************************************************
+//
+// HPCG: High Performance Conjugate Gradient Benchmark
+//
+// Contact:
+// Michael A. Heroux ( maherou@sandia.gov)
+// Jack Dongarra     (dongarra@eecs.utk.edu)
+// Piotr Luszczek    (luszczek@eecs.utk.edu)
+//
+// ***************************************************
+//@HEADER
+
+
+/*!
+ @file ComputeNodeAwareProcessGrid.cpp
+
+ HPCG routine
+ */
+
+#ifndef HPCG_NO_MPI
+#include <mpi.h>
+#endif
+
+#include <algorithm>
+#include <vector>
+#include "ComputeNodeAwareProcessGrid.hpp"
+#include "ComputeOptimalShapeXYZ.hpp"
+
+#ifndef HPCG_NO_MPI
+/*!
+  Number of grid points on the faces between nodes when every node owns a bx by by by bz block of the
+  npx by npy by npz process grid (edge and corner neighbors are ignored).
+*/
+static double InterNodeFacePoints(int npx, int npy, int npz, int bx, int by, int bz, local_int_t nx, local_int_t ny, local_int_t nz) {
+  double gnx = ((double) npx)*nx, gny = ((double) npy)*ny, gnz = ((double) npz)*nz;
+  return (npx/bx-1)*gny*gnz + (npy/by-1)*gnx*gnz + (npz/bz-1)*gnx*gny;
+}
+#endif
+
+/*!
+  Chooses the process grid and the placement of the processes in it from the node membership of the
+  processes, so that neighbors on the same node exchange the largest halo faces and the number of
+  halo points exchanged between nodes is minimized.
+
+  Nodes are found with MPI_Comm_split_type(MPI_COMM_TYPE_SHARED). Each node owns a bx by by by bz block of
+  the process grid, the nodes are placed in the grid in the order of their lowest rank and the processes
+  of a node in the order of their rank.  All process grids that are as close to a cube as the one of
+  ComputeOptimalShapeXYZ (its permutations, for example) and all blocks with as many processes as a node are
+  searched; ties are broken by the total number of halo points and then in favor of the grid of
+  ComputeOptimalShapeXYZ.  Nothing is changed when
+  all processes are on one node, every node has one process, or the nodes have different numbers of processes.
+
+  @param[in]    params the run parameters: the processes of params.comm are placed, and a nonzero params.pz keeps the process grid
+  @param[in]    nx, ny, nz number of grid points for each local block in the x, y, and z dimensions, respectively
+  @param[inout] npx, npy, npz the process grid; kept if their product is size, otherwise replaced by the best one
+  @param[out]   processRanks on return, 0 if ranks should follow the lexicographic order of the process grid,
+                otherwise a new array of length size with the rank of the process at position ipx+ipy*npx+ipz*npx*npy
+                (to be deleted by the caller)
+
+  @see GenerateGeometry
+*/
+void ComputeNodeAwareProcessGrid(const HPCG_Params & params, local_int_t nx, local_int_t ny, local_int_t nz,
+    int & npx, int & npy, int & npz, int * & processRanks) {
+
+  int size = params.comm_size;
+  processRanks = 0;
+  bool isGridFixed = params.pz!=0; // The z partition refers to the given process grid
+  if (npx*npy*npz<=0 || npx*npy*npz>size) // Same rule as in GenerateGeometry
+    ComputeOptimalShapeXYZ(size, npx, npy, npz);
+  else
+    isGridFixed = true;
+  if (npx*npy*npz!=size) return;
+
+#ifndef HPCG_NO_MPI
+  int rank = params.comm_rank;
+  MPI_Comm nodeComm;
+  MPI_Comm_split_type(params.comm, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &nodeComm);
+  int nodeRank, nodeSize;
+  MPI_Comm_rank(nodeComm, &nodeRank);
+  MPI_Comm_size(nodeComm, &nodeSize);
+
+  // Number the nodes in the order of their lowest rank
+  MPI_Comm leaderComm;
+  MPI_Comm_split(params.comm, nodeRank==0 ? 0 : MPI_UNDEFINED, rank, &leaderComm);
+  int nodeId = 0;
+  if (leaderComm!=MPI_COMM_NULL) {
+    MPI_Comm_rank(leaderComm, &nodeId);
+    MPI_Comm_free(&leaderComm);
+  }
+  MPI_Bcast(&nodeId, 1, MPI_INT, 0, nodeComm);
+  MPI_Comm_free(&nodeComm);
+
+  int nodeSizes[2] = {nodeSize, -nodeSize};
+  MPI_Allreduce(MPI_IN_PLACE, nodeSizes, 2, MPI_INT, MPI_MIN, params.comm);
+  if (nodeSizes[0]!=-nodeSizes[1] || nodeSize==1 || nodeSize==size) return; // Uneven nodes, or nothing to gain
+
+  // Search the process grids and node blocks
+  int defaultx = 0, defaulty = 0, defaultz = 0;
+  ComputeOptimalShapeXYZ(size, defaultx, defaulty, defaultz);
+  double defaultRatio = std::min(std::min(defaultx, defaulty), defaultz) / double(std::max(std::max(defaultx, defaulty), defaultz));
+  double bestCost = -1.0, bestHalo = 0.0;
+  int best[6] = {npx, npy, npz, 0, 0, 0};
+  for (int px=1; px<=size; ++px) {
+    if (size%px!=0) continue;
+    for (int py=1; py<=size/px; ++py) {
+      if ((size/px)%py!=0) continue;
+      int pzz = size/px/py;
+      if (isGridFixed && (px!=npx || py!=npy || pzz!=npz)) continue;
+      if (!isGridFixed && std::min(std::min(px, py), pzz) / double(std::max(std::max(px, py), pzz)) < defaultRatio) continue;
+      double halo = InterNodeFacePoints(px, py, pzz, 1, 1, 1, nx, ny, nz);
+      for (int bx=1; bx<=px; ++bx) {
+        if (px%bx!=0 || nodeSize%bx!=0) continue;
+        for (int by=1; by<=py; ++by) {
+          if (py%by!=0 || (nodeSize/bx)%by!=0) continue;
+          int bz = nodeSize/bx/by;
+          if (pzz%bz!=0) continue;
+          double cost = InterNodeFacePoints(px, py, pzz, bx, by, bz, nx, ny, nz);
+          bool isDefault = px==defaultx && py==defaulty && pzz==defaultz;
+          if (bestCost<0.0 || cost<bestCost || (cost==bestCost && (halo<bestHalo || (halo==bestHalo && isDefault)))) {
+            bestCost = cost;
+            bestHalo = halo;
+            best[0] = px; best[1] = py; best[2] = pzz;
+            best[3] = bx; best[4] = by; best[5] = bz;
+          }
+        }
+      }
+    }
+  }
+  if (bestCost<0.0) return; // No block of the grid matches the node size
+
+  npx = best[0];
+  npy = best[1];
+  npz = best[2];
+  int bx = best[3], by = best[4], bz = best[5];
+
+  // Position of this process: block of its node, then its place within the block
+  int nodesx = npx/bx, nodesy = npy/by;
+  int kz = nodeId/(nodesx*nodesy), ky = (nodeId/nodesx)%nodesy, kx = nodeId%nodesx;
+  int lz = nodeRank/(bx*by), ly = (nodeRank/bx)%by, lx = nodeRank%bx;
+  int ipx = kx*bx+lx, ipy = ky*by+ly, ipz = kz*bz+lz;
+  int position = ipx+ipy*npx+ipz*npx*npy;
+
+  std::vector<int> positions(size);
+  MPI_Allgather(&position, 1, MPI_INT, &positions[0], 1, MPI_INT, params.comm);
+  bool isLexicographic = true;
+  for (int i=0; i<size; ++i) isLexicographic = isLexicographic && positions[i]==i;
+  if (isLexicographic) return;
+
+  processRanks = new int[size];
+  for (int i=0; i<size; ++i) processRanks[positions[i]] = i;
+#else
+  (void) nx; (void) ny; (void) nz; (void) isGridFixed;
+#endif
+  return;
+}
@@ -0,0 +1,29 @@
+
+//@HEADER
+// ***************************************************
+//
+// HPCG: High Performance Conjugate Gradient Benchmark
+//
+// Contact:
+// Michael A. Heroux ( maherou@sandia.gov)
+// Jack Dongarra     (dongarra@eecs.utk.edu)
+// Piotr Luszczek    (luszczek@eecs.utk.edu)
+//
+// ***************************************************
+//@HEADER
+
+
+/*!
+ @file ComputeNodeAwareProcessGrid.hpp
+
+ HPCG routine
+ */
+
+#ifndef COMPUTENODEAWAREPROCESSGRID_HPP
+#define COMPUTENODEAWAREPROCESSGRID_HPP
+#include "hpcg.hpp"
+
+void ComputeNodeAwareProcessGrid(const HPCG_Params & params, local_int_t nx, local_int_t ny, local_int_t nz,
+    int & npx, int & npy, int & npz, int * & processRanks);
+
+#endif // COMPUTENODEAWAREPROCESSGRID_HPP
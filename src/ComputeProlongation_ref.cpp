@@ -32,6 +32,7 @@
 
   Note that the fine grid residual is never explicitly constructed.
   We only compute it for the fine grid points that will be injected into corresponding coarse grid points.
+  If the coarse level is agglomerated onto fewer processes, the correction is first scattered from the process that owns it.
 
   @return Returns zero on success and a non-zero value otherwise.
 */
@@ -41,6 +42,23 @@ int ComputeProlongation_ref(const SparseMatrix & Af, Vector & xf) {
   double * xcv = Af.mgData->xc->values;
   local_int_t * f2c = Af.mgData->f2cOperator;
   local_int_t nc = Af.mgData->rc->localLength;
+  Agglomeration * agglomeration = Af.mgData->agglomeration;
+  if (agglomeration!=0) { // Get the correction of the share of this process from the root
+    int ierr = ScatterAgglomeratedCorrection(*agglomeration, *Af.geom, xcv, 1);
+    if (ierr!=0) return ierr;
+    xcv = GetAgglomerationShare(*agglomeration, 1);
+    nc = agglomeration->shareLength;
+  }
+
+  if (Af.mgData->f2cOffsets!=0) { // Aggregation: every fine row of an aggregate receives its coarse correction
+    local_int_t * f2cOffsets = Af.mgData->f2cOffsets;
+#ifndef HPCG_NO_OPENMP
+#pragma omp parallel for
+#endif
+    for (local_int_t i=0; i<nc; ++i)
+      for (local_int_t j=f2cOffsets[i]; j<f2cOffsets[i+1]; ++j) xfv[f2c[j]] += xcv[i]; // Aggregates are disjoint
+    return 0;
+  }
 
 #ifndef HPCG_NO_OPENMP
 #pragma omp parallel for
@@ -40,20 +40,21 @@
 /*!
   Routine to compute the inf-norm difference between two vectors where:
 
+  @param[in]  geom     geometry of the processes the vectors are distributed over
   @param[in]  n        number of vector elements (local to this processor)
   @param[in]  v1, v2   input vectors
   @param[out] residual pointer to scalar value; on exit, will contain result: inf-norm difference
 
   @return Returns zero on success and a non-zero value otherwise.
 */
-int ComputeResidual(const local_int_t n, const Vector & v1, const Vector & v2, double & residual) {
+int ComputeResidual(const Geometry & geom, const local_int_t n, const Vector & v1, const Vector & v2, double & residual) {
 
   double * v1v = v1.values;
   double * v2v = v2.values;
   double local_residual = 0.0;
 
 #ifndef HPCG_NO_OPENMP
-  #pragma omp parallel default(none) shared(local_residual, v1v, v2v)
+  #pragma omp parallel shared(local_residual, v1v, v2v)
   {
     double threadlocal_residual = 0.0;
     #pragma omp for
@@ -79,9 +80,10 @@ int ComputeResidual(const local_int_t n, const Vector & v1, const Vector & v2, d
 #ifndef HPCG_NO_MPI
   // Use MPI's reduce function to collect all partial sums
   double global_residual = 0;
-  MPI_Allreduce(&local_residual, &global_residual, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+  MPI_Allreduce(&local_residual, &global_residual, 1, MPI_DOUBLE, MPI_MAX, geom.comm);
   residual = global_residual;
 #else
+  (void) geom;
   residual = local_residual;
 #endif
 
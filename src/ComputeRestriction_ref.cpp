@@ -34,6 +34,7 @@
 
   Note that the fine grid residual is never explicitly constructed.
   We only compute it for the fine grid points that will be injected into corresponding coarse grid points.
+  If the coarse level is agglomerated onto fewer processes, the rows computed here are gathered on the process that owns them.
 
   @return Returns zero on success and a non-zero value otherwise.
 */
@@ -44,11 +45,30 @@ int ComputeRestriction_ref(const SparseMatrix & A, const Vector & rf) {
   double * rcv = A.mgData->rc->values;
   local_int_t * f2c = A.mgData->f2cOperator;
   local_int_t nc = A.mgData->rc->localLength;
+  Agglomeration * agglomeration = A.mgData->agglomeration;
+  if (agglomeration!=0) { // Restrict into the share of this process, then gather the shares on the root
+    rcv = GetAgglomerationShare(*agglomeration, 1);
+    nc = agglomeration->shareLength;
+  }
+
+  if (A.mgData->f2cOffsets!=0) { // Aggregation: sum the fine residual over the rows of each aggregate
+    local_int_t * f2cOffsets = A.mgData->f2cOffsets;
+#ifndef HPCG_NO_OPENMP
+#pragma omp parallel for
+#endif
+    for (local_int_t i=0; i<nc; ++i) {
+      double sum = 0.0;
+      for (local_int_t j=f2cOffsets[i]; j<f2cOffsets[i+1]; ++j) sum += rfv[f2c[j]] - Axfv[f2c[j]];
+      rcv[i] = sum;
+    }
+    return 0;
+  }
 
 #ifndef HPCG_NO_OPENMP
 #pragma omp parallel for
 #endif
   for (local_int_t i=0; i<nc; ++i) rcv[i] = rfv[f2c[i]] - Axfv[f2c[i]];
 
+  if (agglomeration!=0) return GatherAgglomeratedResidual(*agglomeration, *A.geom, A.mgData->rc->values, 1);
   return 0;
 }
@@ -18,8 +18,44 @@
  HPCG routine
  */
 
+#if defined(HPCG_PERSISTENT_REGION) && !defined(HPCG_NO_MPI)
+#include "ExchangeHalo.hpp"
+#endif
 #include "ComputeSPMV.hpp"
 #include "ComputeSPMV_ref.hpp"
+#include "PerfCounters.hpp"
+#include "PersistentRegion.hpp"
+#include "Trace.hpp"
+
+#ifdef HPCG_PERSISTENT_REGION
+/*!
+  SpMV for the threads of the persistent region of CG: the master thread exchanges the halo, then the rows
+  are split with an orphaned worksharing loop whose implicit barrier makes y complete on return.
+*/
+static int ComputeSPMVInRegion(const SparseMatrix & A, Vector & x, Vector & y) {
+
+#ifndef HPCG_NO_MPI
+  #pragma omp master
+  ExchangeHalo(A,x);
+  #pragma omp barrier
+#endif
+  const double * const xv = x.values;
+  double * const yv = y.values;
+  const local_int_t nrow = A.localNumberOfRows;
+  #pragma omp for schedule(static)
+  for (local_int_t i=0; i< nrow; i++)  {
+    double sum = 0.0;
+    const double * const cur_vals = A.matrixValues[i];
+    const local_int_t * const cur_inds = A.mtxIndL[i];
+    const int cur_nnz = A.nonzerosInRow[i];
+
+    for (int j=0; j< cur_nnz; j++)
+      sum += cur_vals[j]*xv[cur_inds[j]];
+    yv[i] = sum;
+  }
+  return 0;
+}
+#endif
 
 /*!
   Routine to compute sparse matrix vector product y = Ax where:
@@ -40,6 +76,19 @@
 int ComputeSPMV( const SparseMatrix & A, Vector & x, Vector & y) {
 
   // This line and the next two lines should be removed and your version of ComputeSPMV should be used.
-  A.isSpmvOptimized = false;
-  return ComputeSPMV_ref(A, x, y);
+  HPCG_PERF_START(PERF_SPMV);
+  double traceBegin = TraceBegin();
+  int ierr;
+#ifdef HPCG_PERSISTENT_REGION
+  if (InPersistentRegion())
+    ierr = ComputeSPMVInRegion(A, x, y);
+  else
+#endif
+  {
+    A.isSpmvOptimized = false;
+    ierr = ComputeSPMV_ref(A, x, y);
+  }
+  TraceEnd("SpMV", traceBegin);
+  HPCG_PERF_STOP(PERF_SPMV);
+  return ierr;
 }
@@ -0,0 +1,74 @@
+
+//@HEADER
+// ***************************************************
+//
+// HPCG: High Performance Conjugate Gradient Benchmark
+//
+// Contact:
+// Michael A. Heroux ( maherou@sandia.gov)
+// Jack Dongarra     (dongarra@eecs.utk.edu)
+// Piotr Luszczek    (luszczek@eecs.utk.edu)
+//
+// ***************************************************
+//@HEADER
+
+/*!
+ @file ComputeSPMVMulti.cpp
+
+ HPCG routine
+ */
+
+#include "ComputeSPMVMulti.hpp"
+
+#ifndef HPCG_NO_MPI
+#include "ExchangeHaloMulti.hpp"
+#endif
+
+#ifndef HPCG_NO_OPENMP
+#include <omp.h>
+#endif
+#include <cassert>
+
+/*!
+  Routine to compute the sparse matrix times block of vectors product Y = A*X (SpMM): each matrix
+  row is read once and applied to all vectors of the block.
+
+  @param[in]  A the known system matrix
+  @param[in]  x the known block of vectors
+  @param[out] y On exit contains the result: Ax.
+
+  @return returns 0 upon success and non-zero otherwise
+
+  @see ComputeSPMV
+*/
+int ComputeSPMVMulti(const SparseMatrix & A, MultiVector & x, MultiVector & y) {
+
+  assert(x.localLength>=A.localNumberOfColumns); // Test vector lengths
+  assert(y.localLength>=A.localNumberOfRows);
+  assert(x.numberOfVectors==y.numberOfVectors);
+
+#ifndef HPCG_NO_MPI
+  ExchangeHaloMulti(A, x);
+#endif
+  const double * const xv = x.values;
+  double * const yv = y.values;
+  const local_int_t nrow = A.localNumberOfRows;
+  const int k = x.numberOfVectors;
+#ifndef HPCG_NO_OPENMP
+  #pragma omp parallel for
+#endif
+  for (local_int_t i=0; i< nrow; i++)  {
+    const double * const cur_vals = A.matrixValues[i];
+    const local_int_t * const cur_inds = A.mtxIndL[i];
+    const int cur_nnz = A.nonzerosInRow[i];
+    double * const cur_y = yv + i*k;
+
+    for (int l=0; l<k; l++) cur_y[l] = 0.0;
+    for (int j=0; j< cur_nnz; j++) {
+      const double a = cur_vals[j];
+      const double * const cur_x = xv + cur_inds[j]*k;
+      for (int l=0; l<k; l++) cur_y[l] += a*cur_x[l];
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,22 @@
+
+//@HEADER
+// ***************************************************
+//
+// HPCG: High Performance Conjugate Gradient Benchmark
+//
+// Contact:
+// Michael A. Heroux ( maherou@sandia.gov)
+// Jack Dongarra     (dongarra@eecs.utk.edu)
+// Piotr Luszczek    (luszczek@eecs.utk.edu)
+//
+// ***************************************************
+//@HEADER
+
+#ifndef COMPUTESPMVMULTI_HPP
+#define COMPUTESPMVMULTI_HPP
+#include "SparseMatrix.hpp"
+#include "MultiVector.hpp"
+
+int ComputeSPMVMulti(const SparseMatrix & A, MultiVector & x, MultiVector & y);
+
+#endif // COMPUTESPMVMULTI_HPP
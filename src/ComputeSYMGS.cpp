@@ -18,8 +18,229 @@
  HPCG routine
  */
 
+#ifndef HPCG_NO_MPI
+#include "ExchangeHalo.hpp"
+#endif
+#include <cassert>
 #include "ComputeSYMGS.hpp"
 #include "ComputeSYMGS_ref.hpp"
+#include "ComputeSPMV.hpp"
+#include "PerfCounters.hpp"
+#include "PersistentRegion.hpp"
+#include "Trace.hpp"
+
+/*!
+  Divides the updated value of row i by its diagonal entry.  With HPCG_RECIPROCAL_DIAGONAL it multiplies by the
+  cached reciprocal instead, which is faster but rounds differently from ComputeSYMGS_ref and may cost an extra
+  CG iteration to reach the reference tolerance.
+*/
+static inline double DivideByDiagonal(const SparseMatrix & A, double value, local_int_t i) {
+#ifdef HPCG_RECIPROCAL_DIAGONAL
+  return value*A.inverseDiagonalValues[i];
+#else
+  return value/A.diagonalValues[i];
+#endif
+}
+
+/*!
+  The sweeps of ComputeSYMGS_ref with the contiguous diagonal set up by OptimizeProblem: one streaming load per
+  row instead of a load through matrixDiagonal (see DivideByDiagonal for the division).
+
+  If Ax is not 0, the back sweep also keeps the product of each row with the local entries of x it has already
+  finalized (the columns after the row), so that only the columns before the row and the halo, exchanged again
+  since the neighbors have updated their values, are left to complete Ax = A*x afterwards.
+*/
+static int ComputeSYMGSWithDiagonalCache(const SparseMatrix & A, const Vector & r, Vector & x, Vector * Ax) {
+
+  assert(x.localLength==A.localNumberOfColumns); // Make sure x contain space for halo values
+
+#ifndef HPCG_NO_MPI
+  ExchangeHalo(A,x);
+#endif
+
+  const local_int_t nrow = A.localNumberOfRows;
+  const double * const diagonal = A.diagonalValues;
+  const double * const rv = r.values;
+  double * const xv = x.values;
+
+  for (local_int_t i=0; i< nrow; i++) {
+    const double * const currentValues = A.matrixValues[i];
+    const local_int_t * const currentColIndices = A.mtxIndL[i];
+    const int currentNumberOfNonzeros = A.nonzerosInRow[i];
+    double sum = rv[i]; // RHS value
+
+    for (int j=0; j< currentNumberOfNonzeros; j++) sum -= currentValues[j] * xv[currentColIndices[j]];
+    sum += xv[i]*diagonal[i]; // Remove diagonal contribution from previous loop
+
+    xv[i] = DivideByDiagonal(A, sum, i);
+  }
+
+  // Now the back sweep.
+
+  double * const axv = Ax!=0 ? Ax->values : 0;
+  for (local_int_t i=nrow-1; i>=0; i--) {
+    const double * const currentValues = A.matrixValues[i];
+    const local_int_t * const currentColIndices = A.mtxIndL[i];
+    const int currentNumberOfNonzeros = A.nonzerosInRow[i];
+    double sum = rv[i]; // RHS value
+
+    if (axv!=0) {
+      double upperSum = 0.0; // Local columns after i, final from here on
+      for (int j=0; j< currentNumberOfNonzeros; j++) {
+        const local_int_t curCol = currentColIndices[j];
+        const double product = currentValues[j] * xv[curCol];
+        sum -= product;
+        if (curCol>i && curCol<nrow) upperSum += product;
+      }
+      sum += xv[i]*diagonal[i]; // Remove diagonal contribution from previous loop
+      xv[i] = DivideByDiagonal(A, sum, i);
+      axv[i] = upperSum + diagonal[i]*xv[i];
+    } else {
+      for (int j=0; j< currentNumberOfNonzeros; j++) sum -= currentValues[j] * xv[currentColIndices[j]];
+      sum += xv[i]*diagonal[i]; // Remove diagonal contribution from previous loop
+
+      xv[i] = DivideByDiagonal(A, sum, i);
+    }
+  }
+
+  if (axv!=0) { // Add the columns before each row, which the back sweep updated after using them, and the halo
+#ifndef HPCG_NO_MPI
+    ExchangeHalo(A,x);
+#endif
+#ifndef HPCG_NO_OPENMP
+    #pragma omp parallel for schedule(static)
+#endif
+    for (local_int_t i=0; i< nrow; i++) {
+      const double * const currentValues = A.matrixValues[i];
+      const local_int_t * const currentColIndices = A.mtxIndL[i];
+      const int currentNumberOfNonzeros = A.nonzerosInRow[i];
+      double lowerSum = 0.0;
+      for (int j=0; j< currentNumberOfNonzeros; j++)
+        if (currentColIndices[j]<i || currentColIndices[j]>=nrow) lowerSum += currentValues[j] * xv[currentColIndices[j]];
+      axv[i] += lowerSum;
+    }
+  }
+
+  return 0;
+}
+
+#ifdef HPCG_SPLIT_TRIANGULAR
+/*!
+  The sweeps of ComputeSYMGS_ref on the strictly lower and upper parts set up by OptimizeProblem. The forward
+  sweep forms r - U*x with a row-parallel product over the upper part, which only reads values of x that the
+  sweep has not yet updated, and then solves (L+D)x = r - U*x; the back sweep does the reverse with the lower part.
+
+  If Ax is not 0, the local upper products of the back sweep, which use final values of x, are kept in Ax and
+  only the lower part and the freshly exchanged halo columns are applied afterwards to complete Ax = A*x
+  (Eisenstat's trick).
+*/
+static int ComputeSYMGSWithTriangularSplit(const SparseMatrix & A, const Vector & r, Vector & x, Vector * Ax) {
+
+  assert(x.localLength==A.localNumberOfColumns); // Make sure x contain space for halo values
+
+#ifndef HPCG_NO_MPI
+  ExchangeHalo(A,x);
+#endif
+
+  const local_int_t nrow = A.localNumberOfRows;
+  const TriangularSplit & split = *A.triangularSplit;
+  const double * const rv = r.values;
+  double * const xv = x.values;
+  double * const work = split.work;
+
+  // Forward sweep: work = r - U*x, then (L+D)x = work
+
+#ifndef HPCG_NO_OPENMP
+  #pragma omp parallel for schedule(static)
+#endif
+  for (local_int_t i=0; i< nrow; i++) {
+    double sum = rv[i];
+    for (local_int_t j=split.upperRowStart[i]; j<split.upperRowStart[i+1]; j++)
+      sum -= split.upperValues[j] * xv[split.upperColumns[j]];
+    work[i] = sum;
+  }
+  for (local_int_t i=0; i< nrow; i++) {
+    double sum = work[i];
+    for (local_int_t j=split.lowerRowStart[i]; j<split.lowerRowStart[i+1]; j++)
+      sum -= split.lowerValues[j] * xv[split.lowerColumns[j]];
+    xv[i] = DivideByDiagonal(A, sum, i);
+  }
+
+  // Now the back sweep: work = r - L*x, then (U+D)x = work
+
+#ifndef HPCG_NO_OPENMP
+  #pragma omp parallel for schedule(static)
+#endif
+  for (local_int_t i=0; i< nrow; i++) {
+    double sum = rv[i];
+    for (local_int_t j=split.lowerRowStart[i]; j<split.lowerRowStart[i+1]; j++)
+      sum -= split.lowerValues[j] * xv[split.lowerColumns[j]];
+    work[i] = sum;
+  }
+  double * const axv = Ax!=0 ? Ax->values : 0;
+  const double * const diagonal = A.diagonalValues;
+  for (local_int_t i=nrow-1; i>=0; i--) {
+    double upperSum = 0.0, externalSum = 0.0;
+    for (local_int_t j=split.upperRowStart[i]; j<split.upperExternalStart[i]; j++)
+      upperSum += split.upperValues[j] * xv[split.upperColumns[j]];
+    for (local_int_t j=split.upperExternalStart[i]; j<split.upperRowStart[i+1]; j++)
+      externalSum += split.upperValues[j] * xv[split.upperColumns[j]];
+    xv[i] = DivideByDiagonal(A, work[i] - upperSum - externalSum, i);
+    if (axv!=0) axv[i] = upperSum + diagonal[i]*xv[i];
+  }
+
+  if (axv!=0) { // Ax = (D+U)x from the back sweep plus L*x and the halo columns with the final x
+#ifndef HPCG_NO_MPI
+    ExchangeHalo(A,x);
+#endif
+#ifndef HPCG_NO_OPENMP
+    #pragma omp parallel for schedule(static)
+#endif
+    for (local_int_t i=0; i< nrow; i++) {
+      double lowerSum = 0.0;
+      for (local_int_t j=split.lowerRowStart[i]; j<split.lowerRowStart[i+1]; j++)
+        lowerSum += split.lowerValues[j] * xv[split.lowerColumns[j]];
+      for (local_int_t j=split.upperExternalStart[i]; j<split.upperRowStart[i+1]; j++)
+        lowerSum += split.upperValues[j] * xv[split.upperColumns[j]];
+      axv[i] += lowerSum;
+    }
+  }
+
+  return 0;
+}
+#endif
+
+/*!
+  Runs the sweeps with the fastest data structures that OptimizeProblem has set up.  Inside the persistent
+  region of CG the sweeps, which are sequential, run on the master thread while the rest of the team waits.
+
+  @param[in] A the known system matrix
+  @param[in] r the input vector
+  @param[inout] x On entry, x should contain relevant values, on exit x contains the result of one symmetric GS sweep with r as the RHS.
+  @param[out] Ax If not 0, on exit contains the product of A with the updated x (requires the diagonal cache).
+
+  @return returns 0 upon success and non-zero otherwise
+*/
+static int ComputeSYMGSSweeps(const SparseMatrix & A, const Vector & r, Vector & x, Vector * Ax) {
+
+#ifdef HPCG_PERSISTENT_REGION
+  if (InPersistentRegion()) {
+    int ierr = 0;
+    isInPersistentRegion = false; // The master thread alone calls the kernels below
+    #pragma omp master
+    ierr = ComputeSYMGSSweeps(A, r, x, Ax);
+    isInPersistentRegion = true;
+    return PersistentRegionBroadcast(ierr);
+  }
+#endif
+#ifdef HPCG_SPLIT_TRIANGULAR
+  if (A.triangularSplit!=0)
+    return ComputeSYMGSWithTriangularSplit(A, r, x, Ax);
+#endif
+  if (A.diagonalValues!=0)
+    return ComputeSYMGSWithDiagonalCache(A, r, x, Ax);
+  return ComputeSYMGS_ref(A, r, x); // OptimizeProblem has not been called
+}
 
 /*!
   Routine to compute one step of symmetric Gauss-Seidel:
@@ -49,7 +270,47 @@
 */
 int ComputeSYMGS( const SparseMatrix & A, const Vector & r, Vector & x) {
 
-  // This line and the next two lines should be removed and your version of ComputeSYMGS should be used.
-  return ComputeSYMGS_ref(A, r, x);
+  HPCG_PERF_START(PERF_SYMGS+A.level);
+  double traceBegin = TraceBegin();
+  int ierr = ComputeSYMGSSweeps(A, r, x, 0);
+  TraceEnd("SYMGS", traceBegin);
+  HPCG_PERF_STOP(PERF_SYMGS+A.level);
+  return ierr;
+}
+
+/*!
+  Routine to compute one step of symmetric Gauss-Seidel followed by the matrix-vector product Ax = A*x with
+  the updated x, as needed for the residual after the last presmoother step of the V-cycle.
+
+  When OptimizeProblem has set up the diagonal cache, the product is assembled from the partial sums of
+  the back sweep, so only the entries before the diagonal and the halo columns need another pass.
+  Otherwise it is computed with ComputeSPMV. The product is summed in a different order than in
+  ComputeSPMV, so ComputeMG only uses this routine when built with HPCG_FUSED_RESIDUAL.
+
+  @param[in] A the known system matrix
+  @param[in] r the input vector
+  @param[inout] x On entry, x should contain relevant values, on exit x contains the result of one symmetric GS sweep with r as the RHS.
+  @param[out] Ax On exit contains the product of A with the updated x.
+
+  @return returns 0 upon success and non-zero otherwise
+
+  @see ComputeSYMGS
+  @see ComputeSPMV
+*/
+int ComputeSYMGSAndSPMV(const SparseMatrix & A, const Vector & r, Vector & x, Vector & Ax) {
+
+  assert(Ax.localLength>=A.localNumberOfRows);
+
+  if (A.diagonalValues==0) { // OptimizeProblem has not been called
+    int ierr = ComputeSYMGS(A, r, x);
+    if (ierr!=0) return ierr;
+    return ComputeSPMV(A, x, Ax);
+  }
 
+  HPCG_PERF_START(PERF_SYMGS+A.level);
+  double traceBegin = TraceBegin();
+  int ierr = ComputeSYMGSSweeps(A, r, x, &Ax);
+  TraceEnd("SYMGS+SPMV", traceBegin);
+  HPCG_PERF_STOP(PERF_SYMGS+A.level);
+  return ierr;
 }
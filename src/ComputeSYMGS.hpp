@@ -18,5 +18,6 @@
 #include "Vector.hpp"
 
 int ComputeSYMGS( const SparseMatrix  & A, const Vector & r, Vector & x);
+int ComputeSYMGSAndSPMV(const SparseMatrix & A, const Vector & r, Vector & x, Vector & Ax);
 
 #endif // COMPUTESYMGS_HPP
@@ -0,0 +1,80 @@
+
+//@HEADER
+// ***************************************************
+//
+// HPCG: High Performance Conjugate Gradient Benchmark
+//
+// Contact:
+// Michael A. Heroux ( maherou@sandia.gov)
+// Jack Dongarra     (dongarra@eecs.utk.edu)
+// Piotr Luszczek    (luszczek@eecs.utk.edu)
+//
+// ***************************************************
+//@HEADER
+
+/*!
+ @file ComputeSYMGSMulti.cpp
+
+ HPCG routine
+ */
+
+#ifndef HPCG_NO_MPI
+#include "ExchangeHaloMulti.hpp"
+#endif
+#include "ComputeSYMGSMulti.hpp"
+#include <cassert>
+#include <vector>
+
+/*!
+  Computes one step of symmetric Gauss-Seidel for every vector of a block, reading each matrix row
+  once per sweep for all vectors.  Makes the same assumptions about A as ComputeSYMGS_ref.
+
+  @param[in] A the known system matrix
+  @param[in] r the input block of vectors
+  @param[inout] x On entry, x should contain relevant values, on exit x contains the result of one symmetric GS sweep with r as the RHS.
+
+  @return returns 0 upon success and non-zero otherwise
+
+  @see ComputeSYMGS_ref
+*/
+int ComputeSYMGSMulti(const SparseMatrix & A, const MultiVector & r, MultiVector & x) {
+
+  assert(x.localLength==A.localNumberOfColumns); // Make sure x contain space for halo values
+  assert(x.numberOfVectors==r.numberOfVectors);
+
+#ifndef HPCG_NO_MPI
+  ExchangeHaloMulti(A, x);
+#endif
+
+  const local_int_t nrow = A.localNumberOfRows;
+  const int k = x.numberOfVectors;
+  double ** matrixDiagonal = A.matrixDiagonal;  // An array of pointers to the diagonal entries A.matrixValues
+  const double * const inverseDiagonal = A.inverseDiagonalValues; // Reciprocals of the diagonal, if set up by OptimizeProblem
+  const double * const rv = r.values;
+  double * const xv = x.values;
+  std::vector< double > sum(k);
+
+  for (local_int_t step=0; step<2*nrow; step++) {
+    local_int_t i = step<nrow ? step : 2*nrow-1-step; // Forward sweep, then back sweep
+    const double * const currentValues = A.matrixValues[i];
+    const local_int_t * const currentColIndices = A.mtxIndL[i];
+    const int currentNumberOfNonzeros = A.nonzerosInRow[i];
+    const double  currentDiagonal = A.diagonalValues ? A.diagonalValues[i] : matrixDiagonal[i][0]; // Current diagonal value
+    double * const cur_x = xv + i*k;
+
+    for (int l=0; l<k; l++) sum[l] = rv[i*k+l]; // RHS value
+    for (int j=0; j< currentNumberOfNonzeros; j++) {
+      const double a = currentValues[j];
+      const double * const col_x = xv + currentColIndices[j]*k;
+      for (int l=0; l<k; l++) sum[l] -= a*col_x[l];
+    }
+    for (int l=0; l<k; l++) sum[l] += cur_x[l]*currentDiagonal; // Remove diagonal contribution from previous loop
+    if (inverseDiagonal!=0) {
+      for (int l=0; l<k; l++) cur_x[l] = sum[l]*inverseDiagonal[i];
+    } else {
+      for (int l=0; l<k; l++) cur_x[l] = sum[l]/currentDiagonal;
+    }
+  }
+
+  return 0;
+}
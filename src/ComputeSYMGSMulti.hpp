@@ -0,0 +1,22 @@
+
+//@HEADER
+// ***************************************************
+//
+// HPCG: High Performance Conjugate Gradient Benchmark
+//
+// Contact:
+// Michael A. Heroux ( maherou@sandia.gov)
+// Jack Dongarra     (dongarra@eecs.utk.edu)
+// Piotr Luszczek    (luszczek@eecs.utk.edu)
+//
+// ***************************************************
+//@HEADER
+
+#ifndef COMPUTESYMGSMULTI_HPP
+#define COMPUTESYMGSMULTI_HPP
+#include "SparseMatrix.hpp"
+#include "MultiVector.hpp"
+
+int ComputeSYMGSMulti(const SparseMatrix & A, const MultiVector & r, MultiVector & x);
+
+#endif // COMPUTESYMGSMULTI_HPP
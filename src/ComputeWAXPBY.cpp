@@ -20,6 +20,26 @@
 
 #include "ComputeWAXPBY.hpp"
 #include "ComputeWAXPBY_ref.hpp"
+#include "PerfCounters.hpp"
+#include "PersistentRegion.hpp"
+#include "Trace.hpp"
+
+#ifdef HPCG_PERSISTENT_REGION
+/*!
+  WAXPBY for the threads of the persistent region of CG: the loop is an orphaned worksharing construct whose
+  implicit barrier makes w complete on return.
+*/
+static int ComputeWAXPBYInRegion(const local_int_t n, const double alpha, const Vector & x,
+    const double beta, const Vector & y, Vector & w) {
+
+  const double * const xv = x.values;
+  const double * const yv = y.values;
+  double * const wv = w.values;
+  #pragma omp for schedule(static)
+  for (local_int_t i=0; i<n; i++) wv[i] = alpha * xv[i] + beta * yv[i];
+  return 0;
+}
+#endif
 
 /*!
   Routine to compute the update of a vector with the sum of two
@@ -43,6 +63,19 @@ int ComputeWAXPBY(const local_int_t n, const double alpha, const Vector & x,
     const double beta, const Vector & y, Vector & w, bool & isOptimized) {
 
   // This line and the next two lines should be removed and your version of ComputeWAXPBY should be used.
-  isOptimized = false;
-  return ComputeWAXPBY_ref(n, alpha, x, beta, y, w);
+  HPCG_PERF_START(PERF_WAXPBY);
+  double traceBegin = TraceBegin();
+  int ierr;
+#ifdef HPCG_PERSISTENT_REGION
+  if (InPersistentRegion())
+    ierr = ComputeWAXPBYInRegion(n, alpha, x, beta, y, w);
+  else
+#endif
+  {
+    isOptimized = false;
+    ierr = ComputeWAXPBY_ref(n, alpha, x, beta, y, w);
+  }
+  TraceEnd("WAXPBY", traceBegin);
+  HPCG_PERF_STOP(PERF_WAXPBY);
+  return ierr;
 }
@@ -0,0 +1,59 @@
+
+//@HEADER
+// ***************************************************
+//
+// HPCG: High Performance Conjugate Gradient Benchmark
+//
+// Contact:
+// Michael A. Heroux ( maherou@sandia.gov)
+// Jack Dongarra     (dongarra@eecs.utk.edu)
+// Piotr Luszczek    (luszczek@eecs.utk.edu)
+//
+// ***************************************************
+//@HEADER
+
+/*!
+ @file ComputeWAXPBYMulti.cpp
+
+ HPCG routine
+ */
+
+#include "ComputeWAXPBYMulti.hpp"
+#ifndef HPCG_NO_OPENMP
+#include <omp.h>
+#endif
+#include <cassert>
+
+/*!
+  Routine to compute the update of a block of vectors with the sum of two scaled blocks, with one
+  pair of scalars per vector: w_j = alpha[j]*x_j + beta[j]*y_j
+
+  @param[in] n the number of vector elements (on this processor)
+  @param[in] alpha, beta arrays of numberOfVectors scalars applied to x and y respectively.
+  @param[in] x, y the input blocks of vectors
+  @param[out] w the output block of vectors.
+
+  @return returns 0 upon success and non-zero otherwise
+
+  @see ComputeWAXPBY
+*/
+int ComputeWAXPBYMulti(const local_int_t n, const double * alpha, const MultiVector & x,
+    const double * beta, const MultiVector & y, MultiVector & w) {
+
+  assert(x.localLength>=n); // Test vector lengths
+  assert(y.localLength>=n);
+  assert(x.numberOfVectors==y.numberOfVectors && x.numberOfVectors==w.numberOfVectors);
+
+  const int k = x.numberOfVectors;
+  const double * const xv = x.values;
+  const double * const yv = y.values;
+  double * const wv = w.values;
+
+#ifndef HPCG_NO_OPENMP
+  #pragma omp parallel for
+#endif
+  for (local_int_t i=0; i<n; i++)
+    for (int l=0; l<k; l++) wv[i*k+l] = alpha[l] * xv[i*k+l] + beta[l] * yv[i*k+l];
+
+  return 0;
+}
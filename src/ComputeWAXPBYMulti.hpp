@@ -0,0 +1,22 @@
+
+//@HEADER
+// ***************************************************
+//
+// HPCG: High Performance Conjugate Gradient Benchmark
+//
+// Contact:
+// Michael A. Heroux ( maherou@sandia.gov)
+// Jack Dongarra     (dongarra@eecs.utk.edu)
+// Piotr Luszczek    (luszczek@eecs.utk.edu)
+//
+// ***************************************************
+//@HEADER
+
+#ifndef COMPUTEWAXPBYMULTI_HPP
+#define COMPUTEWAXPBYMULTI_HPP
+#include "MultiVector.hpp"
+
+int ComputeWAXPBYMulti(const local_int_t n, const double * alpha, const MultiVector & x,
+    const double * beta, const MultiVector & y, MultiVector & w);
+
+#endif // COMPUTEWAXPBYMULTI_HPP
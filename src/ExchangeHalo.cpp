@@ -23,8 +23,101 @@
 #include <mpi.h>
 #include "Geometry.hpp"
 #include "ExchangeHalo.hpp"
+#include "PerfCounters.hpp"
+#include "Trace.hpp"
 #include <cstdlib>
 
+#ifdef HPCG_SHARED_HALO
+#include <sched.h>
+
+/*!
+  Waits until a flag in the shared window of the node reaches a value.
+
+  @param[in] window the shared window that holds the flag
+  @param[in] flag   the flag
+  @param[in] value  the value to wait for
+ */
+static void WaitForSharedFlag(MPI_Win window, volatile long long * flag, long long value) {
+  while (*flag<value) {
+    MPI_Win_sync(window);
+    sched_yield(); // Let the process we wait for run when cores are oversubscribed
+  }
+  MPI_Win_sync(window); // Reads of the data the flag protects happen after the flag was seen
+  return;
+}
+
+/*!
+  Halo exchange in which the values for neighbors on the same node are packed into this process' send buffer
+  in the shared window and copied from there by the neighbors, each process signalling with a counter in the
+  window; neighbors on other nodes receive messages as in ExchangeHalo.
+
+  @param[in]    A The known system matrix, with A.sharedHalo set up by SetupHalo
+  @param[inout] x On entry: the local vector entries followed by entries to be communicated; on exit: the vector with non-local entries updated by other processors
+ */
+static void ExchangeSharedHalo(const SparseMatrix & A, Vector & x) {
+
+  SharedHalo & halo = *A.sharedHalo;
+  local_int_t localNumberOfRows = A.localNumberOfRows;
+  int num_neighbors = A.numberOfSendNeighbors;
+  local_int_t * receiveLength = A.receiveLength;
+  local_int_t * sendLength = A.sendLength;
+  int * neighbors = A.neighbors;
+  double * sendBuffer = halo.sendBuffer;
+  local_int_t totalToBeSent = A.totalToBeSent;
+  local_int_t * elementsToSend = A.elementsToSend;
+  double * const xv = x.values;
+  long long exchange = ++halo.numberOfExchanges;
+
+  int MPI_MY_TAG = 99;
+  MPI_Request * request = new MPI_Request[2*num_neighbors];
+  int numberOfRequests = 0;
+
+  // Post receives from the neighbors on other nodes
+  double * x_external = xv + localNumberOfRows;
+  for (int i = 0; i < num_neighbors; i++) {
+    if (!halo.isOnNode[i])
+      MPI_Irecv(x_external, receiveLength[i], MPI_DOUBLE, neighbors[i], MPI_MY_TAG, A.geom->comm, request+numberOfRequests++);
+    x_external += receiveLength[i];
+  }
+
+  // The neighbors on this node must have read the previous values before the send buffer is reused
+  for (int i = 0; i < num_neighbors; i++)
+    if (halo.isOnNode[i]) WaitForSharedFlag(halo.window, halo.neighborFlags[i]+1, exchange-1);
+
+  for (local_int_t i=0; i<totalToBeSent; i++) sendBuffer[i] = xv[elementsToSend[i]];
+  MPI_Win_sync(halo.window);
+  halo.flags[0] = exchange;
+  MPI_Win_sync(halo.window);
+
+  // Send to the neighbors on other nodes, without blocking so that nobody waits for a flag while a send is pending
+  for (int i = 0; i < num_neighbors; i++) {
+    if (!halo.isOnNode[i])
+      MPI_Isend(sendBuffer, sendLength[i], MPI_DOUBLE, neighbors[i], MPI_MY_TAG, A.geom->comm, request+numberOfRequests++);
+    sendBuffer += sendLength[i];
+  }
+
+  // Copy from the send buffers of the neighbors on this node
+  x_external = xv + localNumberOfRows;
+  for (int i = 0; i < num_neighbors; i++) {
+    if (halo.isOnNode[i]) {
+      WaitForSharedFlag(halo.window, halo.neighborFlags[i], exchange);
+      const double * values = halo.neighborValues[i];
+      for (local_int_t j=0; j<receiveLength[i]; j++) x_external[j] = values[j];
+    }
+    x_external += receiveLength[i];
+  }
+  MPI_Win_sync(halo.window);
+  halo.flags[1] = exchange;
+  MPI_Win_sync(halo.window);
+
+  if (MPI_Waitall(numberOfRequests, request, MPI_STATUSES_IGNORE)) {
+    std::exit(-1); // TODO: have better error exit
+  }
+  delete [] request;
+  return;
+}
+#endif
+
 /*!
   Communicates data that is at the border of the part of the domain assigned to this processor.
 
@@ -33,6 +126,18 @@
  */
 void ExchangeHalo(const SparseMatrix & A, Vector & x) {
 
+  HPCG_PERF_START(PERF_HALO);
+  double traceBegin = TraceBegin();
+
+#ifdef HPCG_SHARED_HALO
+  if (A.sharedHalo!=0) {
+    ExchangeSharedHalo(A, x);
+    TraceEnd("Halo exchange", traceBegin);
+    HPCG_PERF_STOP(PERF_HALO);
+    return;
+  }
+#endif
+
   // Extract Matrix pieces
 
   local_int_t localNumberOfRows = A.localNumberOfRows;
@@ -47,8 +152,8 @@ void ExchangeHalo(const SparseMatrix & A, Vector & x) {
   double * const xv = x.values;
 
   int size, rank; // Number of MPI processes, My process ID
-  MPI_Comm_size(MPI_COMM_WORLD, &size);
-  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(A.geom->comm, &size);
+  MPI_Comm_rank(A.geom->comm, &rank);
 
   //
   //  first post receives, these are immediate receives
@@ -69,7 +174,7 @@ void ExchangeHalo(const SparseMatrix & A, Vector & x) {
   // TODO: Thread this loop
   for (int i = 0; i < num_neighbors; i++) {
     local_int_t n_recv = receiveLength[i];
-    MPI_Irecv(x_external, n_recv, MPI_DOUBLE, neighbors[i], MPI_MY_TAG, MPI_COMM_WORLD, request+i);
+    MPI_Irecv(x_external, n_recv, MPI_DOUBLE, neighbors[i], MPI_MY_TAG, A.geom->comm, request+i);
     x_external += n_recv;
   }
 
@@ -88,7 +193,7 @@ void ExchangeHalo(const SparseMatrix & A, Vector & x) {
   // TODO: Thread this loop
   for (int i = 0; i < num_neighbors; i++) {
     local_int_t n_send = sendLength[i];
-    MPI_Send(sendBuffer, n_send, MPI_DOUBLE, neighbors[i], MPI_MY_TAG, MPI_COMM_WORLD);
+    MPI_Send(sendBuffer, n_send, MPI_DOUBLE, neighbors[i], MPI_MY_TAG, A.geom->comm);
     sendBuffer += n_send;
   }
 
@@ -106,6 +211,8 @@ void ExchangeHalo(const SparseMatrix & A, Vector & x) {
 
   delete [] request;
 
+  TraceEnd("Halo exchange", traceBegin);
+  HPCG_PERF_STOP(PERF_HALO);
   return;
 }
 #endif
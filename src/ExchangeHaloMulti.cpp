@@ -0,0 +1,93 @@
+
+//@HEADER
+// ***************************************************
+//
+// HPCG: High Performance Conjugate Gradient Benchmark
+//
+// Contact:
+// Michael A. Heroux ( maherou@sandia.gov)
+// Jack Dongarra     (dongarra@eecs.utk.edu)
+// Piotr Luszczek    (luszczek@eecs.utk.edu)
+//
+// ***************************************************
+//@HEADER
+
+/*!
+ @file ExchangeHaloMulti.cpp
+
+ HPCG routine
+ */
+
+// Compile this routine only if running with MPI
+#ifndef HPCG_NO_MPI
+#include <mpi.h>
+#include "Geometry.hpp"
+#include "ExchangeHaloMulti.hpp"
+#include <cassert>
+#include <cstdlib>
+
+/*!
+  Communicates the border values of all vectors of a block in one message per neighbor: the same
+  pattern as ExchangeHalo with numberOfVectors interleaved values per exchanged entry.
+
+  @param[in]    A The known system matrix
+  @param[inout] x On entry: the local entries of the block followed by entries to be communicated; on exit: the block with non-local entries updated by other processors.
+                  The send buffer must have been allocated by InitializeMultiVectorSendBuffer.
+
+  @see ExchangeHalo
+ */
+void ExchangeHaloMulti(const SparseMatrix & A, MultiVector & x) {
+
+  local_int_t localNumberOfRows = A.localNumberOfRows;
+  int num_neighbors = A.numberOfSendNeighbors;
+  local_int_t * receiveLength = A.receiveLength;
+  local_int_t * sendLength = A.sendLength;
+  int * neighbors = A.neighbors;
+  local_int_t totalToBeSent = A.totalToBeSent;
+  local_int_t * elementsToSend = A.elementsToSend;
+  const int k = x.numberOfVectors;
+
+  double * const xv = x.values;
+
+  int MPI_MY_TAG = 99;
+
+  MPI_Request * request = new MPI_Request[num_neighbors];
+  assert(x.sendBuffer!=0); // A.sendBuffer only holds one vector
+  double * sendBuffer = x.sendBuffer;
+
+  // Externals are at end of locals
+  double * x_external = xv + localNumberOfRows*k;
+
+  // Post receives first
+  for (int i = 0; i < num_neighbors; i++) {
+    local_int_t n_recv = receiveLength[i]*k;
+    MPI_Irecv(x_external, n_recv, MPI_DOUBLE, neighbors[i], MPI_MY_TAG, A.geom->comm, request+i);
+    x_external += n_recv;
+  }
+
+  // Fill up send buffer
+  for (local_int_t i=0; i<totalToBeSent; i++)
+    for (int j=0; j<k; j++) sendBuffer[i*k+j] = xv[elementsToSend[i]*k+j];
+
+  // Send to each neighbor
+  double * curSendBuffer = sendBuffer;
+  for (int i = 0; i < num_neighbors; i++) {
+    local_int_t n_send = sendLength[i]*k;
+    MPI_Send(curSendBuffer, n_send, MPI_DOUBLE, neighbors[i], MPI_MY_TAG, A.geom->comm);
+    curSendBuffer += n_send;
+  }
+
+  // Complete the reads issued above
+  MPI_Status status;
+  for (int i = 0; i < num_neighbors; i++) {
+    if ( MPI_Wait(request+i, &status) ) {
+      std::exit(-1); // TODO: have better error exit
+    }
+  }
+
+  delete [] request;
+
+  return;
+}
+#endif
+// ifndef HPCG_NO_MPI
@@ -0,0 +1,22 @@
+
+//@HEADER
+// ***************************************************
+//
+// HPCG: High Performance Conjugate Gradient Benchmark
+//
+// Contact:
+// Michael A. Heroux ( maherou@sandia.gov)
+// Jack Dongarra     (dongarra@eecs.utk.edu)
+// Piotr Luszczek    (luszczek@eecs.utk.edu)
+//
+// ***************************************************
+//@HEADER
+
+#ifndef EXCHANGEHALOMULTI_HPP
+#define EXCHANGEHALOMULTI_HPP
+#include "SparseMatrix.hpp"
+#include "MultiVector.hpp"
+
+void ExchangeHaloMulti(const SparseMatrix & A, MultiVector & x);
+
+#endif // EXCHANGEHALOMULTI_HPP
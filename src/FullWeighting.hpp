@@ -0,0 +1,58 @@
+
+//@HEADER
+// ***************************************************
+//
+// HPCG: High Performance Conjugate Gradient Benchmark
+//
+// Contact:
+// Michael A. Heroux ( maherou@sandia.gov)
+// Jack Dongarra     (dongarra@eecs.utk.edu)
+// Piotr Luszczek    (luszczek@eecs.utk.edu)
+//
+// ***************************************************
+//@HEADER
+
+/*!
+ @file FullWeighting.hpp
+
+ HPCG data structure for the full-weighting restriction and trilinear prolongation of a multigrid level
+ */
+
+#ifndef FULLWEIGHTING_HPP
+#define FULLWEIGHTING_HPP
+
+#include "Geometry.hpp"
+
+/*!
+  The trilinear prolongation P and the full-weighting restriction R = P'/2 of a geometric coarse level in compressed
+  sparse row form (see GenerateFullWeighting).  Row i of R covers the 27-point neighborhood of the fine row that
+  coarse row i is injected from, with the weight 2^-(|dx|+|dy|+|dz|)/2; row k of P takes the coarse rows among the
+  neighbors of fine row k with the weight 2^-(|dx|+|dy|+|dz|).  Columns of R are local fine columns and those of P
+  local coarse columns, both including the halo.
+*/
+struct FullWeighting_STRUCT {
+  local_int_t * restrictionRowStart; //!< start of each coarse row in restrictionColumns and restrictionWeights
+  local_int_t * restrictionColumns; //!< fine columns of the rows of R
+  double * restrictionWeights; //!< weights of the rows of R
+  local_int_t * prolongationRowStart; //!< start of each fine row in prolongationColumns and prolongationWeights
+  local_int_t * prolongationColumns; //!< coarse columns of the rows of P
+  double * prolongationWeights; //!< weights of the rows of P
+};
+typedef struct FullWeighting_STRUCT FullWeighting;
+
+/*!
+ Deallocates the transfer operators of a multigrid level.
+
+ @param[inout] fullWeighting the data structure whose storage is deallocated
+ */
+inline void DeleteFullWeighting(FullWeighting & fullWeighting) {
+  delete [] fullWeighting.restrictionRowStart;
+  delete [] fullWeighting.restrictionColumns;
+  delete [] fullWeighting.restrictionWeights;
+  delete [] fullWeighting.prolongationRowStart;
+  delete [] fullWeighting.prolongationColumns;
+  delete [] fullWeighting.prolongationWeights;
+  return;
+}
+
+#endif // FULLWEIGHTING_HPP
@@ -22,12 +22,273 @@
 #include <omp.h>
 #endif
 
+#ifndef HPCG_NO_MPI
+#include <mpi.h>
+#endif
+
 #include <cassert>
+#include <cmath>
+#include <map>
+#include <vector>
+#include "AssembleSparseMatrix.hpp"
+#include "ExchangeHalo.hpp"
 #include "GenerateCoarseProblem.hpp"
 #include "GenerateGeometry.hpp"
 #include "GenerateProblem.hpp"
 #include "SetupHalo.hpp"
 
+/*!
+  Aggregation-based coarsening for matrices without a grid (problems read from a file): the rows of each process are
+  grouped into disjoint aggregates of connected rows, each aggregate becomes one coarse row, and the coarse operator is
+  the Galerkin product P'*Af*P of the piecewise-constant prolongation P.  Restriction sums the fine residual over an
+  aggregate and prolongation adds the coarse correction to all of its rows (see MGData::f2cOffsets).
+
+  Aggregates do not cross process boundaries, so no communication is needed to build them.  If the coarse level would
+  not reduce the problem size, or would have rows longer than nonzerosInRow can hold, no coarse level is created
+  and Af.Ac stays 0 on all processes.
+
+  @param[inout]  Af - The known system matrix, on output its coarse operator, fine-to-coarse operator and auxiliary vectors will be defined.
+*/
+static void GenerateCoarseProblemByAggregation(const SparseMatrix & Af) {
+
+  local_int_t nf = Af.localNumberOfRows;
+  std::vector< local_int_t > aggregate(nf, -1);
+  local_int_t nc = 0;
+
+  // Pass 1: rows whose local neighbors are all free start a new aggregate with these neighbors
+  for (local_int_t i=0; i< nf; ++i) {
+    if (aggregate[i]>=0) continue;
+    bool isFree = true;
+    for (int j=0; j< Af.nonzerosInRow[i] && isFree; ++j) {
+      local_int_t col = Af.mtxIndL[i][j];
+      if (col<nf && aggregate[col]>=0) isFree = false;
+    }
+    if (!isFree) continue;
+    aggregate[i] = nc;
+    for (int j=0; j< Af.nonzerosInRow[i]; ++j) {
+      local_int_t col = Af.mtxIndL[i][j];
+      if (col<nf) aggregate[col] = nc;
+    }
+    ++nc;
+  }
+  // Pass 2: remaining rows join the aggregate of a neighbor
+  for (local_int_t i=0; i< nf; ++i) {
+    if (aggregate[i]>=0) continue;
+    for (int j=0; j< Af.nonzerosInRow[i] && aggregate[i]<0; ++j) {
+      local_int_t col = Af.mtxIndL[i][j];
+      if (col<nf && aggregate[col]>=0) aggregate[i] = aggregate[col];
+    }
+    if (aggregate[i]<0) aggregate[i] = nc++; // Pass 3: rows without local neighbors stay alone
+  }
+
+  // Group the fine rows by aggregate
+  local_int_t * f2cOffsets = new local_int_t[nc+1];
+  local_int_t * f2cOperator = new local_int_t[nf];
+  for (local_int_t i=0; i<=nc; ++i) f2cOffsets[i] = 0;
+  for (local_int_t i=0; i< nf; ++i) ++f2cOffsets[aggregate[i]+1];
+  for (local_int_t i=0; i< nc; ++i) f2cOffsets[i+1] += f2cOffsets[i];
+  std::vector< local_int_t > next(f2cOffsets, f2cOffsets+nc);
+  for (local_int_t i=0; i< nf; ++i) f2cOperator[next[aggregate[i]]++] = i;
+
+  Geometry * geomc = new Geometry;
+#ifndef HPCG_NO_MPI
+  geomc->comm = Af.geom->comm;
+#endif
+  GenerateRowGeometry(Af.geom->size, Af.geom->rank, Af.geom->numThreads, nc, geomc);
+
+  // Global coarse ids of the fine columns, including the ones owned by neighbors
+  Vector coarseIds;
+  InitializeVector(coarseIds, Af.localNumberOfColumns);
+  for (local_int_t i=0; i< nf; ++i) coarseIds.values[i] = geomc->rowOffsets[geomc->rank] + aggregate[i];
+#ifndef HPCG_NO_MPI
+  ExchangeHalo(Af, coarseIds);
+#endif
+
+  // Galerkin product: sum the entries of all rows of an aggregate by coarse column
+  std::vector< local_int_t > rowStart(1, 0);
+  std::vector< global_int_t > columnIndices;
+  std::vector< double > values;
+  for (local_int_t ic=0; ic< nc; ++ic) {
+    std::map< global_int_t, double > row;
+    for (local_int_t k=f2cOffsets[ic]; k<f2cOffsets[ic+1]; ++k) {
+      local_int_t i = f2cOperator[k];
+      for (int j=0; j< Af.nonzerosInRow[i]; ++j)
+        row[(global_int_t) coarseIds.values[Af.mtxIndL[i][j]]] += Af.matrixValues[i][j];
+    }
+    for (std::map< global_int_t, double >::iterator it = row.begin(); it != row.end(); ++it) {
+      columnIndices.push_back(it->first);
+      values.push_back(it->second);
+    }
+    rowStart.push_back(columnIndices.size());
+  }
+  DeleteVector(coarseIds);
+
+  SparseMatrix * Ac = new SparseMatrix;
+  InitializeSparseMatrix(*Ac, geomc);
+  Ac->level = Af.level+1;
+  int ierr = (geomc->rowOffsets[geomc->size]==Af.totalNumberOfRows) ? -1 : 0; // Coarsening stalled
+  if (ierr==0) ierr = AssembleSparseMatrix(*Ac, rowStart, columnIndices, values);
+  if (ierr) {
+    delete [] f2cOffsets;
+    delete [] f2cOperator;
+    DeleteGeometry(*geomc); // Nothing else was allocated
+    delete geomc;
+    delete Ac;
+    return;
+  }
+  SetupHalo(*Ac);
+
+  Vector *rc = new Vector;
+  Vector *xc = new Vector;
+  Vector * Axf = new Vector;
+  InitializeVector(*rc, Ac->localNumberOfRows);
+  InitializeVector(*xc, Ac->localNumberOfColumns);
+  InitializeVector(*Axf, Af.localNumberOfColumns);
+  Af.Ac = Ac;
+  MGData * mgData = new MGData;
+  InitializeMGData(f2cOperator, rc, xc, Axf, *mgData);
+  mgData->f2cOffsets = f2cOffsets;
+  Af.mgData = mgData;
+
+  return;
+}
+
+#ifdef HPCG_AGGLOMERATION_THRESHOLD
+/*!
+  Chooses the blocks of the fine process grid whose coarse rows are agglomerated onto one process: 2 processes in
+  every dimension with an even number of processes once the coarse level would have fewer than
+  HPCG_AGGLOMERATION_THRESHOLD rows per process, and 1 (no agglomeration) otherwise.  The choice depends on global
+  values only, so all processes make the same one.
+
+  @param[in]  geomf the geometry of the fine level, with the same nz on all processes
+  @param[out] fx, fy, fz number of processes of a block in each dimension
+*/
+static void ChooseAgglomeration(const Geometry & geomf, int & fx, int & fy, int & fz) {
+  fx = fy = fz = 1;
+  global_int_t localNumberOfCoarseRows = (geomf.gnx/geomf.npx/2)*(geomf.gny/geomf.npy/2)*(geomf.gnz/geomf.npz/2);
+  if (localNumberOfCoarseRows>=HPCG_AGGLOMERATION_THRESHOLD) return;
+  if (geomf.npx%2==0) fx = 2;
+  if (geomf.npy%2==0) fy = 2;
+  if (geomf.npz%2==0) fz = 2;
+  return;
+}
+
+/*!
+  Generates the geometry of the coarse level of a fine level with the same nz on all processes, on a process grid
+  that is coarser by fx, fy and fz.  The first process of every block of the fine grid owns the coarse rows of the
+  block and the other processes of the block own none (nx, ny and nz are 0); processes that own no fine rows own no
+  coarse rows either.  The coarse geometry lists the owning processes in processRanks.
+
+  @param[in]  geomf the geometry of the fine level
+  @param[in]  fx, fy, fz number of processes agglomerated in each dimension (see ChooseAgglomeration)
+  @param[inout] geomc the geometry of the coarse level (with MPI, geomc->comm must be set on entry)
+*/
+static void GenerateAgglomeratedGeometry(const Geometry & geomf, int fx, int fy, int fz, Geometry * geomc) {
+
+  int npx = geomf.npx/fx;
+  int npy = geomf.npy/fy;
+  int npz = geomf.npz/fz;
+  global_int_t gnx = geomf.gnx/2;
+  global_int_t gny = geomf.gny/2;
+  global_int_t gnz = geomf.gnz/2;
+  local_int_t nx = gnx/npx; // Local dimensions of the processes that own rows
+  local_int_t ny = gny/npy;
+  local_int_t nz = gnz/npz;
+  bool isOwner = geomf.nx>0 && geomf.ipx%fx==0 && geomf.ipy%fy==0 && geomf.ipz%fz==0;
+
+  geomc->size = geomf.size;
+  geomc->rank = geomf.rank;
+  geomc->numThreads = geomf.numThreads;
+  geomc->nx = isOwner ? nx : 0;
+  geomc->ny = isOwner ? ny : 0;
+  geomc->nz = isOwner ? nz : 0;
+  geomc->npx = npx;
+  geomc->npy = npy;
+  geomc->npz = npz;
+  geomc->pz = 0;
+  geomc->npartz = 1;
+  geomc->partz_ids = new int[1];
+  geomc->partz_nz = new local_int_t[1];
+  geomc->partz_ids[0] = npz;
+  geomc->partz_nz[0] = nz;
+  geomc->ipx = isOwner ? geomf.ipx/fx : 0;
+  geomc->ipy = isOwner ? geomf.ipy/fy : 0;
+  geomc->ipz = isOwner ? geomf.ipz/fz : 0;
+  geomc->gnx = gnx;
+  geomc->gny = gny;
+  geomc->gnz = gnz;
+  geomc->gix0 = geomc->ipx*geomc->nx;
+  geomc->giy0 = geomc->ipy*geomc->ny;
+  geomc->giz0 = geomc->ipz*geomc->nz;
+  geomc->rowOffsets = 0;
+  geomc->processRanks = 0;
+  if (geomf.processRanks!=0 || fx*fy*fz>1) { // The owners are not the first processes in lexicographic order
+    geomc->processRanks = new int[npx*npy*npz];
+    for (int ipz=0; ipz<npz; ++ipz)
+      for (int ipy=0; ipy<npy; ++ipy)
+        for (int ipx=0; ipx<npx; ++ipx) {
+          int finePosition = ipx*fx + ipy*fy*geomf.npx + ipz*fz*geomf.npx*geomf.npy;
+          geomc->processRanks[ipx+ipy*npx+ipz*npx*npy] = geomf.processRanks ? geomf.processRanks[finePosition] : finePosition;
+        }
+  }
+  return;
+}
+
+/*!
+  Sets up the gather and scatter of the coarse rows of a block of fx by fy by fz fine processes on the first process
+  of the block (see GenerateAgglomeratedGeometry).  Every process of the block computes a share of nxs by nys by nzs
+  coarse rows; the root places the share of the process at offset (dx,dy,dz) in the block at the same offset
+  in its coarse grid.
+
+  @param[in] geomf the geometry of the fine level
+  @param[in] fx, fy, fz number of processes agglomerated in each dimension
+  @param[in] nxs, nys, nzs dimensions of the share of every process
+
+  @return the agglomeration data of this process
+*/
+static Agglomeration * SetupAgglomeration(const Geometry & geomf, int fx, int fy, int fz, local_int_t nxs, local_int_t nys, local_int_t nzs) {
+
+  Agglomeration * agglomeration = new Agglomeration;
+  const local_int_t shareLength = nxs*nys*nzs;
+  int dx = geomf.ipx%fx;
+  int dy = geomf.ipy%fy;
+  int dz = geomf.ipz%fz;
+  int rootPosition = (geomf.ipx-dx) + (geomf.ipy-dy)*geomf.npx + (geomf.ipz-dz)*geomf.npx*geomf.npy;
+  agglomeration->shareLength = shareLength;
+  agglomeration->rootRank = geomf.processRanks ? geomf.processRanks[rootPosition] : rootPosition;
+  agglomeration->numberOfMembers = 0;
+  agglomeration->memberRanks = 0;
+  agglomeration->memberRows = 0;
+  if (dx==0 && dy==0 && dz==0) {
+    int numberOfMembers = fx*fy*fz;
+    local_int_t nxc = fx*nxs; // Coarse grid of the root
+    local_int_t nyc = fy*nys;
+    agglomeration->numberOfMembers = numberOfMembers;
+    agglomeration->memberRanks = new int[numberOfMembers];
+    agglomeration->memberRows = new local_int_t[numberOfMembers*shareLength];
+    for (int mz=0; mz<fz; ++mz)
+      for (int my=0; my<fy; ++my)
+        for (int mx=0; mx<fx; ++mx) {
+          int m = mx + my*fx + mz*fx*fy;
+          int position = rootPosition + mx + my*geomf.npx + mz*geomf.npx*geomf.npy;
+          agglomeration->memberRanks[m] = geomf.processRanks ? geomf.processRanks[position] : position;
+          local_int_t * rows = agglomeration->memberRows+m*shareLength;
+          for (local_int_t iz=0; iz<nzs; ++iz)
+            for (local_int_t iy=0; iy<nys; ++iy)
+              for (local_int_t ix=0; ix<nxs; ++ix)
+                rows[(iz*nys+iy)*nxs+ix] = ((mz*nzs+iz)*nyc + my*nys+iy)*nxc + mx*nxs+ix;
+        }
+  }
+  agglomeration->buffer = 0;
+  agglomeration->bufferVectors = 0;
+  GetAgglomerationShare(*agglomeration, 1);
+#ifndef HPCG_NO_MPI
+  agglomeration->requests = new MPI_Request[agglomeration->numberOfMembers>0 ? agglomeration->numberOfMembers : 1];
+#endif
+  return agglomeration;
+}
+#endif
+
 /*!
   Routine to construct a prolongation/restriction operator for a given fine grid matrix
   solution (as computed by a direct solver).
@@ -36,10 +297,22 @@
 
   Note that the matrix Af is considered const because the attributes we are modifying are declared as mutable.
 
+  Matrices read from a file have no grid to coarsen; for them the coarse level is built by aggregation
+  and may be omitted (Af.Ac is 0 on return) when coarsening no longer pays off.
+
+  With HPCG_AGGLOMERATION_THRESHOLD, a coarse level with fewer rows per process than the threshold is agglomerated
+  onto one process per 2x2x2 block of the process grid (see ChooseAgglomeration), which cuts the number of messages
+  and their latency on the coarsest levels.  The other processes of a block keep no rows on this and all coarser
+  levels; MGData::agglomeration holds the gather and scatter used by the restriction and the prolongation.
 */
 
 void GenerateCoarseProblem(const SparseMatrix & Af) {
 
+  if (Af.geom->rowOffsets!=0) {
+    GenerateCoarseProblemByAggregation(Af);
+    return;
+  }
+
   // Make local copies of geometry information.  Use global_int_t since the RHS products in the calculations
   // below may result in global range values.
   global_int_t nxf = Af.geom->nx;
@@ -52,7 +325,7 @@ void GenerateCoarseProblem(const SparseMatrix & Af) {
   local_int_t * f2cOperator = new local_int_t[Af.localNumberOfRows];
   local_int_t localNumberOfRows = nxc*nyc*nzc; // This is the size of our subblock
   // If this assert fails, it most likely means that the local_int_t is set to int and should be set to long long
-  assert(localNumberOfRows>0); // Throw an exception of the number of rows is less than zero (can happen if "int" overflows)
+  assert(localNumberOfRows>0 || nxf==0); // Throw an exception of the number of rows is less than zero (can happen if "int" overflows)
 
   // Use a parallel loop to do initial assignment:
   // distributes the physical placement of arrays of pointers across the memory system
@@ -83,6 +356,9 @@ void GenerateCoarseProblem(const SparseMatrix & Af) {
 
   // Construct the geometry and linear system
   Geometry * geomc = new Geometry;
+#ifndef HPCG_NO_MPI
+  geomc->comm = Af.geom->comm;
+#endif
   local_int_t zlc = 0; // Coarsen nz for the lower block in the z processor dimension
   local_int_t zuc = 0; // Coarsen nz for the upper block in the z processor dimension
   int pz = Af.geom->pz;
@@ -90,10 +366,18 @@ void GenerateCoarseProblem(const SparseMatrix & Af) {
     zlc = Af.geom->partz_nz[0]/2; // Coarsen nz for the lower block in the z processor dimension
     zuc = Af.geom->partz_nz[1]/2; // Coarsen nz for the upper block in the z processor dimension
   }
-  GenerateGeometry(Af.geom->size, Af.geom->rank, Af.geom->numThreads, Af.geom->pz, zlc, zuc, nxc, nyc, nzc, Af.geom->npx, Af.geom->npy, Af.geom->npz, geomc);
+#ifdef HPCG_AGGLOMERATION_THRESHOLD
+  int fx = 1, fy = 1, fz = 1; // Number of processes whose coarse rows are agglomerated, in each dimension
+  if (pz==0) {
+    ChooseAgglomeration(*Af.geom, fx, fy, fz);
+    GenerateAgglomeratedGeometry(*Af.geom, fx, fy, fz, geomc);
+  } else
+#endif
+  GenerateGeometry(Af.geom->size, Af.geom->rank, Af.geom->numThreads, Af.geom->pz, zlc, zuc, nxc, nyc, nzc, Af.geom->npx, Af.geom->npy, Af.geom->npz, Af.geom->processRanks, geomc);
 
   SparseMatrix * Ac = new SparseMatrix;
   InitializeSparseMatrix(*Ac, geomc);
+  Ac->level = Af.level+1;
   GenerateProblem(*Ac, 0, 0, 0);
   SetupHalo(*Ac);
   Vector *rc = new Vector;
@@ -105,7 +389,100 @@ void GenerateCoarseProblem(const SparseMatrix & Af) {
   Af.Ac = Ac;
   MGData * mgData = new MGData;
   InitializeMGData(f2cOperator, rc, xc, Axf, *mgData);
+#ifdef HPCG_AGGLOMERATION_THRESHOLD
+  if (fx*fy*fz>1 && nxf>0) mgData->agglomeration = SetupAgglomeration(*Af.geom, fx, fy, fz, nxc, nyc, nzc);
+#endif
   Af.mgData = mgData;
 
   return;
 }
+
+/*!
+  Returns the weight 2^-(|dx|+|dy|+|dz|) of the trilinear interpolation between two points of a grid.
+
+  @param[in] row, column global indices of the two points
+  @param[in] gnx, gny global dimensions of the grid in x and y
+*/
+static double TrilinearWeight(global_int_t row, global_int_t column, global_int_t gnx, global_int_t gny) {
+  global_int_t dx = column%gnx - row%gnx;
+  global_int_t dy = (column/gnx)%gny - (row/gnx)%gny;
+  global_int_t dz = column/(gnx*gny) - row/(gnx*gny);
+  int distance = (dx<0 ? -dx : dx) + (dy<0 ? -dy : dy) + (dz<0 ? -dz : dz);
+  return std::ldexp(1.0, -distance);
+}
+
+/*!
+  Replaces the injection between a geometric level and its coarse level by full-weighting restriction and trilinear
+  prolongation (see FullWeighting).  Both operators are built from the 27-point neighborhoods in the rows of Af, so
+  the restriction reads the fine residual in the halo of Af and the prolongation reads the coarse correction in the
+  halo of Af.Ac.  The restriction is half the transpose of the prolongation, which keeps the V-cycle symmetric and
+  matches the scaling of the rediscretized coarse operator.  Aggregation-based and agglomerated coarse levels keep
+  their own transfer.
+
+  @param[inout] Af the matrix of the level, with its coarse level generated by GenerateCoarseProblem
+*/
+void GenerateFullWeighting(const SparseMatrix & Af) {
+
+  MGData * mgData = Af.mgData;
+  if (mgData==0 || mgData->fullWeighting!=0 || Af.geom->rowOffsets!=0) return;
+  const Geometry & geomf = *Af.geom;
+  const Geometry & geomc = *Af.Ac->geom;
+  if (geomc.npx*geomc.npy*geomc.npz<geomf.npx*geomf.npy*geomf.npz) return; // Agglomerated
+  const global_int_t gnx = geomf.gnx, gny = geomf.gny;
+  const global_int_t gnxc = geomc.gnx, gnyc = geomc.gny;
+  const local_int_t nf = Af.localNumberOfRows;
+  const local_int_t nc = Af.Ac->localNumberOfRows;
+  const local_int_t * f2c = mgData->f2cOperator;
+  FullWeighting * fullWeighting = new FullWeighting;
+
+  // Restriction: the neighborhood of the injected fine row
+  local_int_t * restrictionRowStart = new local_int_t[nc+1];
+  restrictionRowStart[0] = 0;
+  for (local_int_t i=0; i<nc; ++i) restrictionRowStart[i+1] = restrictionRowStart[i] + Af.nonzerosInRow[f2c[i]];
+  local_int_t * restrictionColumns = new local_int_t[restrictionRowStart[nc]];
+  double * restrictionWeights = new double[restrictionRowStart[nc]];
+#ifndef HPCG_NO_OPENMP
+  #pragma omp parallel for
+#endif
+  for (local_int_t i=0; i<nc; ++i) {
+    local_int_t f = f2c[i];
+    for (int j=0; j<Af.nonzerosInRow[f]; ++j) {
+      restrictionColumns[restrictionRowStart[i]+j] = Af.mtxIndL[f][j];
+      restrictionWeights[restrictionRowStart[i]+j] = 0.5*TrilinearWeight(Af.localToGlobalMap[f], Af.mtxIndG[f][j], gnx, gny);
+    }
+  }
+
+  // Local index of every coarse point in the rows of Ac, including its halo
+  GlobalToLocalMap coarseToLocal;
+  for (local_int_t i=0; i<nc; ++i)
+    for (int j=0; j<Af.Ac->nonzerosInRow[i]; ++j)
+      coarseToLocal[Af.Ac->mtxIndG[i][j]] = Af.Ac->mtxIndL[i][j];
+
+  // Prolongation: the neighbors of each fine row that are coarse grid points (even coordinates)
+  local_int_t * prolongationRowStart = new local_int_t[nf+1];
+  std::vector< local_int_t > prolongationColumns;
+  std::vector< double > prolongationWeights;
+  prolongationRowStart[0] = 0;
+  for (local_int_t k=0; k<nf; ++k) {
+    for (int j=0; j<Af.nonzerosInRow[k]; ++j) {
+      global_int_t column = Af.mtxIndG[k][j];
+      global_int_t ix = column%gnx, iy = (column/gnx)%gny, iz = column/(gnx*gny);
+      if (ix%2!=0 || iy%2!=0 || iz%2!=0) continue;
+      GlobalToLocalMap::const_iterator coarse = coarseToLocal.find(ix/2 + (iy/2)*gnxc + (iz/2)*gnxc*gnyc);
+      assert(coarse!=coarseToLocal.end()); // Coarse points next to this process are in the halo of Ac
+      prolongationColumns.push_back(coarse->second);
+      prolongationWeights.push_back(TrilinearWeight(Af.localToGlobalMap[k], column, gnx, gny));
+    }
+    prolongationRowStart[k+1] = prolongationColumns.size();
+  }
+  fullWeighting->restrictionRowStart = restrictionRowStart;
+  fullWeighting->restrictionColumns = restrictionColumns;
+  fullWeighting->restrictionWeights = restrictionWeights;
+  fullWeighting->prolongationRowStart = prolongationRowStart;
+  fullWeighting->prolongationColumns = new local_int_t[prolongationColumns.size()];
+  fullWeighting->prolongationWeights = new double[prolongationWeights.size()];
+  std::copy(prolongationColumns.begin(), prolongationColumns.end(), fullWeighting->prolongationColumns);
+  std::copy(prolongationWeights.begin(), prolongationWeights.end(), fullWeighting->prolongationWeights);
+  mgData->fullWeighting = fullWeighting;
+  return;
+}
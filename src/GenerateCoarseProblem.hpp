@@ -17,4 +17,5 @@
 #include "SparseMatrix.hpp"
 
 void GenerateCoarseProblem(const SparseMatrix & A);
+void GenerateFullWeighting(const SparseMatrix & Af);
 #endif // GENERATECOARSEPROBLEM_HPP
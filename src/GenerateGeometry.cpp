@@ -18,6 +18,10 @@
  HPCG routine
  */
 
+#ifndef HPCG_NO_MPI
+#include <mpi.h>
+#endif
+
 #include <cmath>
 #include <cstdlib>
 #include <cassert>
@@ -44,12 +48,16 @@ using std::endl;
   @param[in]  numThreads number of OpenMP threads in this process
   @param[in]  pz z-dimension processor ID where second zone of nz values start
   @param[in]  nx, ny, nz number of grid points for each local block in the x, y, and z dimensions, respectively
-  @param[out] geom data structure that will store the above parameters and the factoring of total number of processes into three dimensions
+  @param[in]  npx, npy, npz the process grid (computed if their product is not between 1 and size)
+  @param[in]  processRanks 0, or the rank of the process at each position of the process grid (copied into geom, see ComputeNodeAwareProcessGrid)
+  @param[inout] geom data structure that will store the above parameters and the factoring of total number of processes into three dimensions
+                    (with MPI, geom->comm must be set on entry)
 */
 void GenerateGeometry(int size, int rank, int numThreads,
   int pz, local_int_t zl, local_int_t zu,
   local_int_t nx, local_int_t ny, local_int_t nz,
   int npx, int npy, int npz,
+  const int * processRanks,
   Geometry * geom)
 {
 
@@ -83,9 +91,18 @@ void GenerateGeometry(int size, int rank, int numThreads,
   }
 
   // Now compute this process's indices in the 3D cube
-  int ipz = rank/(npx*npy);
-  int ipy = (rank-ipz*npx*npy)/npx;
-  int ipx = rank%npx;
+  int position = rank;
+  int * ranks = 0;
+  if (processRanks!=0) { // Placement of the ranks given by the caller
+    ranks = new int[size];
+    for (int i=0; i<size; ++i) {
+      ranks[i] = processRanks[i];
+      if (ranks[i]==rank) position = i;
+    }
+  }
+  int ipz = position/(npx*npy);
+  int ipy = (position-ipz*npx*npy)/npx;
+  int ipx = position%npx;
 
 #ifdef HPCG_DEBUG
   if (rank==0)
@@ -164,6 +181,67 @@ void GenerateGeometry(int size, int rank, int numThreads,
   geom->gix0 = gix0;
   geom->giy0 = giy0;
   geom->giz0 = giz0;
+  geom->rowOffsets = 0; // Row ownership follows the process grid
+  geom->processRanks = ranks;
+
+  return;
+}
+
+/*!
+  Stores the parallel parameters of a run whose matrix rows are distributed in contiguous
+  blocks (problems read from a file and their aggregation-based coarse levels) in the geometry
+  data structure.  The rows are treated as a one-dimensional grid with one block per process,
+  so that the grid dimensions reported for the run remain meaningful.
+
+  @param[in]  size total number of MPI processes
+  @param[in]  rank this process' rank among other MPI processes
+  @param[in]  numThreads number of OpenMP threads in this process
+  @param[in]  localNumberOfRows number of matrix rows owned by this process
+  @param[inout] geom data structure that will store the above parameters and the first global row of every process
+                    (with MPI, geom->comm must be set on entry)
+
+  @see ComputeRankOfMatrixRow
+*/
+void GenerateRowGeometry(int size, int rank, int numThreads, local_int_t localNumberOfRows, Geometry * geom) {
+
+  long long * rowCounts = new long long[size];
+  long long localCount = localNumberOfRows;
+#ifndef HPCG_NO_MPI
+  MPI_Allgather(&localCount, 1, MPI_LONG_LONG_INT, rowCounts, 1, MPI_LONG_LONG_INT, geom->comm);
+#else
+  rowCounts[0] = localCount;
+#endif
+  global_int_t * rowOffsets = new global_int_t[size+1];
+  rowOffsets[0] = 0;
+  for (int i=0; i<size; ++i) rowOffsets[i+1] = rowOffsets[i] + rowCounts[i];
+  delete [] rowCounts;
+
+  geom->size = size;
+  geom->rank = rank;
+  geom->numThreads = numThreads;
+  geom->nx = localNumberOfRows;
+  geom->ny = 1;
+  geom->nz = 1;
+  geom->npx = size;
+  geom->npy = 1;
+  geom->npz = 1;
+  geom->pz = 0;
+  geom->npartz = 1;
+  geom->partz_ids = new int[1];
+  geom->partz_nz = new local_int_t[1];
+  geom->partz_ids[0] = 1;
+  geom->partz_nz[0] = 1;
+  geom->ipx = rank;
+  geom->ipy = 0;
+  geom->ipz = 0;
+  geom->gnx = rowOffsets[size];
+  geom->gny = 1;
+  geom->gnz = 1;
+  geom->gix0 = rowOffsets[rank];
+  geom->giy0 = 0;
+  geom->giz0 = 0;
+  geom->rowOffsets = rowOffsets;
+  geom->processRanks = 0;
 
   return;
 }
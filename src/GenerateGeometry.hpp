@@ -15,5 +15,6 @@
 #ifndef GENERATEGEOMETRY_HPP
 #define GENERATEGEOMETRY_HPP
 #include "Geometry.hpp"
-void GenerateGeometry(int size, int rank, int numThreads, int pz, local_int_t zl, local_int_t zu, local_int_t nx, local_int_t ny, local_int_t nz, int npx, int npy, int npz, Geometry * geom);
+void GenerateGeometry(int size, int rank, int numThreads, int pz, local_int_t zl, local_int_t zu, local_int_t nx, local_int_t ny, local_int_t nz, int npx, int npy, int npz, const int * processRanks, Geometry * geom);
+void GenerateRowGeometry(int size, int rank, int numThreads, local_int_t localNumberOfRows, Geometry * geom);
 #endif // GENERATEGEOMETRY_HPP
@@ -29,6 +29,51 @@
 #include "GenerateProblem.hpp"
 #include "GenerateProblem_ref.hpp"
 
+/*!
+  Generates the matrix of a process that owns no rows of a coarse level, because the level is agglomerated onto
+  fewer processes (see GenerateCoarseProblem).  The process takes part in the reduction of GenerateProblem_ref that
+  counts the nonzeros of the other processes.
+
+  @param[inout] A The system matrix, with its geometry set
+  @param[inout] b, x, xexact Vectors allocated with no entries (if non-zero on entry)
+*/
+static void GenerateEmptyProblem(SparseMatrix & A, Vector * b, Vector * x, Vector * xexact) {
+
+  global_int_t totalNumberOfNonzeros = 0;
+#ifndef HPCG_NO_MPI
+#ifdef HPCG_NO_LONG_LONG
+  local_int_t localNumberOfNonzeros = 0;
+  MPI_Allreduce(&localNumberOfNonzeros, &totalNumberOfNonzeros, 1, MPI_INT, MPI_SUM, A.geom->comm);
+#else
+  long long lnnz = 0, gnnz = 0; // convert to 64 bit for MPI call
+  MPI_Allreduce(&lnnz, &gnnz, 1, MPI_LONG_LONG_INT, MPI_SUM, A.geom->comm);
+  totalNumberOfNonzeros = gnnz; // Copy back
+#endif
+#endif
+
+  if (b!=0) InitializeVector(*b, 0);
+  if (x!=0) InitializeVector(*x, 0);
+  if (xexact!=0) InitializeVector(*xexact, 0);
+
+  A.title = 0;
+  A.totalNumberOfRows = A.geom->gnx*A.geom->gny*A.geom->gnz;
+  A.totalNumberOfNonzeros = totalNumberOfNonzeros;
+  A.localNumberOfRows = 0;
+  A.localNumberOfColumns = 0;
+  A.localNumberOfNonzeros = 0;
+  A.nonzerosInRow = new char[1];
+  // One null row pointer, so that DeleteMatrix works with and without HPCG_CONTIGUOUS_ARRAYS
+  A.mtxIndG = new global_int_t*[1];
+  A.mtxIndL = new local_int_t*[1];
+  A.matrixValues = new double*[1];
+  A.matrixDiagonal = new double*[1];
+  A.mtxIndG[0] = 0;
+  A.mtxIndL[0] = 0;
+  A.matrixValues[0] = 0;
+  A.matrixDiagonal[0] = 0;
+  return;
+}
+
 
 /*!
   Routine to generate a sparse matrix, right hand side, initial guess, and exact solution.
@@ -48,5 +93,6 @@ void GenerateProblem(SparseMatrix & A, Vector * b, Vector * x, Vector * xexact)
   // Furthermore, any code must work for general unstructured sparse matrices.  Special knowledge about the
   // specific nature of the sparsity pattern may not be explicitly used.
 
+  if (A.geom->nx==0) return(GenerateEmptyProblem(A, b, x, xexact)); // Idle process of an agglomerated coarse level
   return(GenerateProblem_ref(A, b, x, xexact));
 }
@@ -21,6 +21,11 @@
 #ifndef GEOMETRY_HPP
 #define GEOMETRY_HPP
 
+#include <algorithm>
+#ifndef HPCG_NO_MPI
+#include <mpi.h>
+#endif
+
 /*!
   This defines the type for integers that have local subdomain dimension.
 
@@ -45,6 +50,9 @@ typedef long long global_int_t;
   This is a data structure to contain all processor geometry information
 */
 struct Geometry_STRUCT {
+#ifndef HPCG_NO_MPI
+  MPI_Comm comm; //!< Communicator of the processes sharing this problem (set by the caller before GenerateGeometry)
+#endif
   int size; //!< Number of MPI processes
   int rank; //!< This process' rank in the range [0 to size - 1]
   int numThreads; //!< This process' number of threads
@@ -67,6 +75,8 @@ struct Geometry_STRUCT {
   global_int_t gix0;  //!< Base global x index for this rank in the npx by npy by npz processor grid
   global_int_t giy0;  //!< Base global y index for this rank in the npx by npy by npz processor grid
   global_int_t giz0;  //!< Base global z index for this rank in the npx by npy by npz processor grid
+  global_int_t * rowOffsets; //!< For problems read from a file: array of length size+1 with the first global row of each rank (0 for generated problems)
+  int * processRanks; //!< Rank of the process at position ipx+ipy*npx+ipz*npx*npy of the processor grid (0 if ranks follow this order)
 
 };
 typedef struct Geometry_STRUCT Geometry;
@@ -81,6 +91,10 @@ typedef struct Geometry_STRUCT Geometry;
   @return Returns the MPI rank of the process assigned the row
 */
 inline int ComputeRankOfMatrixRow(const Geometry & geom, global_int_t index) {
+  // Rows of a problem read from a file are distributed in contiguous blocks
+  if (geom.rowOffsets!=0)
+    return (int) (std::upper_bound(geom.rowOffsets, geom.rowOffsets+geom.size+1, index) - geom.rowOffsets) - 1;
+
   global_int_t gnx = geom.gnx;
   global_int_t gny = geom.gny;
 
@@ -112,6 +126,7 @@ inline int ComputeRankOfMatrixRow(const Geometry & geom, global_int_t index) {
   int ipy = iy/geom.ny;
   int ipx = ix/geom.nx;
   int rank = ipx+ipy*geom.npx+ipz*geom.npy*geom.npx;
+  if (geom.processRanks!=0) rank = geom.processRanks[rank]; // Node-aware placement, see ComputeNodeAwareProcessGrid
   return rank;
 }
 
@@ -125,6 +140,8 @@ inline void DeleteGeometry(Geometry & geom) {
 
   delete [] geom.partz_nz;
   delete [] geom.partz_ids;
+  delete [] geom.rowOffsets;
+  delete [] geom.processRanks;
 
   return;
 }
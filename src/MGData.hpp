@@ -22,16 +22,63 @@
 #define MGDATA_HPP
 
 #include <cassert>
+#include "Agglomeration.hpp"
+#include "FullWeighting.hpp"
 #include "SparseMatrix.hpp"
 #include "Vector.hpp"
 
+//! Phases of the multigrid cycle on one level, used to index MGData::times
+enum MGPhase {
+  MG_PRESMOOTH = 0,    //!< pre-smoothing sweeps
+  MG_RESIDUAL = 1,     //!< residual SpMV
+  MG_RESTRICTION = 2,  //!< restriction of the residual to the coarse level
+  MG_COARSE_SOLVE = 3, //!< recursive cycles on the coarse level (includes all coarser levels)
+  MG_PROLONGATION = 4, //!< prolongation of the coarse correction
+  MG_POSTSMOOTH = 5,   //!< post-smoothing sweeps
+  MG_NUMBER_OF_PHASES = 6
+};
+
+//! Recursion of the multigrid cycle, see GetCoarseVisits
+enum MGCycle {
+  MG_V_CYCLE = 0,      //!< one V-cycle on the coarse level
+  MG_W_CYCLE = 1,      //!< two W-cycles on the coarse level
+  MG_F_CYCLE = 2,      //!< a downward F-cycle followed by an upward F-cycle on the coarse level
+  MG_F_CYCLE_DOWN = 3, //!< inner levels of MG_F_CYCLE: a downward F-cycle followed by a V-cycle on the coarse level
+  MG_F_CYCLE_UP = 4    //!< inner levels of MG_F_CYCLE: a V-cycle followed by an upward F-cycle on the coarse level
+};
+
+/*!
+ Returns the cycles applied to the coarse level, in order, by a cycle on the level above.  Each visit after the
+ first starts from the coarse correction of the previous one.  The upward F-cycle is the adjoint of the
+ downward one, so MG_F_CYCLE, like the V- and W-cycle, is a symmetric preconditioner.
+
+ @param[in] cycle the cycle on the fine level
+ @param[out] visits the cycles on the coarse level (at most 2)
+
+ @return the number of coarse visits
+ */
+inline int GetCoarseVisits(MGCycle cycle, MGCycle visits[2]) {
+  switch (cycle) {
+    case MG_W_CYCLE: visits[0] = MG_W_CYCLE; visits[1] = MG_W_CYCLE; return 2;
+    case MG_F_CYCLE: visits[0] = MG_F_CYCLE_DOWN; visits[1] = MG_F_CYCLE_UP; return 2;
+    case MG_F_CYCLE_DOWN: visits[0] = MG_F_CYCLE_DOWN; visits[1] = MG_V_CYCLE; return 2;
+    case MG_F_CYCLE_UP: visits[0] = MG_V_CYCLE; visits[1] = MG_F_CYCLE_UP; return 2;
+    default: visits[0] = MG_V_CYCLE; return 1;
+  }
+}
+
 struct MGData_STRUCT {
   int numberOfPresmootherSteps; // Call ComputeSYMGS this many times prior to coarsening
   int numberOfPostsmootherSteps; // Call ComputeSYMGS this many times after coarsening
   local_int_t * f2cOperator; //!< 1D array containing the fine operator local IDs that will be injected into coarse space.
+  local_int_t * f2cOffsets; //!< For aggregation-based coarsening: offsets (length nc+1) into f2cOperator of the fine rows in each aggregate (0 for injection)
+  Agglomeration * agglomeration; //!< Gather/scatter of the coarse rows if the coarse level is agglomerated onto fewer processes (0 otherwise)
+  FullWeighting * fullWeighting; //!< Full-weighting restriction and trilinear prolongation (0 for injection, see GenerateFullWeighting)
+  MGCycle cycle; //!< Multigrid cycle applied from this level down (MG_V_CYCLE by default)
   Vector * rc; // coarse grid residual vector
   Vector * xc; // coarse grid solution vector
   Vector * Axf; // fine grid residual vector
+  double times[MG_NUMBER_OF_PHASES]; //!< cumulative time (sec) spent in each MGPhase on this level by ComputeMG
   /*!
    This is for storing optimized data structres created in OptimizeProblem and
    used inside optimized ComputeSPMV().
@@ -40,6 +87,16 @@ struct MGData_STRUCT {
 };
 typedef struct MGData_STRUCT MGData;
 
+/*!
+ Resets the per-phase timers of a multigrid level.
+
+ @param[inout] data the MG data structure whose timers are set to zero
+ */
+inline void ZeroMGDataTimes(MGData & data) {
+  for (int i=0; i<MG_NUMBER_OF_PHASES; ++i) data.times[i] = 0.0;
+  return;
+}
+
 /*!
  Constructor for the data structure of CG vectors.
 
@@ -51,9 +108,14 @@ inline void InitializeMGData(local_int_t * f2cOperator, Vector * rc, Vector * xc
   data.numberOfPresmootherSteps = 1;
   data.numberOfPostsmootherSteps = 1;
   data.f2cOperator = f2cOperator; // Space for injection operator
+  data.f2cOffsets = 0; // Simple injection: one fine row per coarse row
+  data.agglomeration = 0; // Every process owns the coarse rows it computes
+  data.fullWeighting = 0; // Injection
+  data.cycle = MG_V_CYCLE;
   data.rc = rc;
   data.xc = xc;
   data.Axf = Axf;
+  ZeroMGDataTimes(data);
   return;
 }
 
@@ -65,6 +127,9 @@ inline void InitializeMGData(local_int_t * f2cOperator, Vector * rc, Vector * xc
 inline void DeleteMGData(MGData & data) {
 
   delete [] data.f2cOperator;
+  delete [] data.f2cOffsets;
+  if (data.fullWeighting) { DeleteFullWeighting(*data.fullWeighting); delete data.fullWeighting; data.fullWeighting = 0; }
+  if (data.agglomeration) { DeleteAgglomeration(*data.agglomeration); delete data.agglomeration; data.agglomeration = 0; }
   DeleteVector(*data.Axf);
   DeleteVector(*data.rc);
   DeleteVector(*data.xc);
@@ -0,0 +1,155 @@
+
+//@HEADER
+// ***************************************************
+//
+// HPCG: High Performance Conjugate Gradient Benchmark
+//
+// Contact:
+// Michael A. Heroux ( maherou@sandia.gov)
+// Jack Dongarra     (dongarra@eecs.utk.edu)
+// Piotr Luszczek    (luszczek@eecs.utk.edu)
+//
+// ***************************************************
+//@HEADER
+
+/*!
+ @file MultiVector.hpp
+
+ HPCG data structure for blocks of vectors
+ */
+
+#ifndef MULTIVECTOR_HPP
+#define MULTIVECTOR_HPP
+#include <cassert>
+#include "Geometry.hpp"
+#include "Vector.hpp"
+
+/*!
+  A block of numberOfVectors vectors of the same length stored interleaved: entry i of vector j is
+  values[i*numberOfVectors+j].  The entries of all vectors for one row are adjacent, so kernels that
+  stream through the matrix once can update all vectors of the block.
+*/
+struct MultiVector_STRUCT {
+  local_int_t localLength;  //!< length of local portion of each vector
+  int numberOfVectors;      //!< number of vectors in the block
+  double * values;          //!< array of localLength*numberOfVectors interleaved values
+  double * sendBuffer;      //!< send buffer of ExchangeHaloMulti for a block with a halo, 0 otherwise
+  /*!
+   This is for storing optimized data structures created in OptimizeProblem and
+   used inside optimized kernels.
+   */
+  void * optimizationData;
+};
+typedef struct MultiVector_STRUCT MultiVector;
+
+/*!
+  Fill the input block of vectors with zero values.
+
+  @param[inout] v - On entrance v is initialized, on exit all its values are zero.
+ */
+inline void ZeroMultiVector(MultiVector & v) {
+  local_int_t length = v.localLength*v.numberOfVectors;
+  double * vv = v.values;
+#ifndef HPCG_NO_OPENMP
+  #pragma omp parallel for simd schedule(static) HPCG_NONTEMPORAL(vv)
+#endif
+  for (local_int_t i=0; i<length; ++i) vv[i] = 0.0;
+  return;
+}
+
+/*!
+  Initializes input block of vectors.  The values are set to zero by the threads that will work on them.
+
+  @param[in] v
+  @param[in] localLength Length of local portion of each vector
+  @param[in] numberOfVectors Number of vectors in the block
+ */
+inline void InitializeMultiVector(MultiVector & v, local_int_t localLength, int numberOfVectors) {
+  v.localLength = localLength;
+  v.numberOfVectors = numberOfVectors;
+  v.values = new double[localLength*numberOfVectors];
+  v.sendBuffer = 0;
+  v.optimizationData = 0;
+  ZeroMultiVector(v); // First touch by the threads that will work on the rows
+  return;
+}
+
+/*!
+  Allocates the send buffer of a block whose halo is exchanged, so that ExchangeHaloMulti does not allocate one per call.
+
+  @param[inout] v the block of vectors
+  @param[in] totalToBeSent Number of entries per vector sent to the neighbors (SparseMatrix::totalToBeSent)
+ */
+inline void InitializeMultiVectorSendBuffer(MultiVector & v, local_int_t totalToBeSent) {
+  v.sendBuffer = new double[totalToBeSent*v.numberOfVectors];
+  return;
+}
+
+/*!
+  Copy input block of vectors to output block of vectors.
+
+  @param[in] v Input block
+  @param[in] w Output block, with the same number of vectors and at least the same length
+ */
+inline void CopyMultiVector(const MultiVector & v, MultiVector & w) {
+  assert(w.localLength >= v.localLength && w.numberOfVectors==v.numberOfVectors);
+  local_int_t length = v.localLength*v.numberOfVectors;
+  double * vv = v.values;
+  double * wv = w.values;
+#ifndef HPCG_NO_OPENMP
+  #pragma omp parallel for simd schedule(static) HPCG_NONTEMPORAL(wv)
+#endif
+  for (local_int_t i=0; i<length; ++i) wv[i] = vv[i];
+  return;
+}
+
+/*!
+  Copy a vector into one vector of a block.
+
+  @param[in]    v     Input vector
+  @param[inout] w     Block of vectors
+  @param[in]    index Index of the vector of w to overwrite
+ */
+inline void SetMultiVectorColumn(const Vector & v, MultiVector & w, int index) {
+  assert(w.localLength >= v.localLength && index>=0 && index<w.numberOfVectors);
+  int k = w.numberOfVectors;
+#ifndef HPCG_NO_OPENMP
+  #pragma omp parallel for schedule(static)
+#endif
+  for (local_int_t i=0; i<v.localLength; ++i) w.values[i*k+index] = v.values[i];
+  return;
+}
+
+/*!
+  Copy one vector of a block into a vector.
+
+  @param[in]    v     Block of vectors
+  @param[in]    index Index of the vector of v to copy
+  @param[inout] w     Output vector
+ */
+inline void GetMultiVectorColumn(const MultiVector & v, int index, Vector & w) {
+  assert(w.localLength <= v.localLength && index>=0 && index<v.numberOfVectors);
+  int k = v.numberOfVectors;
+#ifndef HPCG_NO_OPENMP
+  #pragma omp parallel for schedule(static)
+#endif
+  for (local_int_t i=0; i<w.localLength; ++i) w.values[i] = v.values[i*k+index];
+  return;
+}
+
+/*!
+  Deallocates the members of the data structure of the block of vectors.
+
+  @param[in] v the block of vectors
+ */
+inline void DeleteMultiVector(MultiVector & v) {
+
+  delete [] v.values;
+  delete [] v.sendBuffer;
+  v.sendBuffer = 0;
+  v.localLength = 0;
+  v.numberOfVectors = 0;
+  return;
+}
+
+#endif // MULTIVECTOR_HPP
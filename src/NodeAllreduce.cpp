@@ -0,0 +1,173 @@
+
+//@HEADER
+// ***************************************************
+//
+// HPCG: High Performance Conjugate Gradient Benchmark
+//
+// Contact:
+// Michael A. Heroux ( maherou@sandia.gov)
+// Jack Dongarra     (dongarra@eecs.utk.edu)
+// Piotr Luszczek    (luszczek@eecs.utk.edu)
+//
+// ***************************************************
+//@HEADER
+
+
+/*!
+ @file NodeAllreduce.cpp
+
+ HPCG routines for the hierarchical (node-aware) sum of a few values over all processes
+ */
+
+#ifndef HPCG_NO_MPI
+#include <mpi.h>
+#endif
+
+#ifdef HPCG_NODE_ALLREDUCE
+#ifdef HPCG_NO_MPI
+#error "HPCG_NODE_ALLREDUCE requires MPI"
+#endif
+#include <sched.h>
+#endif
+
+#include "NodeAllreduce.hpp"
+
+#ifdef HPCG_NODE_ALLREDUCE
+
+static const int nodeAllreduceMaxCount = 63; //!< largest number of values summed through shared memory
+
+/*!
+  One process' part of the shared window, a multiple of the cache line size.
+*/
+struct NodeAllreduceSlot {
+  volatile long long numberOfCalls; //!< the call whose values are in the slot
+  double values[nodeAllreduceMaxCount]; //!< the values of that call
+};
+
+static MPI_Comm baseComm = MPI_COMM_NULL; //!< the communicator the node and leader communicators were split from
+static MPI_Comm nodeComm = MPI_COMM_NULL; //!< the processes on this node
+static MPI_Comm leaderComm = MPI_COMM_NULL; //!< the first process of every node (MPI_COMM_NULL on the others)
+static MPI_Win window; //!< shared window with one slot per process of the node, and one for the node's result
+static NodeAllreduceSlot * slots = 0; //!< the slots of the window, 0 if InitializeNodeAllreduce was not called
+static int nodeRank = 0; //!< rank of this process in nodeComm
+static int nodeSize = 1; //!< number of processes in nodeComm
+static long long numberOfCalls = 0; //!< number of calls of NodeAllreduceSum through shared memory
+
+/*!
+  Waits until the call counter of a slot reaches a value.
+*/
+static void WaitForSlot(const NodeAllreduceSlot & slot, long long call) {
+  while (slot.numberOfCalls<call) {
+    MPI_Win_sync(window);
+    sched_yield(); // Let the process we wait for run when cores are oversubscribed
+  }
+  MPI_Win_sync(window);
+  return;
+}
+#endif
+
+/*!
+  Creates the node and node leader communicators and the shared window used by NodeAllreduceSum.  Collective over
+  params.comm; does nothing unless HPCG is compiled with HPCG_NODE_ALLREDUCE.
+
+  @param[in] params the run parameters whose communicator is split by node
+
+  @see DeleteNodeAllreduce
+*/
+void InitializeNodeAllreduce(const HPCG_Params & params) {
+#ifdef HPCG_NODE_ALLREDUCE
+  if (slots!=0) return;
+  baseComm = params.comm;
+  int rank = params.comm_rank;
+  MPI_Comm_split_type(baseComm, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &nodeComm);
+  MPI_Comm_rank(nodeComm, &nodeRank);
+  MPI_Comm_size(nodeComm, &nodeSize);
+  MPI_Comm_split(baseComm, nodeRank==0 ? 0 : MPI_UNDEFINED, rank, &leaderComm);
+
+  // The first process of the node allocates all slots so that they are contiguous
+  MPI_Aint windowSize = nodeRank==0 ? (nodeSize+1)*sizeof(NodeAllreduceSlot) : 0;
+  NodeAllreduceSlot * base = 0;
+  MPI_Win_allocate_shared(windowSize, sizeof(NodeAllreduceSlot), MPI_INFO_NULL, nodeComm, &base, &window);
+  MPI_Aint size;
+  int displacementUnit;
+  MPI_Win_shared_query(window, 0, &size, &displacementUnit, &slots);
+  MPI_Win_lock_all(MPI_MODE_NOCHECK, window); // Passive target epoch for the lifetime of the window
+  if (nodeRank==0)
+    for (int i=0; i<=nodeSize; ++i) slots[i].numberOfCalls = 0;
+  MPI_Win_sync(window);
+  MPI_Barrier(nodeComm);
+  MPI_Win_sync(window);
+  numberOfCalls = 0;
+#else
+  (void) params;
+#endif
+  return;
+}
+
+/*!
+  Computes the sums of the values of all processes.  The processes of a node add their values in shared
+  memory, the first process of every node combines the sums of the nodes with MPI_Allreduce, and the
+  result is read from shared memory by the other processes of the node.  Falls back to MPI_Allreduce on
+  geom.comm when InitializeNodeAllreduce was not called for that communicator or for more than 63 values.
+
+  @param[in]  geom   the geometry whose processes take part in the sum
+  @param[in]  values the count values of this process
+  @param[out] result on exit, the sums over all processes (may not overlap values)
+  @param[in]  count  the number of values
+*/
+void NodeAllreduceSum(const Geometry & geom, const double * values, double * result, int count) {
+#ifdef HPCG_NODE_ALLREDUCE
+  if (slots!=0 && geom.comm==baseComm && count<=nodeAllreduceMaxCount) {
+    long long call = ++numberOfCalls;
+    NodeAllreduceSlot & mine = slots[nodeRank];
+    NodeAllreduceSlot & nodeResult = slots[nodeSize];
+    for (int j=0; j<count; ++j) mine.values[j] = values[j];
+    MPI_Win_sync(window);
+    mine.numberOfCalls = call;
+    MPI_Win_sync(window);
+    if (nodeRank==0) {
+      // Sum in the order of the node ranks, so that the result is reproducible
+      for (int j=0; j<count; ++j) result[j] = values[j];
+      for (int i=1; i<nodeSize; ++i) {
+        WaitForSlot(slots[i], call);
+        for (int j=0; j<count; ++j) result[j] += slots[i].values[j];
+      }
+      MPI_Allreduce(MPI_IN_PLACE, result, count, MPI_DOUBLE, MPI_SUM, leaderComm);
+      for (int j=0; j<count; ++j) nodeResult.values[j] = result[j];
+      MPI_Win_sync(window);
+      nodeResult.numberOfCalls = call;
+      MPI_Win_sync(window);
+    } else {
+      WaitForSlot(nodeResult, call);
+      for (int j=0; j<count; ++j) result[j] = nodeResult.values[j];
+    }
+    return;
+  }
+#endif
+#ifndef HPCG_NO_MPI
+  MPI_Allreduce((void *) values, result, count, MPI_DOUBLE, MPI_SUM, geom.comm);
+#else
+  (void) geom;
+  for (int j=0; j<count; ++j) result[j] = values[j];
+#endif
+  return;
+}
+
+/*!
+  Frees the communicators and the shared window of NodeAllreduceSum.  Collective over the communicator
+  given to InitializeNodeAllreduce.
+
+  @see InitializeNodeAllreduce
+*/
+void DeleteNodeAllreduce(void) {
+#ifdef HPCG_NODE_ALLREDUCE
+  if (slots==0) return;
+  MPI_Win_unlock_all(window);
+  MPI_Win_free(&window);
+  if (leaderComm!=MPI_COMM_NULL) MPI_Comm_free(&leaderComm);
+  MPI_Comm_free(&nodeComm);
+  baseComm = MPI_COMM_NULL;
+  slots = 0;
+#endif
+  return;
+}
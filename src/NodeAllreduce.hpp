@@ -0,0 +1,30 @@
+
+//@HEADER
+// ***************************************************
+//
+// HPCG: High Performance Conjugate Gradient Benchmark
+//
+// Contact:
+// Michael A. Heroux ( maherou@sandia.gov)
+// Jack Dongarra     (dongarra@eecs.utk.edu)
+// Piotr Luszczek    (luszczek@eecs.utk.edu)
+//
+// ***************************************************
+//@HEADER
+
+
+/*!
+ @file NodeAllreduce.hpp
+
+ HPCG routines for the hierarchical (node-aware) sum of a few values over all processes
+ */
+
+#ifndef NODEALLREDUCE_HPP
+#define NODEALLREDUCE_HPP
+#include "hpcg.hpp"
+
+void InitializeNodeAllreduce(const HPCG_Params & params);
+void NodeAllreduceSum(const Geometry & geom, const double * values, double * result, int count);
+void DeleteNodeAllreduce(void);
+
+#endif // NODEALLREDUCE_HPP
@@ -18,7 +18,319 @@
  HPCG routine
  */
 
+#ifndef HPCG_NO_MPI
+#include <mpi.h>
+#endif
+#ifndef HPCG_NO_OPENMP
+#include <omp.h>
+#endif
+#include <algorithm>
+#include <cmath>
+#include <vector>
 #include "OptimizeProblem.hpp"
+#include "ComputeSPMV.hpp"
+#include "ComputeSYMGS.hpp"
+#include "mytimer.hpp"
+
+/*!
+  Stores the diagonal of every level of the multigrid hierarchy contiguously, so that the smoother streams through
+  it instead of following matrixDiagonal.  With HPCG_RECIPROCAL_DIAGONAL the reciprocals are stored too.
+
+  @param[inout] A The finest level matrix
+*/
+static void SetupDiagonalCache(SparseMatrix & A) {
+  for (SparseMatrix * level = &A; level!=0; level = level->Ac) {
+    const local_int_t nrow = level->localNumberOfRows;
+    if (level->diagonalValues==0) {
+      level->diagonalValues = new double[nrow];
+#ifdef HPCG_RECIPROCAL_DIAGONAL
+      level->inverseDiagonalValues = new double[nrow];
+#endif
+    }
+    double * const diagonal = level->diagonalValues;
+    double * const inverseDiagonal = level->inverseDiagonalValues;
+    double ** const matrixDiagonal = level->matrixDiagonal;
+#ifndef HPCG_NO_OPENMP
+    #pragma omp parallel for schedule(static)
+#endif
+    for (local_int_t i=0; i<nrow; ++i) {
+      diagonal[i] = matrixDiagonal[i][0];
+      if (inverseDiagonal!=0) inverseDiagonal[i] = 1.0/diagonal[i];
+    }
+  }
+  return;
+}
+
+#ifdef HPCG_SPLIT_TRIANGULAR
+/*!
+  Splits the off-diagonal entries of every level of the multigrid hierarchy into a strictly lower and a strictly
+  upper part in CSR form, so that the sweeps of ComputeSYMGS skip the diagonal and run shorter inner loops.
+
+  @param[inout] A The finest level matrix
+*/
+static void SetupTriangularSplit(SparseMatrix & A) {
+  for (SparseMatrix * level = &A; level!=0; level = level->Ac) {
+    if (level->triangularSplit!=0) continue;
+    const local_int_t nrow = level->localNumberOfRows;
+    TriangularSplit * split = new TriangularSplit;
+    split->lowerRowStart = new local_int_t[nrow+1];
+    split->upperRowStart = new local_int_t[nrow+1];
+    split->lowerRowStart[0] = split->upperRowStart[0] = 0;
+    for (local_int_t i=0; i<nrow; ++i) {
+      local_int_t numberOfLower = 0, numberOfUpper = 0;
+      for (int j=0; j<level->nonzerosInRow[i]; ++j) {
+        local_int_t col = level->mtxIndL[i][j];
+        if (col<i) ++numberOfLower;
+        else if (col>i) ++numberOfUpper;
+      }
+      split->lowerRowStart[i+1] = split->lowerRowStart[i] + numberOfLower;
+      split->upperRowStart[i+1] = split->upperRowStart[i] + numberOfUpper;
+    }
+    split->lowerColumns = new local_int_t[split->lowerRowStart[nrow]];
+    split->lowerValues = new double[split->lowerRowStart[nrow]];
+    split->upperExternalStart = new local_int_t[nrow];
+    split->upperColumns = new local_int_t[split->upperRowStart[nrow]];
+    split->upperValues = new double[split->upperRowStart[nrow]];
+    split->work = new double[nrow];
+#ifndef HPCG_NO_OPENMP
+    #pragma omp parallel for schedule(static)
+#endif
+    for (local_int_t i=0; i<nrow; ++i) {
+      local_int_t lower = split->lowerRowStart[i], upper = split->upperRowStart[i];
+      for (int j=0; j<level->nonzerosInRow[i]; ++j) {
+        local_int_t col = level->mtxIndL[i][j];
+        if (col<i) {
+          split->lowerColumns[lower] = col;
+          split->lowerValues[lower++] = level->matrixValues[i][j];
+        } else if (col>i && col<nrow) {
+          split->upperColumns[upper] = col;
+          split->upperValues[upper++] = level->matrixValues[i][j];
+        }
+      }
+      split->upperExternalStart[i] = upper;
+      for (int j=0; j<level->nonzerosInRow[i]; ++j) { // External columns last, see ComputeSYMGSAndSPMV
+        local_int_t col = level->mtxIndL[i][j];
+        if (col>=nrow) {
+          split->upperColumns[upper] = col;
+          split->upperValues[upper++] = level->matrixValues[i][j];
+        }
+      }
+      split->work[i] = 0.0;
+    }
+    level->triangularSplit = split;
+  }
+  return;
+}
+#endif
+
+#ifndef HPCG_NO_OPENMP
+/*!
+  Chooses the number of OpenMP threads that ComputeMG uses on each coarse level, so that the small coarse
+  levels do not pay for synchronizing more threads than their work keeps busy.  The finest level keeps all
+  threads.  With -DHPCG_MG_ROWS_PER_THREAD=<n>, a level gets one thread per n local rows; otherwise the
+  powers of two up to the number of threads are timed with a SYMGS step and a SpMV on the level (the
+  slowest process deciding with MPI) and the fastest is kept.
+
+  @param[inout] A The finest level matrix
+*/
+static void SetupLevelThreads(SparseMatrix & A) {
+  const int maxThreads = omp_get_max_threads();
+  for (SparseMatrix * level = A.Ac; level!=0; level = level->Ac) {
+#ifdef HPCG_MG_ROWS_PER_THREAD
+    local_int_t numberOfThreads = level->localNumberOfRows/(HPCG_MG_ROWS_PER_THREAD);
+    level->numberOfThreads = (int) std::max((local_int_t) 1, std::min((local_int_t) maxThreads, numberOfThreads));
+#else
+    // Enough calls to stream about a million nonzeros per candidate, so that the small levels give stable times.
+    // Every call exchanges halos, so all processes make as many calls as the one with the most nonzeros.
+    int numberOfCalls = std::min(1000, std::max(3, (int) (1.0E6/(level->localNumberOfNonzeros+1))));
+    int largestCandidate = maxThreads; // The processes also time the same candidates
+#ifndef HPCG_NO_MPI
+    MPI_Allreduce(MPI_IN_PLACE, &numberOfCalls, 1, MPI_INT, MPI_MIN, level->geom->comm);
+    MPI_Allreduce(MPI_IN_PLACE, &largestCandidate, 1, MPI_INT, MPI_MAX, level->geom->comm);
+#endif
+    Vector r, x, Ax;
+    InitializeVector(r, level->localNumberOfColumns);
+    InitializeVector(x, level->localNumberOfColumns);
+    InitializeVector(Ax, level->localNumberOfColumns);
+    for (local_int_t i=0; i<level->localNumberOfRows; ++i) r.values[i] = 1.0;
+    int bestNumberOfThreads = maxThreads;
+    double bestTime = -1.0;
+    for (int candidate=1; ; candidate = std::min(2*candidate, largestCandidate)) {
+      const int numberOfThreads = std::min(candidate, maxThreads);
+      omp_set_num_threads(numberOfThreads);
+      ComputeSYMGS(*level, r, x); // Warm-up: the team of this size and the data in cache
+      ComputeSPMV(*level, x, Ax);
+#ifndef HPCG_NO_MPI
+      MPI_Barrier(level->geom->comm);
+#endif
+      double time = mytimer();
+      for (int i=0; i<numberOfCalls; ++i) {
+        ComputeSYMGS(*level, r, x);
+        ComputeSPMV(*level, x, Ax);
+      }
+      time = mytimer() - time;
+#ifndef HPCG_NO_MPI
+      MPI_Allreduce(MPI_IN_PLACE, &time, 1, MPI_DOUBLE, MPI_MAX, level->geom->comm);
+#endif
+      if (bestTime<0.0 || time<bestTime) {
+        bestTime = time;
+        bestNumberOfThreads = numberOfThreads;
+      }
+      if (candidate==largestCandidate) break;
+    }
+    level->numberOfThreads = bestNumberOfThreads;
+    DeleteVector(r);
+    DeleteVector(x);
+    DeleteVector(Ax);
+#endif
+  }
+  omp_set_num_threads(maxThreads);
+  return;
+}
+#endif
+
+#ifdef HPCG_REPLICATED_COARSE_SOLVE
+/*!
+  Gathers the lower triangle of the coarsest level matrix in band storage in global row order on every process of
+  cholesky.comm and factors it in place, L(i,j) = (A(i,j) - sum_k L(i,k)*L(j,k))/L(j,j).
+
+  @param[in] level The coarsest level matrix; this process owns rows of it
+  @param[inout] cholesky On entry, numberOfRows and comm are set; on exit, the factor and the work arrays of the solve
+
+  @return true if the factorization succeeded, false if the matrix is not numerically positive definite
+*/
+static bool FactorCoarseCholesky(const SparseMatrix & level, CoarseCholesky & cholesky) {
+  const global_int_t n = cholesky.numberOfRows;
+  const local_int_t nrow = level.localNumberOfRows;
+
+  // Lower triangle of the local rows, and the bandwidth
+  std::vector< long long > localRows, localColumns;
+  std::vector< double > localValues;
+  long long bandwidth = 0;
+  for (local_int_t i=0; i<nrow; ++i) {
+    long long row = level.localToGlobalMap[i];
+    for (int j=0; j<level.nonzerosInRow[i]; ++j) {
+      long long column = level.mtxIndG[i][j];
+      if (column>row) continue;
+      localRows.push_back(row);
+      localColumns.push_back(column);
+      localValues.push_back(level.matrixValues[i][j]);
+      bandwidth = std::max(bandwidth, row-column);
+    }
+  }
+
+  int size = 1;
+  int localCount = localValues.size();
+#ifndef HPCG_NO_MPI
+  MPI_Comm_size(cholesky.comm, &size);
+  MPI_Allreduce(MPI_IN_PLACE, &bandwidth, 1, MPI_LONG_LONG_INT, MPI_MAX, cholesky.comm);
+#endif
+  cholesky.bandwidth = bandwidth;
+  cholesky.counts = new int[size];
+  cholesky.displacements = new int[size];
+  cholesky.gatheredRows = new global_int_t[n];
+  cholesky.gathered = new double[n];
+  cholesky.values = new double[n];
+
+  // Gather the order of the rows of all processes and the entries of the lower triangle
+  std::vector< int > entryCounts(size), entryDisplacements(size);
+  int localRowCount = nrow;
+#ifndef HPCG_NO_MPI
+  MPI_Allgather(&localRowCount, 1, MPI_INT, cholesky.counts, 1, MPI_INT, cholesky.comm);
+  MPI_Allgather(&localCount, 1, MPI_INT, &entryCounts[0], 1, MPI_INT, cholesky.comm);
+#else
+  cholesky.counts[0] = localRowCount;
+  entryCounts[0] = localCount;
+#endif
+  cholesky.displacements[0] = 0;
+  entryDisplacements[0] = 0;
+  for (int p=1; p<size; ++p) {
+    cholesky.displacements[p] = cholesky.displacements[p-1] + cholesky.counts[p-1];
+    entryDisplacements[p] = entryDisplacements[p-1] + entryCounts[p-1];
+  }
+  int numberOfEntries = entryDisplacements[size-1] + entryCounts[size-1];
+  std::vector< long long > rows(numberOfEntries), columns(numberOfEntries);
+  std::vector< double > values(numberOfEntries);
+#ifndef HPCG_NO_MPI
+  std::vector< long long > localToGlobal(level.localToGlobalMap.begin(), level.localToGlobalMap.end());
+  std::vector< long long > gatheredRows(n);
+  MPI_Allgatherv(&localToGlobal[0], localRowCount, MPI_LONG_LONG_INT, &gatheredRows[0], cholesky.counts, cholesky.displacements, MPI_LONG_LONG_INT, cholesky.comm);
+  std::copy(gatheredRows.begin(), gatheredRows.end(), cholesky.gatheredRows);
+  MPI_Allgatherv(&localRows[0], localCount, MPI_LONG_LONG_INT, &rows[0], &entryCounts[0], &entryDisplacements[0], MPI_LONG_LONG_INT, cholesky.comm);
+  MPI_Allgatherv(&localColumns[0], localCount, MPI_LONG_LONG_INT, &columns[0], &entryCounts[0], &entryDisplacements[0], MPI_LONG_LONG_INT, cholesky.comm);
+  MPI_Allgatherv(&localValues[0], localCount, MPI_DOUBLE, &values[0], &entryCounts[0], &entryDisplacements[0], MPI_DOUBLE, cholesky.comm);
+#else
+  std::copy(level.localToGlobalMap.begin(), level.localToGlobalMap.end(), cholesky.gatheredRows);
+  rows = localRows;
+  columns = localColumns;
+  values = localValues;
+#endif
+
+  // Band of the lower triangle, factored in place
+  const global_int_t width = bandwidth+1;
+  double * const L = new double[n*width];
+  for (global_int_t k=0; k<n*width; ++k) L[k] = 0.0;
+  for (int k=0; k<numberOfEntries; ++k) L[rows[k]*width + columns[k]-rows[k]+bandwidth] = values[k];
+  bool isPositiveDefinite = true;
+  for (global_int_t i=0; i<n && isPositiveDefinite; ++i) {
+    double * const Li = L + i*width - i + bandwidth; // Li[j] is L(i,j)
+    for (global_int_t j=std::max((global_int_t) 0, i-bandwidth); j<=i; ++j) {
+      const double * const Lj = L + j*width - j + bandwidth;
+      double sum = Li[j];
+      for (global_int_t k=std::max((global_int_t) 0, i-bandwidth); k<j; ++k) sum -= Li[k]*Lj[k];
+      if (j<i) Li[j] = sum/Lj[j];
+      else if (sum>0.0) Li[i] = std::sqrt(sum);
+      else isPositiveDefinite = false;
+    }
+  }
+  cholesky.factor = L;
+  return isPositiveDefinite;
+}
+
+/*!
+  Factors the coarsest level of the multigrid hierarchy on every process that owns rows of it (see
+  FactorCoarseCholesky), if the level has at most HPCG_REPLICATED_COARSE_SOLVE rows.  ComputeMG then solves the
+  coarsest level exactly instead of applying one SYMGS step.  The level keeps the SYMGS step if the factorization
+  breaks down.  Processes of agglomerated levels that own no coarsest rows take no part in the solve, but keep
+  its size and bandwidth, so that the models of ReportResults agree on all processes.
+
+  @param[inout] A The finest level matrix
+*/
+static void SetupCoarseCholesky(SparseMatrix & A) {
+  SparseMatrix * level = &A;
+  while (level->Ac!=0) level = level->Ac;
+  const global_int_t n = level->totalNumberOfRows;
+  if (n>HPCG_REPLICATED_COARSE_SOLVE || level->coarseCholesky!=0) return;
+  const local_int_t nrow = level->localNumberOfRows;
+
+  CoarseCholesky * cholesky = new CoarseCholesky;
+  cholesky->numberOfRows = n;
+  cholesky->bandwidth = 0;
+  cholesky->factor = 0;
+  cholesky->values = 0;
+  cholesky->gathered = 0;
+  cholesky->gatheredRows = 0;
+  cholesky->counts = 0;
+  cholesky->displacements = 0;
+#ifndef HPCG_NO_MPI
+  MPI_Comm_split(level->geom->comm, nrow>0 ? 0 : MPI_UNDEFINED, level->geom->rank, &cholesky->comm);
+#endif
+  bool isFactored = nrow>0 && FactorCoarseCholesky(*level, *cholesky);
+  long long factoredBandwidth = isFactored ? cholesky->bandwidth : -1;
+#ifndef HPCG_NO_MPI
+  MPI_Allreduce(MPI_IN_PLACE, &factoredBandwidth, 1, MPI_LONG_LONG_INT, MPI_MAX, level->geom->comm);
+#endif
+  if (factoredBandwidth<0) { // Keep the SYMGS step
+    DeleteCoarseCholesky(*cholesky);
+    delete cholesky;
+    return;
+  }
+  cholesky->bandwidth = factoredBandwidth;
+  level->coarseCholesky = cholesky;
+  return;
+}
+#endif
+
 /*!
   Optimizes the data structures used for CG iteration to increase the
   performance of the benchmark version of the preconditioned CG algorithm.
@@ -37,7 +349,16 @@
 int OptimizeProblem(SparseMatrix & A, CGData & data, Vector & b, Vector & x, Vector & xexact) {
 
   // This function can be used to completely transform any part of the data structures.
-  // Right now it does nothing, so compiling with a check for unused variables results in complaints
+  SetupDiagonalCache(A);
+#ifdef HPCG_SPLIT_TRIANGULAR
+  SetupTriangularSplit(A);
+#endif
+#ifdef HPCG_REPLICATED_COARSE_SOLVE
+  SetupCoarseCholesky(A);
+#endif
+#ifndef HPCG_NO_OPENMP
+  SetupLevelThreads(A);
+#endif
 
 #if defined(HPCG_USE_MULTICOLORING)
   const local_int_t nrow = A.localNumberOfRows;
@@ -101,6 +422,25 @@ int OptimizeProblem(SparseMatrix & A, CGData & data, Vector & b, Vector & x, Vec
 // Helper function (see OptimizeProblem.hpp for details)
 double OptimizeProblemMemoryUse(const SparseMatrix & A) {
 
-  return 0.0;
+  double fnbytes = 0.0;
+  for (const SparseMatrix * level = &A; level!=0; level = level->Ac) {
+    fnbytes += ((double) level->totalNumberOfRows)*sizeof(double); // diagonalValues
+#ifdef HPCG_RECIPROCAL_DIAGONAL
+    fnbytes += ((double) level->totalNumberOfRows)*sizeof(double); // inverseDiagonalValues
+#endif
+#ifdef HPCG_SPLIT_TRIANGULAR
+    double fnrow = level->totalNumberOfRows, fnoffdiagonal = ((double) level->totalNumberOfNonzeros) - fnrow;
+    fnbytes += fnoffdiagonal*(sizeof(double)+sizeof(local_int_t)); // lower and upper values and columns
+    fnbytes += (3.0*fnrow+2.0)*sizeof(local_int_t) + fnrow*sizeof(double); // row starts, external starts and work
+#endif
+#ifdef HPCG_REPLICATED_COARSE_SOLVE
+    if (level->coarseCholesky!=0) { // Replicated on every process that owns rows of the coarsest level
+      double fnrow = level->totalNumberOfRows, fnbandwidth = level->coarseCholesky->bandwidth;
+      double fnprocesses = ((double) level->geom->npx)*level->geom->npy*level->geom->npz;
+      fnbytes += fnprocesses*fnrow*((fnbandwidth+3.0)*sizeof(double) + sizeof(global_int_t)); // factor, values, gathered and their rows
+    }
+#endif
+  }
+  return fnbytes;
 
 }
@@ -0,0 +1,320 @@
+
+//@HEADER
+// ***************************************************
+//
+// HPCG: High Performance Conjugate Gradient Benchmark
+//
+// Contact:
+// Michael A. Heroux ( maherou@sandia.gov)
+// Jack Dongarra     (dongarra@eecs.utk.edu)
+// Piotr Luszczek    (luszczek@eecs.utk.edu)
+//
+// ***************************************************
+//@HEADER
+
+
+/*!
+ @file PerfCounters.cpp
+
+ HPCG routines for per-kernel hardware performance counters
+ */
+
+// Compile this routine only if performance counters were requested
+#ifdef HPCG_PERF_COUNTERS
+
+#ifndef __linux__
+#error "HPCG_PERF_COUNTERS requires the Linux perf_event_open interface"
+#endif
+
+#ifndef HPCG_NO_MPI
+#include <mpi.h>
+#endif
+
+#ifndef HPCG_NO_OPENMP
+#include <omp.h>
+#endif
+
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <vector>
+
+#include "PerfCounters.hpp"
+#include "PersistentRegion.hpp"
+#include "OutputFile.hpp"
+#include "mytimer.hpp"
+
+struct PerfEvent {
+  unsigned int type;
+  unsigned long long config;
+  const char * name;
+};
+
+// Events are opened as one group per thread so that they are read with a single system call.
+// Events that the kernel or the PMU do not support are dropped from the group.
+static const PerfEvent perfEvents[] = {
+  {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, "Cycles"},
+  {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, "Instructions"},
+  {PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_BACKEND, "Backend stall cycles"},
+  {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES, "LLC references"},
+  {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, "LLC misses"},
+  {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK, "Task clock (ns)"}
+};
+static const int perfNumberOfEvents = sizeof(perfEvents)/sizeof(perfEvents[0]);
+static const int perfCacheLineSize = 64; // Bytes moved from memory per LLC miss
+
+static std::vector< std::vector<int> > threadFds; // File descriptors per thread, the first one is the group leader
+static std::vector<int> openedEvents; // Indices into perfEvents of the events in each group
+static bool isEnabled = false;
+
+// Per-region accumulators: number of calls, wall-clock time and one slot per event
+static const int perfNumberOfFields = 2 + perfNumberOfEvents;
+static double regionCounts[perfNumberOfRegions][perfNumberOfFields];
+static double regionStart[perfNumberOfRegions][perfNumberOfFields];
+
+// Values gathered from all processes on rank 0
+static std::vector<double> gatheredCounts;
+static int gatheredSize = 0;
+
+static int OpenEvent(const PerfEvent & event, int groupFd) {
+  struct perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = event.type;
+  attr.config = event.config;
+  attr.exclude_kernel = 1; // Allowed for unprivileged users with the default perf_event_paranoid setting
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  // pid=0, cpu=-1: count the calling thread on any CPU
+  return (int) syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0);
+}
+
+/*!
+  Opens one event group for the calling thread using the events in openedEvents.
+
+  @return the descriptors of the group, empty if any of the events could not be opened
+*/
+static std::vector<int> OpenGroup(void) {
+  std::vector<int> fds;
+  for (size_t i=0; i<openedEvents.size(); ++i) {
+    int fd = OpenEvent(perfEvents[openedEvents[i]], fds.empty() ? -1 : fds[0]);
+    if (fd<0) {
+      for (size_t j=0; j<fds.size(); ++j) close(fds[j]);
+      fds.clear();
+      break;
+    }
+    fds.push_back(fd);
+  }
+  return fds;
+}
+
+/*!
+  Adds the current counter values of all threads to values, scaled for multiplexing.
+*/
+static void ReadCounts(double * values) {
+  int numberOfEvents = openedEvents.size();
+  for (int j=0; j<numberOfEvents; ++j) values[j] = 0.0;
+  if (numberOfEvents==0) return;
+  std::vector<unsigned long long> buffer(3+numberOfEvents); // nr, time_enabled, time_running, values
+  for (size_t t=0; t<threadFds.size(); ++t) {
+    if (threadFds[t].empty()) continue;
+    ssize_t bytes = read(threadFds[t][0], &buffer[0], buffer.size()*sizeof(unsigned long long));
+    if (bytes!=(ssize_t) (buffer.size()*sizeof(unsigned long long)) || buffer[0]!=(unsigned long long) numberOfEvents) continue;
+    double scale = (buffer[2]>0) ? ((double) buffer[1])/((double) buffer[2]) : 0.0;
+    for (int j=0; j<numberOfEvents; ++j) values[j] += ((double) buffer[3+j])*scale;
+  }
+}
+
+/*!
+  Opens the performance counters on every OpenMP thread.
+
+  Counters are attached to the threads that exist when this routine is called, so it
+  must be called with the same number of threads that the kernels use.
+*/
+void InitializePerfCounters(void) {
+
+  // Find the events that can be opened together on this system
+  std::vector<int> probeFds;
+  for (int i=0; i<perfNumberOfEvents; ++i) {
+    int fd = OpenEvent(perfEvents[i], probeFds.empty() ? -1 : probeFds[0]);
+    if (fd<0) continue;
+    probeFds.push_back(fd);
+    openedEvents.push_back(i);
+  }
+  for (size_t i=0; i<probeFds.size(); ++i) close(probeFds[i]);
+
+  int numThreads = 1;
+#ifndef HPCG_NO_OPENMP
+#pragma omp parallel
+  numThreads = omp_get_num_threads();
+#endif
+  threadFds.resize(numThreads);
+#ifndef HPCG_NO_OPENMP
+#pragma omp parallel
+  threadFds[omp_get_thread_num()] = OpenGroup();
+#else
+  threadFds[0] = OpenGroup();
+#endif
+
+  for (int r=0; r<perfNumberOfRegions; ++r)
+    for (int j=0; j<perfNumberOfFields; ++j) regionCounts[r][j] = regionStart[r][j] = 0.0;
+  return;
+}
+
+/*!
+  Turns accumulation of counts on or off; the kernels are only instrumented while enabled.
+
+  @param[in] enable true to start accumulating counts
+*/
+void EnablePerfCounters(bool enable) {
+  isEnabled = enable;
+}
+
+/*!
+  Records the counter values at the beginning of a region.
+
+  @param[in] region the instrumented region, a PerfRegion value
+*/
+void StartPerfCounters(int region) {
+  if (!isEnabled) return;
+#ifdef HPCG_PERSISTENT_REGION
+  if (InPersistentRegion() && omp_get_thread_num()!=0) return; // The master thread records for the team
+#endif
+  if (region>=perfNumberOfRegions) region = perfNumberOfRegions-1;
+  regionStart[region][1] = mytimer();
+  ReadCounts(&regionStart[region][2]);
+}
+
+/*!
+  Accumulates the counts since the matching call to StartPerfCounters.
+
+  @param[in] region the instrumented region, a PerfRegion value
+*/
+void StopPerfCounters(int region) {
+  if (!isEnabled) return;
+#ifdef HPCG_PERSISTENT_REGION
+  if (InPersistentRegion() && omp_get_thread_num()!=0) return; // The master thread records for the team
+#endif
+  if (region>=perfNumberOfRegions) region = perfNumberOfRegions-1;
+  double values[perfNumberOfEvents];
+  ReadCounts(values);
+  regionCounts[region][0] += 1.0;
+  regionCounts[region][1] += mytimer() - regionStart[region][1];
+  for (size_t j=0; j<openedEvents.size(); ++j) regionCounts[region][2+j] += values[j] - regionStart[region][2+j];
+}
+
+/*!
+  Collects the counts of all processes on rank 0. Must be called by all processes.
+
+  @param[in] geom The description of the problem's geometry.
+*/
+void GatherPerfCounters(const Geometry & geom) {
+  gatheredSize = geom.size;
+  gatheredCounts.resize(geom.size*perfNumberOfRegions*perfNumberOfFields);
+#ifndef HPCG_NO_MPI
+  MPI_Gather(&regionCounts[0][0], perfNumberOfRegions*perfNumberOfFields, MPI_DOUBLE,
+      &gatheredCounts[0], perfNumberOfRegions*perfNumberOfFields, MPI_DOUBLE, 0, geom.comm);
+#else
+  for (int i=0; i<perfNumberOfRegions*perfNumberOfFields; ++i) gatheredCounts[i] = (&regionCounts[0][0])[i];
+#endif
+}
+
+static std::string RegionName(int region) {
+  if (region==PERF_SPMV) return "SpMV";
+  if (region==PERF_WAXPBY) return "WAXPBY";
+  if (region==PERF_DOT) return "DDOT";
+  if (region==PERF_HALO) return "Halo exchange";
+  std::ostringstream name;
+  name << "SYMGS level " << region-PERF_SYMGS;
+  if (region==perfNumberOfRegions-1) name << " and coarser";
+  return name.str();
+}
+
+/*!
+  Adds the counts collected by GatherPerfCounters to the report.
+
+  For every region the counts are summed over processes and threads, the time is the
+  maximum over processes. Derived metrics separate memory-bound from compute-bound behavior:
+  a low IPC with a high backend stall fraction and an estimated memory bandwidth close to
+  the STREAM bandwidth of the node indicate a memory-bound kernel.
+
+  @param[inout] doc The report the counts are added to
+*/
+void ReportPerfCounters(OutputFile & doc) {
+  int numberOfEvents = openedEvents.size();
+  doc.add("Performance Counters","");
+  OutputFile * counters = doc.get("Performance Counters");
+  if (numberOfEvents==0) {
+    counters->add("Events","perf_event_open unavailable, only calls and times are recorded");
+  } else {
+    std::string names;
+    for (int j=0; j<numberOfEvents; ++j) names += (j ? ", " : "") + std::string(perfEvents[openedEvents[j]].name);
+    counters->add("Events",names);
+  }
+
+  int cycles = -1, instructions = -1, stalls = -1, references = -1, misses = -1;
+  for (int j=0; j<numberOfEvents; ++j) {
+    const PerfEvent & event = perfEvents[openedEvents[j]];
+    if (event.type!=PERF_TYPE_HARDWARE) continue;
+    if (event.config==PERF_COUNT_HW_CPU_CYCLES) cycles = j;
+    if (event.config==PERF_COUNT_HW_INSTRUCTIONS) instructions = j;
+    if (event.config==PERF_COUNT_HW_STALLED_CYCLES_BACKEND) stalls = j;
+    if (event.config==PERF_COUNT_HW_CACHE_REFERENCES) references = j;
+    if (event.config==PERF_COUNT_HW_CACHE_MISSES) misses = j;
+  }
+
+  for (int r=0; r<perfNumberOfRegions; ++r) {
+    std::vector<double> total(perfNumberOfFields, 0.0);
+    for (int p=0; p<gatheredSize; ++p) {
+      const double * counts = &gatheredCounts[(p*perfNumberOfRegions+r)*perfNumberOfFields];
+      total[0] = std::max(total[0], counts[0]);
+      total[1] = std::max(total[1], counts[1]);
+      for (int j=0; j<numberOfEvents; ++j) total[2+j] += counts[2+j];
+    }
+    if (total[0]==0.0) continue; // Region was not executed
+
+    std::string name = RegionName(r);
+    counters->add(name,"");
+    OutputFile * region = counters->get(name);
+    region->add("Calls",(long long) total[0]);
+    region->add("Time (sec)",total[1]);
+    for (int j=0; j<numberOfEvents; ++j) region->add(perfEvents[openedEvents[j]].name,(long long) total[2+j]);
+    if (cycles>=0 && instructions>=0 && total[2+cycles]>0.0)
+      region->add("Instructions per cycle",total[2+instructions]/total[2+cycles]);
+    if (cycles>=0 && stalls>=0 && total[2+cycles]>0.0)
+      region->add("Backend stall fraction",total[2+stalls]/total[2+cycles]);
+    if (references>=0 && misses>=0 && total[2+references]>0.0)
+      region->add("LLC miss ratio",total[2+misses]/total[2+references]);
+    if (misses>=0 && total[1]>0.0)
+      region->add("Estimated memory B/W (GB/s)",total[2+misses]*perfCacheLineSize/total[1]/1.0E9);
+
+    if (gatheredSize>1) {
+      for (int p=0; p<gatheredSize; ++p) {
+        const double * counts = &gatheredCounts[(p*perfNumberOfRegions+r)*perfNumberOfFields];
+        std::ostringstream rankName;
+        rankName << "Rank " << p;
+        region->add(rankName.str(),"");
+        OutputFile * rank = region->get(rankName.str());
+        rank->add("Time (sec)",counts[1]);
+        for (int j=0; j<numberOfEvents; ++j) rank->add(perfEvents[openedEvents[j]].name,(long long) counts[2+j]);
+      }
+    }
+  }
+}
+
+/*!
+  Closes the performance counters.
+*/
+void DeletePerfCounters(void) {
+  for (size_t t=0; t<threadFds.size(); ++t)
+    for (size_t j=0; j<threadFds[t].size(); ++j) close(threadFds[t][j]);
+  threadFds.clear();
+  openedEvents.clear();
+  gatheredCounts.clear();
+  isEnabled = false;
+}
+
+#endif // HPCG_PERF_COUNTERS
@@ -0,0 +1,61 @@
+
+//@HEADER
+// ***************************************************
+//
+// HPCG: High Performance Conjugate Gradient Benchmark
+//
+// Contact:
+// Michael A. Heroux ( maherou@sandia.gov)
+// Jack Dongarra     (dongarra@eecs.utk.edu)
+// Piotr Luszczek    (luszczek@eecs.utk.edu)
+//
+// ***************************************************
+//@HEADER
+
+
+/*!
+ @file PerfCounters.hpp
+
+ HPCG data structures and routines for per-kernel hardware performance counters
+ */
+
+#ifndef PERFCOUNTERS_HPP
+#define PERFCOUNTERS_HPP
+
+#include "Geometry.hpp"
+
+class OutputFile;
+
+//! Code regions that are instrumented with performance counters
+enum PerfRegion {
+  PERF_SPMV = 0,   //!< ComputeSPMV (includes its halo exchange)
+  PERF_WAXPBY = 1, //!< ComputeWAXPBY
+  PERF_DOT = 2,    //!< ComputeDotProduct (includes the MPI_Allreduce)
+  PERF_HALO = 3,   //!< ExchangeHalo
+  PERF_SYMGS = 4   //!< ComputeSYMGS on level 0, level l uses PERF_SYMGS+l
+};
+
+const int perfMaxMgLevels = 16; //!< Number of MG levels with their own SYMGS counters, deeper levels share the last one
+const int perfNumberOfRegions = PERF_SYMGS + perfMaxMgLevels;
+
+#ifdef HPCG_PERF_COUNTERS
+
+void InitializePerfCounters(void);
+void EnablePerfCounters(bool enable);
+void StartPerfCounters(int region);
+void StopPerfCounters(int region);
+void GatherPerfCounters(const Geometry & geom);
+void ReportPerfCounters(OutputFile & doc);
+void DeletePerfCounters(void);
+
+#define HPCG_PERF_START(region) StartPerfCounters(region)
+#define HPCG_PERF_STOP(region) StopPerfCounters(region)
+
+#else
+
+#define HPCG_PERF_START(region) ((void) 0)
+#define HPCG_PERF_STOP(region) ((void) 0)
+
+#endif // HPCG_PERF_COUNTERS
+
+#endif // PERFCOUNTERS_HPP
@@ -0,0 +1,106 @@
+
+//@HEADER
+// ***************************************************
+//
+// HPCG: High Performance Conjugate Gradient Benchmark
+//
+// Contact:
+// Michael A. Heroux ( maherou@sandia.gov)
+// Jack Dongarra     (dongarra@eecs.utk.edu)
+// Piotr Luszczek    (luszczek@eecs.utk.edu)
+//
+// ***************************************************
+//@HEADER
+
+
+/*!
+ @file PersistentRegion.cpp
+
+ HPCG routines for running the CG iterations inside one long-lived OpenMP parallel region
+ */
+
+// Compile this routine only if the persistent region was requested
+#ifdef HPCG_PERSISTENT_REGION
+
+#include <omp.h>
+#include "PersistentRegion.hpp"
+
+bool isInPersistentRegion = false;
+
+// The team shares one array of slots, padded so that every thread writes to its own cache line: one slot per
+// thread for PersistentRegionSum and one for PersistentRegionBroadcast.  Successive calls alternate between two
+// copies of the slots, so that a thread may write the next values while others still read the previous ones.
+static const int slotStride = 8;
+static double * regionSlots = 0; //!< slots of the team of the calling thread
+static int regionParity = 0; //!< copy of the slots used by the next call
+#pragma omp threadprivate(regionSlots, regionParity)
+
+/*!
+  Returns the copy of the slots for the next collective call of the calling thread.
+*/
+static double * NextSlots(int numberOfThreads) {
+  double * slots = regionSlots + regionParity*(numberOfThreads+1)*slotStride;
+  regionParity = 1 - regionParity;
+  return slots;
+}
+
+/*!
+  Marks the calling thread as part of the persistent region.  Must be called by all threads of the region.
+*/
+void BeginPersistentRegion(void) {
+  double * slots = 0;
+#pragma omp single copyprivate(slots)
+  slots = new double[2*(omp_get_num_threads()+1)*slotStride];
+  regionSlots = slots;
+  regionParity = 0;
+  isInPersistentRegion = true;
+  return;
+}
+
+/*!
+  Ends the persistent region on the calling thread.  Must be called by all threads of the region.
+*/
+void EndPersistentRegion(void) {
+  isInPersistentRegion = false;
+#pragma omp barrier
+#pragma omp master
+  delete [] regionSlots;
+  regionSlots = 0;
+  return;
+}
+
+/*!
+  Sums one value per thread over the team of the persistent region, always in the order of the thread
+  numbers so that the result is reproducible.  Must be called by all threads of the region.
+
+  @param[in] value the contribution of the calling thread
+
+  @return the sum, on all threads
+*/
+double PersistentRegionSum(double value) {
+  const int numberOfThreads = omp_get_num_threads();
+  double * slots = NextSlots(numberOfThreads);
+  slots[omp_get_thread_num()*slotStride] = value;
+#pragma omp barrier
+  double sum = 0.0;
+  for (int i=0; i<numberOfThreads; ++i) sum += slots[i*slotStride];
+  return sum;
+}
+
+/*!
+  Hands the value of the master thread to all threads of the persistent region.  Must be called by all
+  threads of the region.
+
+  @param[in] value the value to broadcast, only used on the master thread
+
+  @return the value of the master thread
+*/
+double PersistentRegionBroadcast(double value) {
+  const int numberOfThreads = omp_get_num_threads();
+  double * slots = NextSlots(numberOfThreads);
+  if (omp_get_thread_num()==0) slots[numberOfThreads*slotStride] = value;
+#pragma omp barrier
+  return slots[numberOfThreads*slotStride];
+}
+
+#endif // HPCG_PERSISTENT_REGION
@@ -0,0 +1,67 @@
+
+//@HEADER
+// ***************************************************
+//
+// HPCG: High Performance Conjugate Gradient Benchmark
+//
+// Contact:
+// Michael A. Heroux ( maherou@sandia.gov)
+// Jack Dongarra     (dongarra@eecs.utk.edu)
+// Piotr Luszczek    (luszczek@eecs.utk.edu)
+//
+// ***************************************************
+//@HEADER
+
+
+/*!
+ @file PersistentRegion.hpp
+
+ HPCG routines for running the CG iterations inside one long-lived OpenMP parallel region
+ */
+
+#ifndef PERSISTENTREGION_HPP
+#define PERSISTENTREGION_HPP
+
+/*
+  With HPCG_PERSISTENT_REGION, CG opens one parallel region for all of its iterations instead of letting every
+  kernel fork and join a team of its own.  The threads of the region call the optimized kernels together; the
+  kernels notice the region with InPersistentRegion and split their loops with orphaned worksharing constructs.
+  Sequential parts (halo exchanges, MPI reductions, the Gauss-Seidel sweeps) run on the master thread and their
+  results are handed to the team with PersistentRegionBroadcast.
+*/
+#ifdef HPCG_PERSISTENT_REGION
+
+#ifdef HPCG_NO_OPENMP
+#error "HPCG_PERSISTENT_REGION requires OpenMP"
+#endif
+
+extern bool isInPersistentRegion; //!< true on the threads of the region between BeginPersistentRegion and EndPersistentRegion
+#pragma omp threadprivate(isInPersistentRegion)
+
+void BeginPersistentRegion(void);
+void EndPersistentRegion(void);
+double PersistentRegionSum(double value);
+double PersistentRegionBroadcast(double value);
+
+/*!
+  Returns true if the calling thread runs inside the persistent region of CG, so that the kernels must use
+  orphaned worksharing constructs instead of parallel regions of their own.
+*/
+inline bool InPersistentRegion(void) {
+  return isInPersistentRegion;
+}
+
+/*!
+  Hands the integer value of the master thread to all threads of the persistent region.
+
+  @param[in] value the value to broadcast, only used on the master thread
+
+  @return the value of the master thread
+*/
+inline int PersistentRegionBroadcast(int value) {
+  return (int) PersistentRegionBroadcast((double) value);
+}
+
+#endif // HPCG_PERSISTENT_REGION
+
+#endif // PERSISTENTREGION_HPP
@@ -0,0 +1,317 @@
+
+//@HEADER
+// ***************************************************
+//
+// HPCG: High Performance Conjugate Gradient Benchmark
+//
+// Contact:
+// Michael A. Heroux ( maherou@sandia.gov)
+// Jack Dongarra     (dongarra@eecs.utk.edu)
+// Piotr Luszczek    (luszczek@eecs.utk.edu)
+//
+// ***************************************************
+//@HEADER
+
+/*!
+ @file ReadProblem.cpp
+
+ HPCG routine
+ */
+
+#ifndef HPCG_NO_MPI
+#include <mpi.h>
+#endif
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <vector>
+using std::endl;
+
+#include "ReadProblem.hpp"
+#include "AssembleSparseMatrix.hpp"
+#include "GenerateGeometry.hpp"
+
+/*!
+  One nonzero of a Matrix Market file; sorting groups the entries by row and then by column.
+*/
+struct MatrixEntry {
+  global_int_t row;
+  global_int_t column;
+  double value;
+  bool operator<(const MatrixEntry & other) const {
+    return row<other.row || (row==other.row && column<other.column);
+  }
+};
+
+/*!
+  Computes the block of rows assigned to a process: rows are split in contiguous blocks of nearly equal size.
+*/
+static void ComputeRowRange(global_int_t totalNumberOfRows, int rank, int size, global_int_t & firstRow, global_int_t & lastRow) {
+  firstRow = (totalNumberOfRows*rank)/size;
+  lastRow = (totalNumberOfRows*(rank+1))/size;
+}
+
+/*!
+  Reads the next line that is not a Matrix Market comment.  Returns false at the end of the file.
+*/
+static bool ReadDataLine(FILE * file, char * line, int length) {
+  while (fgets(line, length, file)) {
+    if (line[0]=='%') continue;
+    const char * c = line;
+    while (isspace(*c)) ++c;
+    if (*c) return true; // Skip empty lines
+  }
+  return false;
+}
+
+/*!
+  Reads the banner line of a Matrix Market file and checks that the object is a matrix.
+
+  @param[in]  file     File positioned at its beginning
+  @param[out] format   "coordinate" or "array"
+  @param[out] symmetry "general", "symmetric", ...
+
+  @return Returns zero on success and -1 if the file is not a real Matrix Market matrix file.
+*/
+static int ReadMatrixMarketBanner(FILE * file, char * format, char * symmetry) {
+  char line[1024], banner[64], object[64], field[64];
+  if (!fgets(line, sizeof line, file)) return -1;
+  if (sscanf(line, "%63s %63s %63s %63s %63s", banner, object, format, field, symmetry)!=5) return -1;
+  for (char * c = line; *c; ++c) *c = tolower(*c);
+  for (char * c = object; *c; ++c) *c = tolower(*c);
+  for (char * c = format; *c; ++c) *c = tolower(*c);
+  for (char * c = field; *c; ++c) *c = tolower(*c);
+  for (char * c = symmetry; *c; ++c) *c = tolower(*c);
+  if (strncmp(line, "%%matrixmarket", 14) || strcmp(object, "matrix")) return -1;
+  if (strcmp(field, "real") && strcmp(field, "double") && strcmp(field, "integer")) return -1; // Pattern and complex matrices are not SPD systems
+  return 0;
+}
+
+/*!
+  Reads the rows of this process from a Matrix Market coordinate file.  The whole file is scanned by every
+  process, which keeps the entries of its own rows; for symmetric files the mirrored entries are added.
+  Duplicate entries are summed.
+
+  @return Returns zero on success and -1 if the file is not a square real coordinate matrix.
+*/
+static int ReadMatrixMarketMatrix(FILE * file, int rank, int size, global_int_t & totalNumberOfRows, global_int_t & firstRow,
+    std::vector< local_int_t > & rowStart, std::vector< global_int_t > & columnIndices, std::vector< double > & values) {
+
+  char format[64], symmetry[64], line[1024];
+  if (ReadMatrixMarketBanner(file, format, symmetry)) return -1;
+  if (strcmp(format, "coordinate")) return -1;
+  bool isSymmetric = strcmp(symmetry, "symmetric")==0;
+  if (!isSymmetric && strcmp(symmetry, "general")) return -1;
+
+  long long numberOfRows, numberOfColumns, numberOfEntries;
+  if (!ReadDataLine(file, line, sizeof line)) return -1;
+  if (sscanf(line, "%lld %lld %lld", &numberOfRows, &numberOfColumns, &numberOfEntries)!=3) return -1;
+  if (numberOfRows!=numberOfColumns || numberOfRows<=0) return -1;
+
+  global_int_t lastRow;
+  totalNumberOfRows = numberOfRows;
+  ComputeRowRange(totalNumberOfRows, rank, size, firstRow, lastRow);
+
+  std::vector< MatrixEntry > entries;
+  for (long long k=0; k<numberOfEntries; ++k) {
+    if (!ReadDataLine(file, line, sizeof line)) return -1;
+    char * end;
+    MatrixEntry entry;
+    entry.row = strtoll(line, &end, 10) - 1; // Matrix Market indices are 1-based
+    entry.column = strtoll(end, &end, 10) - 1;
+    entry.value = strtod(end, &end);
+    if (entry.row<0 || entry.row>=numberOfRows || entry.column<0 || entry.column>=numberOfColumns) return -1;
+    if (entry.row>=firstRow && entry.row<lastRow) entries.push_back(entry);
+    if (isSymmetric && entry.row!=entry.column && entry.column>=firstRow && entry.column<lastRow) {
+      std::swap(entry.row, entry.column);
+      entries.push_back(entry);
+    }
+  }
+  std::sort(entries.begin(), entries.end());
+
+  local_int_t localNumberOfRows = lastRow-firstRow;
+  rowStart.assign(localNumberOfRows+1, 0);
+  for (size_t k=0; k<entries.size(); ++k) {
+    if (k>0 && entries[k].row==entries[k-1].row && entries[k].column==entries[k-1].column) {
+      values.back() += entries[k].value;
+      continue;
+    }
+    columnIndices.push_back(entries[k].column);
+    values.push_back(entries[k].value);
+    ++rowStart[entries[k].row-firstRow+1];
+  }
+  for (local_int_t i=0; i<localNumberOfRows; ++i) rowStart[i+1] += rowStart[i];
+  return 0;
+}
+
+/*!
+  Reads the rows of this process from a binary CSR file as written by WriteProblem: each process reads
+  only its slices of the row pointer, column index and value arrays.
+
+  @return Returns zero on success and -1 if the file is truncated or not square.
+*/
+static int ReadBinaryMatrix(FILE * file, int rank, int size, global_int_t & totalNumberOfRows, global_int_t & firstRow,
+    std::vector< local_int_t > & rowStart, std::vector< global_int_t > & columnIndices, std::vector< double > & values) {
+
+  long long header[3]; // Number of rows, columns and nonzeros
+  if (fread(header, sizeof(long long), 3, file)!=3) return -1;
+  if (header[0]!=header[1] || header[0]<=0) return -1;
+
+  global_int_t lastRow;
+  totalNumberOfRows = header[0];
+  ComputeRowRange(totalNumberOfRows, rank, size, firstRow, lastRow);
+  local_int_t localNumberOfRows = lastRow-firstRow;
+
+  const long rowPointerStart = 8 + 3*sizeof(long long);
+  const long columnIndexStart = rowPointerStart + (header[0]+1)*sizeof(long long);
+  const long valueStart = columnIndexStart + header[2]*sizeof(long long);
+
+  std::vector< long long > rowPointers(localNumberOfRows+1);
+  if (fseek(file, rowPointerStart + firstRow*sizeof(long long), SEEK_SET)) return -1;
+  if (fread(&rowPointers[0], sizeof(long long), localNumberOfRows+1, file)!=(size_t) localNumberOfRows+1) return -1;
+  long long numberOfNonzeros = rowPointers[localNumberOfRows] - rowPointers[0];
+
+  std::vector< long long > columns(numberOfNonzeros);
+  values.resize(numberOfNonzeros);
+  if (numberOfNonzeros>0) {
+    if (fseek(file, columnIndexStart + rowPointers[0]*sizeof(long long), SEEK_SET)) return -1;
+    if (fread(&columns[0], sizeof(long long), numberOfNonzeros, file)!=(size_t) numberOfNonzeros) return -1;
+    if (fseek(file, valueStart + rowPointers[0]*sizeof(double), SEEK_SET)) return -1;
+    if (fread(&values[0], sizeof(double), numberOfNonzeros, file)!=(size_t) numberOfNonzeros) return -1;
+  }
+
+  rowStart.resize(localNumberOfRows+1);
+  for (local_int_t i=0; i<=localNumberOfRows; ++i) rowStart[i] = rowPointers[i] - rowPointers[0];
+  columnIndices.assign(columns.begin(), columns.end());
+  for (long long k=0; k<numberOfNonzeros; ++k)
+    if (columnIndices[k]<0 || columnIndices[k]>=totalNumberOfRows) return -1;
+  return 0;
+}
+
+/*!
+  Reads the rows of this process from a vector file: a Matrix Market array file or a binary vector file as written
+  by WriteProblem.
+
+  @return Returns zero on success and -1 if the file cannot be read or its length differs from totalNumberOfRows.
+*/
+static int ReadVector(const char * fileName, global_int_t totalNumberOfRows, global_int_t firstRow, local_int_t localNumberOfRows, double * values) {
+
+  FILE * file = fopen(fileName, "rb");
+  if (!file) return -1;
+
+  int ierr = 0;
+  char magic[8];
+  if (fread(magic, 1, 8, file)==8 && memcmp(magic, "HPCGVEC1", 8)==0) {
+    long long length;
+    if (fread(&length, sizeof(long long), 1, file)!=1 || length!=totalNumberOfRows) ierr = -1;
+    else if (fseek(file, 8 + sizeof(long long) + firstRow*sizeof(double), SEEK_SET)) ierr = -1;
+    else if (fread(values, sizeof(double), localNumberOfRows, file)!=(size_t) localNumberOfRows) ierr = -1;
+  } else {
+    rewind(file);
+    char format[64], symmetry[64], line[1024];
+    long long numberOfRows, numberOfColumns;
+    if (ReadMatrixMarketBanner(file, format, symmetry) || strcmp(format, "array") || !ReadDataLine(file, line, sizeof line)
+        || sscanf(line, "%lld %lld", &numberOfRows, &numberOfColumns)!=2 || numberOfRows!=totalNumberOfRows || numberOfColumns!=1) {
+      ierr = -1;
+    } else {
+      for (global_int_t i=0; i<firstRow+localNumberOfRows && ierr==0; ++i) {
+        if (!ReadDataLine(file, line, sizeof line)) ierr = -1;
+        else if (i>=firstRow) values[i-firstRow] = strtod(line, 0);
+      }
+    }
+  }
+
+  fclose(file);
+  return ierr;
+}
+
+/*!
+  Routine to read a user-supplied symmetric positive definite system instead of generating the 27-point problem.
+
+  The matrix is read from params.matrixFile, either a Matrix Market coordinate file (general or symmetric) or a binary
+  CSR file in the format written by WriteProblem.  Rows are distributed in contiguous blocks of nearly equal size,
+  and the geometry describes this one-dimensional row distribution (see GenerateRowGeometry).
+
+  The right hand side is read from params.rhsFile (Matrix Market array or binary vector) if given.  Otherwise it is
+  computed so that the exact solution is a vector of ones.  The initial guess is zero.
+
+  @param[in]    params The parameters of the run, including the file names
+  @param[out]   geom   The geometry of the row distribution
+  @param[inout] A      The system matrix, initialized with geom; its local column ids are set by SetupHalo
+  @param[out]   b      The right hand side vector
+  @param[out]   x      The solution vector with entries set to 0.0
+  @param[out]   xexact The vector of ones (the exact solution only if no right hand side file was given)
+
+  @return Returns zero on success and a non-zero value on all processes otherwise.
+
+  @see WriteProblem
+*/
+int ReadProblem(const HPCG_Params & params, Geometry * geom, SparseMatrix & A, Vector * b, Vector * x, Vector * xexact) {
+
+  int size = params.comm_size, rank = params.comm_rank;
+  global_int_t totalNumberOfRows = 0, firstRow = 0;
+  std::vector< local_int_t > rowStart;
+  std::vector< global_int_t > columnIndices;
+  std::vector< double > values;
+
+  int ierr = 0;
+  FILE * file = fopen(params.matrixFile, "rb");
+  if (!file) {
+    ierr = -1;
+  } else {
+    char magic[8];
+    if (fread(magic, 1, 8, file)==8 && memcmp(magic, "HPCGCSR1", 8)==0) {
+      ierr = ReadBinaryMatrix(file, rank, size, totalNumberOfRows, firstRow, rowStart, columnIndices, values);
+    } else {
+      rewind(file);
+      ierr = ReadMatrixMarketMatrix(file, rank, size, totalNumberOfRows, firstRow, rowStart, columnIndices, values);
+    }
+    fclose(file);
+  }
+  if (ierr==0 && totalNumberOfRows<size) ierr = -1; // Every process needs at least one row
+
+  local_int_t localNumberOfRows = ierr ? 0 : rowStart.size()-1;
+  std::vector< double > rhs(localNumberOfRows);
+  if (ierr==0 && params.rhsFile[0])
+    ierr = ReadVector(params.rhsFile, totalNumberOfRows, firstRow, localNumberOfRows, localNumberOfRows ? &rhs[0] : 0);
+
+#ifndef HPCG_NO_MPI
+  int localErr = ierr;
+  MPI_Allreduce(&localErr, &ierr, 1, MPI_INT, MPI_MIN, params.comm);
+#endif
+  if (ierr) {
+    if (rank==0) HPCG_fout << "Could not read the problem from " << params.matrixFile
+      << (params.rhsFile[0] ? " and " : "") << params.rhsFile << "." << endl;
+    return ierr;
+  }
+
+#ifndef HPCG_NO_MPI
+  geom->comm = params.comm;
+#endif
+  GenerateRowGeometry(size, rank, params.numThreads, localNumberOfRows, geom);
+  ierr = AssembleSparseMatrix(A, rowStart, columnIndices, values);
+  if (ierr) {
+    if (rank==0) HPCG_fout << "The matrix in " << params.matrixFile
+      << (ierr==1 ? " has rows with too many nonzeros." : " has rows without a diagonal entry.") << endl;
+    return ierr;
+  }
+  A.title = new char[strlen(params.matrixFile)+1];
+  strcpy(A.title, params.matrixFile);
+
+  if (b!=0) InitializeVector(*b, localNumberOfRows);
+  if (x!=0) InitializeVector(*x, localNumberOfRows);
+  if (xexact!=0) InitializeVector(*xexact, localNumberOfRows);
+  for (local_int_t i=0; i<localNumberOfRows; ++i) {
+    double rowSum = 0.0; // A times a vector of ones
+    for (local_int_t j=rowStart[i]; j<rowStart[i+1]; ++j) rowSum += values[j];
+    if (b!=0)      b->values[i] = params.rhsFile[0] ? rhs[i] : rowSum;
+    if (x!=0)      x->values[i] = 0.0;
+    if (xexact!=0) xexact->values[i] = 1.0;
+  }
+
+  return 0;
+}
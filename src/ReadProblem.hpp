@@ -0,0 +1,23 @@
+
+//@HEADER
+// ***************************************************
+//
+// HPCG: High Performance Conjugate Gradient Benchmark
+//
+// Contact:
+// Michael A. Heroux ( maherou@sandia.gov)
+// Jack Dongarra     (dongarra@eecs.utk.edu)
+// Piotr Luszczek    (luszczek@eecs.utk.edu)
+//
+// ***************************************************
+//@HEADER
+
+#ifndef READPROBLEM_HPP
+#define READPROBLEM_HPP
+#include "hpcg.hpp"
+#include "Geometry.hpp"
+#include "SparseMatrix.hpp"
+#include "Vector.hpp"
+
+int ReadProblem(const HPCG_Params & params, Geometry * geom, SparseMatrix & A, Vector * b, Vector * x, Vector * xexact);
+#endif // READPROBLEM_HPP
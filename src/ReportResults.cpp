@@ -22,10 +22,12 @@
 #include <mpi.h>
 #endif
 
+#include <sstream>
 #include <vector>
 #include "ReportResults.hpp"
 #include "OutputFile.hpp"
 #include "OptimizeProblem.hpp"
+#include "PerfCounters.hpp"
 
 #ifdef HPCG_DEBUG
 #include <fstream>
@@ -34,6 +36,240 @@ using std::endl;
 #include "hpcg.hpp"
 #endif
 
+/*!
+  Number of visits of a level per application of a multigrid cycle (see GetCoarseVisits): once for the V-cycle,
+  2^level times for the W-cycle and 2*level times for the F-cycle.
+
+  @param[in] cycle the cycle applied on the finest level
+  @param[in] level the multigrid level (0 for the finest)
+*/
+static double MGLevelVisits(MGCycle cycle, int level) {
+  if (level==0) return 1.0;
+  MGCycle visits[2];
+  int numberOfVisits = GetCoarseVisits(cycle, visits);
+  double count = 0.0;
+  for (int i=0; i<numberOfVisits; ++i) count += MGLevelVisits(visits[i], level-1);
+  return count;
+}
+
+#ifdef HPCG_REPLICATED_COARSE_SOLVE
+/*!
+  Model of one exact solve of the coarsest level with the replicated Cholesky factor (see ComputeMG): the right hand
+  side is gathered on every process that owns rows of the level, and each of them runs the forward and the backward
+  substitution on the band.
+
+  @param[in] Ac the coarsest level matrix, with Ac.coarseCholesky set up
+  @param[out] flops the floating point operations of one solve, counted once although every process repeats them
+  @param[out] reads the bytes read by all processes in one solve
+  @param[out] writes the bytes written by all processes in one solve, including the gathered right hand side
+*/
+static void CoarseCholeskySolveModel(const SparseMatrix & Ac, double & flops, double & reads, double & writes) {
+  double fnrow = Ac.totalNumberOfRows;
+  double fnbandwidth = Ac.coarseCholesky->bandwidth;
+  double fnprocesses = ((double) Ac.geom->npx)*Ac.geom->npy*Ac.geom->npz;
+  double fnband = fnrow*fnbandwidth - fnbandwidth*(fnbandwidth+1.0)/2.0; // Entries of L below the diagonal
+  flops = 2.0*(2.0*fnband + fnrow); // Both substitutions: a multiply-add per band entry and a division per row
+  reads = fnprocesses*(2.0*(fnband+fnrow)*sizeof(double) + fnrow*(sizeof(double)+sizeof(global_int_t))); // The band twice, gathered and its rows
+  writes = fnprocesses*4.0*fnrow*sizeof(double); // MPI_Allgatherv into gathered, the scatter and both substitutions
+  return;
+}
+#endif
+
+/*!
+  Memory traffic model for one level of the multigrid cycle in ComputeMG.
+
+  @param[in] Af the matrix of the level; Af.mgData must be defined
+  @param[in] fniters the number of visits of the level (see MGLevelVisits)
+  @param[out] reads the number of bytes read in each MGPhase (MG_COARSE_SOLVE is set to zero)
+  @param[out] writes the number of bytes written in each MGPhase (MG_COARSE_SOLVE is set to zero)
+*/
+static void MGLevelMemoryModel(const SparseMatrix & Af, double fniters, double reads[], double writes[]) {
+  double fnnz_Af = Af.totalNumberOfNonzeros;
+  double fnrow_Af = Af.totalNumberOfRows;
+  double fnrow_Ac = Af.Ac->totalNumberOfRows;
+  double fnumberOfPresmootherSteps = Af.mgData->numberOfPresmootherSteps;
+  double fnumberOfPostsmootherSteps = Af.mgData->numberOfPostsmootherSteps;
+  // Injection touches one fine row per coarse row, aggregation touches every fine row
+  double fntransfer = (Af.mgData->f2cOffsets!=0) ? fnrow_Af : fnrow_Ac;
+
+  reads[MG_PRESMOOTH] = fnumberOfPresmootherSteps*fniters*(2.0*fnnz_Af*(sizeof(double)+sizeof(local_int_t)) + fnrow_Af*sizeof(double)); // number of presmoother reads
+  writes[MG_PRESMOOTH] = fnumberOfPresmootherSteps*fniters*fnrow_Af*sizeof(double); // number of presmoother writes
+  reads[MG_RESIDUAL] = fniters*(fnnz_Af*(sizeof(double)+sizeof(local_int_t)) + fnrow_Af*sizeof(double)); // Number of reads for fine grid residual calculation
+  writes[MG_RESIDUAL] = fniters*fnnz_Af*sizeof(double); // Number of writes for fine grid residual calculation
+  reads[MG_RESTRICTION] = fniters*fntransfer*(2.0*sizeof(double)+sizeof(local_int_t)); // r and Axf at the f2c rows, plus f2cOperator
+  writes[MG_RESTRICTION] = fniters*fnrow_Ac*sizeof(double); // rc
+  reads[MG_COARSE_SOLVE] = 0.0;
+  writes[MG_COARSE_SOLVE] = 0.0;
+  reads[MG_PROLONGATION] = fniters*(fnrow_Ac*sizeof(double) + fntransfer*(sizeof(double)+sizeof(local_int_t))); // xc, x at the f2c rows, plus f2cOperator
+  writes[MG_PROLONGATION] = fniters*fntransfer*sizeof(double); // x at the f2c rows
+  reads[MG_POSTSMOOTH] = fnumberOfPostsmootherSteps*fniters*(2.0*fnnz_Af*(sizeof(double)+sizeof(local_int_t)) + fnrow_Af*sizeof(double));  // number of postsmoother reads
+  writes[MG_POSTSMOOTH] = fnumberOfPostsmootherSteps*fniters*fnnz_Af*sizeof(double);  // number of postsmoother writes
+  if (Af.mgData->fullWeighting!=0) {
+    // Full weighting: 27 weights per coarse row, the interpolation stores the same weights by fine row
+    double fnweights = 27.0*fnrow_Ac;
+    reads[MG_RESTRICTION] = fniters*(2.0*fnrow_Af*sizeof(double) + fnweights*(2.0*sizeof(double)+sizeof(local_int_t)) + fnrow_Ac*sizeof(local_int_t)); // r, Axf, then Axf and the weights
+    writes[MG_RESTRICTION] = fniters*(fnrow_Af*sizeof(double) + fnrow_Ac*sizeof(double)); // fine residual in Axf, rc
+    reads[MG_PROLONGATION] = fniters*(fnweights*(2.0*sizeof(double)+sizeof(local_int_t)) + fnrow_Af*(sizeof(double)+sizeof(local_int_t))); // xc and the weights, x
+    writes[MG_PROLONGATION] = fniters*fnrow_Af*sizeof(double); // every fine row of x
+  }
+#ifdef HPCG_FUSED_RESIDUAL
+  if (Af.mgData->numberOfPresmootherSteps>0) { // ComputeMG forms the residual in the last presmoother step and times it there
+    reads[MG_PRESMOOTH] += reads[MG_RESIDUAL];
+    writes[MG_PRESMOOTH] += writes[MG_RESIDUAL];
+    reads[MG_RESIDUAL] = 0.0;
+    writes[MG_RESIDUAL] = 0.0;
+  }
+#endif
+  return;
+}
+
+/*!
+  Adds the roofline position of one kernel to the report.
+
+  @param[inout] roofline  the report element the kernel is added to
+  @param[in]    name      the name of the kernel
+  @param[in]    flops     the modeled floating point operations of the kernel
+  @param[in]    bytes     the modeled memory traffic (bytes) of the kernel
+  @param[in]    time      the measured time (sec) of the kernel
+  @param[in]    bandwidth the measured STREAM Triad bandwidth (GB/s)
+*/
+static void AddRooflineKernel(OutputFile * roofline, const std::string & name, double flops, double bytes, double time, double bandwidth) {
+  if (time<=0.0 || bytes<=0.0) return;
+  roofline->add(name,"");
+  OutputFile * kernel = roofline->get(name);
+  double achieved = bytes/time/1.0E9;
+  kernel->add("Achieved GB/s",achieved);
+  kernel->add("Fraction of STREAM Triad",achieved/bandwidth);
+  kernel->add("Arithmetic intensity (flop/byte)",flops/bytes);
+  kernel->add("Achieved GFLOP/s",flops/time/1.0E9);
+  kernel->add("Bandwidth bound GFLOP/s",flops/bytes*bandwidth);
+  return;
+}
+
+/*!
+  FLOP count model of the optimized CG sets, see CG.cpp and ComputeMG.cpp.
+
+  @param[in] A the fine grid matrix; the multigrid hierarchy must be defined
+  @param[in] numberOfMgLevels the number of levels in the hierarchy (including the fine grid)
+  @param[in] fniters the total number of CG iterations
+  @param[in] fNumberOfCgSets the number of CG sets
+  @param[in] cycle the multigrid cycle of the preconditioner
+  @param[out] fnops_ddot floating point operations in dot products
+  @param[out] fnops_waxpby floating point operations in WAXPBY
+  @param[out] fnops_sparsemv floating point operations in SpMV
+  @param[out] fnops_precond floating point operations in the multigrid preconditioner
+*/
+void ComputeFlopModel(const SparseMatrix & A, int numberOfMgLevels, double fniters, double fNumberOfCgSets, MGCycle cycle,
+    double & fnops_ddot, double & fnops_waxpby, double & fnops_sparsemv, double & fnops_precond) {
+
+  double fnrow = A.totalNumberOfRows;
+  double fnnz = A.totalNumberOfNonzeros;
+
+  // Op counts come from implementation of CG in CG.cpp (include 1 extra for the CG preamble ops)
+  fnops_ddot = (3.0*fniters+fNumberOfCgSets)*2.0*fnrow; // 3 ddots with nrow adds and nrow mults
+  fnops_waxpby = (3.0*fniters+fNumberOfCgSets)*2.0*fnrow; // 3 WAXPBYs with nrow adds and nrow mults
+  fnops_sparsemv = (fniters+fNumberOfCgSets)*2.0*fnnz; // 1 SpMV with nnz adds and nnz mults
+  // Op counts from the multigrid preconditioners
+  fnops_precond = 0.0;
+  const SparseMatrix * Af = &A;
+  for (int i=1; i<numberOfMgLevels; ++i) {
+    double fnnz_Af = Af->totalNumberOfNonzeros;
+    double fnumberOfPresmootherSteps = Af->mgData->numberOfPresmootherSteps;
+    double fnumberOfPostsmootherSteps = Af->mgData->numberOfPostsmootherSteps;
+    double fnvisits = fniters*MGLevelVisits(cycle, i-1); // W- and F-cycles visit the coarse levels more than once
+    fnops_precond += fnumberOfPresmootherSteps*fnvisits*4.0*fnnz_Af; // number of presmoother flops
+    fnops_precond += fnvisits*2.0*fnnz_Af; // cost of fine grid residual calculation
+    fnops_precond += fnumberOfPostsmootherSteps*fnvisits*4.0*fnnz_Af;  // number of postsmoother flops
+    Af = Af->Ac; // Go to next coarse level
+  }
+
+  double fnops_coarsest = 4.0*((double) Af->totalNumberOfNonzeros); // One symmetric GS sweep at the coarsest level
+#ifdef HPCG_REPLICATED_COARSE_SOLVE
+  double fnreads_cholesky, fnwrites_cholesky;
+  if (Af->coarseCholesky!=0) CoarseCholeskySolveModel(*Af, fnops_coarsest, fnreads_cholesky, fnwrites_cholesky); // Exact solve instead
+#endif
+  fnops_precond += fniters*MGLevelVisits(cycle, numberOfMgLevels-1)*fnops_coarsest;
+  return;
+}
+
+/*!
+  Memory usage model of the problem data, excluding the benchmarker-provided OptimizeProblemMemoryUse.
+
+  @param[in] A the fine grid matrix; the multigrid hierarchy must be defined
+  @param[in] numberOfMgLevels the number of levels in the hierarchy (including the fine grid)
+  @param[in] fNumberOfCgSets the number of CG sets
+  @param[out] fnbytesPerLevel the bytes used on each level (level 0 is main CG level); must hold numberOfMgLevels entries
+
+  @return the total number of bytes over all processes
+*/
+double ComputeMemoryUseModel(const SparseMatrix & A, int numberOfMgLevels, double fNumberOfCgSets, std::vector<double> & fnbytesPerLevel) {
+
+  double fnrow = A.totalNumberOfRows;
+
+  // Data in GenerateProblem_ref
+
+  double numberOfNonzerosPerRow = 27.0; // We are approximating a 27-point finite element/volume/difference 3D stencil
+  double size = ((double) A.geom->size); // Needed for estimating size of halo
+
+  double fnbytes = ((double) sizeof(Geometry));      // Geometry struct in main.cpp
+  fnbytes += ((double) sizeof(double)*fNumberOfCgSets); // testnorms_data in main.cpp
+
+  // Model for GenerateProblem_ref.cpp
+  fnbytes += fnrow*sizeof(char);      // array nonzerosInRow
+  fnbytes += fnrow*((double) sizeof(global_int_t*)); // mtxIndG
+  fnbytes += fnrow*((double) sizeof(local_int_t*));  // mtxIndL
+  fnbytes += fnrow*((double) sizeof(double*));      // matrixValues
+  fnbytes += fnrow*((double) sizeof(double*));      // matrixDiagonal
+  fnbytes += fnrow*numberOfNonzerosPerRow*((double) sizeof(local_int_t));  // mtxIndL[1..nrows]
+  fnbytes += fnrow*numberOfNonzerosPerRow*((double) sizeof(double));       // matrixValues[1..nrows]
+  fnbytes += fnrow*numberOfNonzerosPerRow*((double) sizeof(global_int_t)); // mtxIndG[1..nrows]
+  fnbytes += fnrow*((double) 3*sizeof(double)); // x, b, xexact
+
+  // Model for CGData.hpp
+  double fncol = ((global_int_t) A.localNumberOfColumns) * size; // Estimate of the global number of columns using the value from rank 0
+  fnbytes += fnrow*((double) 2*sizeof(double)); // r, Ap
+  fnbytes += fncol*((double) 2*sizeof(double)); // z, p
+
+  fnbytesPerLevel[0] = fnbytes;
+
+  const SparseMatrix * Af = A.Ac;
+  for (int i=1; i<numberOfMgLevels; ++i) {
+    double fnrow_Af = Af->totalNumberOfRows;
+    double fncol_Af = ((global_int_t) Af->localNumberOfColumns) * size; // Estimate of the global number of columns using the value from rank 0
+    double fnbytes_Af = 0.0;
+    // Model for GenerateCoarseProblem.cpp
+    fnbytes_Af += fnrow_Af*((double) sizeof(local_int_t)); // f2cOperator
+    fnbytes_Af += fnrow_Af*((double) sizeof(double)); // rc
+    fnbytes_Af += 2.0*fncol_Af*((double) sizeof(double)); // xc, Axf are estimated based on the size of these arrays on rank 0
+    fnbytes_Af += ((double) (sizeof(Geometry)+sizeof(SparseMatrix)+3*sizeof(Vector)+sizeof(MGData))); // Account for structs geomc, Ac, rc, xc, Axf - (minor)
+
+    // Model for GenerateProblem.cpp (called within GenerateCoarseProblem.cpp)
+    fnbytes_Af += fnrow_Af*sizeof(char);      // array nonzerosInRow
+    fnbytes_Af += fnrow_Af*((double) sizeof(global_int_t*)); // mtxIndG
+    fnbytes_Af += fnrow_Af*((double) sizeof(local_int_t*));  // mtxIndL
+    fnbytes_Af += fnrow_Af*((double) sizeof(double*));      // matrixValues
+    fnbytes_Af += fnrow_Af*((double) sizeof(double*));      // matrixDiagonal
+    fnbytes_Af += fnrow_Af*numberOfNonzerosPerRow*((double) sizeof(local_int_t));  // mtxIndL[1..nrows]
+    fnbytes_Af += fnrow_Af*numberOfNonzerosPerRow*((double) sizeof(double));       // matrixValues[1..nrows]
+    fnbytes_Af += fnrow_Af*numberOfNonzerosPerRow*((double) sizeof(global_int_t)); // mtxIndG[1..nrows]
+
+    // Model for SetupHalo_ref.cpp
+#ifndef HPCG_NO_MPI
+    fnbytes_Af += ((double) sizeof(double)*Af->totalToBeSent); //sendBuffer
+    fnbytes_Af += ((double) sizeof(local_int_t)*Af->totalToBeSent); // elementsToSend
+    fnbytes_Af += ((double) sizeof(int)*Af->numberOfSendNeighbors); // neighbors
+    fnbytes_Af += ((double) sizeof(local_int_t)*Af->numberOfSendNeighbors); // receiveLength, sendLength
+#endif
+    fnbytesPerLevel[i] = fnbytes_Af;
+    fnbytes += fnbytes_Af; // Running sum
+    Af = Af->Ac; // Go to next coarse level
+  }
+
+  assert(Af==0); // Make sure we got to the lowest grid level
+
+  return fnbytes;
+}
+
 /*!
  Creates a YAML file and writes the information about the HPCG run, its results, and validity.
 
@@ -42,16 +278,20 @@ using std::endl;
   @param[in] numberOfMgLevels Number of levels in multigrid V cycle
   @param[in] numberOfCgSets Number of CG runs performed
   @param[in] niters Number of preconditioned CG iterations performed to lower the residual below a threshold
+  @param[in] toleranceIters the largest number of iterations the optimized CG, with the selected transfer and cycle, needed to reach the reference tolerance
+  @param[in] toleranceTime the worst time (sec) across processes of an optimized CG solve to the reference tolerance
   @param[in] times  Vector of cumulative timings for each of the phases of a preconditioned CG iteration
   @param[in] testcg_data    the data structure with the results of the CG-correctness test including pass/fail information
   @param[in] testsymmetry_data the data structure with the results of the CG symmetry test including pass/fail information
   @param[in] testnorms_data the data structure with the results of the CG norm test including pass/fail information
+  @param[in] stream_data the memory bandwidth measured by RunStreamBenchmark
   @param[in] global_failure indicates whether a failure occurred during the correctness tests of CG
 
   @see YAML_Doc
 */
-void ReportResults(const SparseMatrix & A, int numberOfMgLevels, int numberOfCgSets, int refMaxIters,int optMaxIters, double times[],
-    const TestCGData & testcg_data, const TestSymmetryData & testsymmetry_data, const TestNormsData & testnorms_data, int global_failure, bool quickPath) {
+void ReportResults(const SparseMatrix & A, int numberOfMgLevels, int numberOfCgSets, int refMaxIters,int optMaxIters,
+    int toleranceIters, double toleranceTime, double times[],
+    const TestCGData & testcg_data, const TestSymmetryData & testsymmetry_data, const TestNormsData & testnorms_data, const StreamData & stream_data, int global_failure, bool quickPath) {
 
   double minOfficialTime = 1800; // Any official benchmark result must run at least this many seconds
 
@@ -60,15 +300,30 @@ void ReportResults(const SparseMatrix & A, int numberOfMgLevels, int numberOfCgS
   double t4min = 0.0;
   double t4max = 0.0;
   double t4avg = 0.0;
-  MPI_Allreduce(&t4, &t4min, 1, MPI_DOUBLE, MPI_MIN, MPI_COMM_WORLD);
-  MPI_Allreduce(&t4, &t4max, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
-  MPI_Allreduce(&t4, &t4avg, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+  MPI_Allreduce(&t4, &t4min, 1, MPI_DOUBLE, MPI_MIN, A.geom->comm);
+  MPI_Allreduce(&t4, &t4max, 1, MPI_DOUBLE, MPI_MAX, A.geom->comm);
+  MPI_Allreduce(&t4, &t4avg, 1, MPI_DOUBLE, MPI_SUM, A.geom->comm);
   t4avg = t4avg/((double) A.geom->size);
 #endif
 
+#ifdef HPCG_PERF_COUNTERS
+  GatherPerfCounters(*A.geom); // Collective, so all processes call it
+#endif
+
+  // Per-level multigrid times measured by ComputeMG, maximum over all processes
+  std::vector<double> mgTimes((numberOfMgLevels-1)*MG_NUMBER_OF_PHASES, 0.0);
+  const SparseMatrix * Amg = &A;
+  for (int i=0; i<numberOfMgLevels-1; ++i) {
+    for (int j=0; j<MG_NUMBER_OF_PHASES; ++j) mgTimes[i*MG_NUMBER_OF_PHASES+j] = Amg->mgData->times[j];
+    Amg = Amg->Ac;
+  }
+#ifndef HPCG_NO_MPI
+  if (!mgTimes.empty()) MPI_Allreduce(MPI_IN_PLACE, &mgTimes[0], mgTimes.size(), MPI_DOUBLE, MPI_MAX, A.geom->comm);
+#endif
+
   if (A.geom->rank==0) { // Only PE 0 needs to compute and report timing results
 
-    // TODO: Put the FLOP count, Memory BW and Memory Usage models into separate functions
+    // TODO: Put the Memory BW model into a separate function
 
     // ======================== FLOP count model =======================================
 
@@ -77,26 +332,28 @@ void ReportResults(const SparseMatrix & A, int numberOfMgLevels, int numberOfCgS
     double fnrow = A.totalNumberOfRows;
     double fnnz = A.totalNumberOfNonzeros;
 
-    // Op counts come from implementation of CG in CG.cpp (include 1 extra for the CG preamble ops)
-    double fnops_ddot = (3.0*fniters+fNumberOfCgSets)*2.0*fnrow; // 3 ddots with nrow adds and nrow mults
-    double fnops_waxpby = (3.0*fniters+fNumberOfCgSets)*2.0*fnrow; // 3 WAXPBYs with nrow adds and nrow mults
-    double fnops_sparsemv = (fniters+fNumberOfCgSets)*2.0*fnnz; // 1 SpMV with nnz adds and nnz mults
-    // Op counts from the multigrid preconditioners
-    double fnops_precond = 0.0;
-    const SparseMatrix * Af = &A;
-    for (int i=1; i<numberOfMgLevels; ++i) {
-      double fnnz_Af = Af->totalNumberOfNonzeros;
-      double fnumberOfPresmootherSteps = Af->mgData->numberOfPresmootherSteps;
-      double fnumberOfPostsmootherSteps = Af->mgData->numberOfPostsmootherSteps;
-      fnops_precond += fnumberOfPresmootherSteps*fniters*4.0*fnnz_Af; // number of presmoother flops
-      fnops_precond += fniters*2.0*fnnz_Af; // cost of fine grid residual calculation
-      fnops_precond += fnumberOfPostsmootherSteps*fniters*4.0*fnnz_Af;  // number of postsmoother flops
-      Af = Af->Ac; // Go to next coarse level
-    }
-
-    fnops_precond += fniters*4.0*((double) Af->totalNumberOfNonzeros); // One symmetric GS sweep at the coarsest level
+    const MGCycle cycle = A.mgData!=0 ? A.mgData->cycle : MG_V_CYCLE;
+    double fnops_ddot, fnops_waxpby, fnops_sparsemv, fnops_precond;
+    ComputeFlopModel(A, numberOfMgLevels, fniters, fNumberOfCgSets, cycle, fnops_ddot, fnops_waxpby, fnops_sparsemv, fnops_precond);
     double fnops = fnops_ddot+fnops_waxpby+fnops_sparsemv+fnops_precond;
-    double frefnops = fnops * ((double) refMaxIters)/((double) optMaxIters);
+    // The reference tolerance was reached with V-cycles, so the convergence-adjusted count credits their work only
+    double fnops_vcycle = fnops;
+    if (cycle!=MG_V_CYCLE) {
+      double fnops_vcycle_precond;
+      ComputeFlopModel(A, numberOfMgLevels, fniters, fNumberOfCgSets, MG_V_CYCLE, fnops_ddot, fnops_waxpby, fnops_sparsemv, fnops_vcycle_precond);
+      fnops_vcycle = fnops - fnops_precond + fnops_vcycle_precond;
+    }
+#ifdef HPCG_REPLICATED_COARSE_SOLVE
+    // The reference smoothed the coarsest level with one SYMGS step, so only that work is credited
+    const SparseMatrix * coarsest = &A;
+    while (coarsest->Ac!=0) coarsest = coarsest->Ac;
+    if (coarsest->coarseCholesky!=0) {
+      double fnops_cholesky, fnreads_cholesky, fnwrites_cholesky;
+      CoarseCholeskySolveModel(*coarsest, fnops_cholesky, fnreads_cholesky, fnwrites_cholesky);
+      fnops_vcycle += fniters*(4.0*((double) coarsest->totalNumberOfNonzeros) - fnops_cholesky);
+    }
+#endif
+    double frefnops = fnops_vcycle * ((double) refMaxIters)/((double) optMaxIters);
 
     // ======================== Memory bandwidth model =======================================
 
@@ -111,99 +368,62 @@ void ReportResults(const SparseMatrix & A, int numberOfMgLevels, int numberOfCgS
     // Op counts from the multigrid preconditioners
     double fnreads_precond = 0.0;
     double fnwrites_precond = 0.0;
-    Af = &A;
+    double fnbytes_vcycle_precond = 0.0; // The same with one visit per level, see frefnops
+    // Per-level model, the last entry is the coarsest level (smoother only)
+    std::vector<double> fnreadsPerLevel(numberOfMgLevels*MG_NUMBER_OF_PHASES, 0.0);
+    std::vector<double> fnwritesPerLevel(numberOfMgLevels*MG_NUMBER_OF_PHASES, 0.0);
+    const SparseMatrix * Af = &A;
     for (int i=1; i<numberOfMgLevels; ++i) {
-      double fnnz_Af = Af->totalNumberOfNonzeros;
-      double fnrow_Af = Af->totalNumberOfRows;
-      double fnumberOfPresmootherSteps = Af->mgData->numberOfPresmootherSteps;
-      double fnumberOfPostsmootherSteps = Af->mgData->numberOfPostsmootherSteps;
-      fnreads_precond += fnumberOfPresmootherSteps*fniters*(2.0*fnnz_Af*(sizeof(double)+sizeof(local_int_t)) + fnrow_Af*sizeof(double)); // number of presmoother reads
-      fnwrites_precond += fnumberOfPresmootherSteps*fniters*fnrow_Af*sizeof(double); // number of presmoother writes
-      fnreads_precond += fniters*(fnnz_Af*(sizeof(double)+sizeof(local_int_t)) + fnrow_Af*sizeof(double)); // Number of reads for fine grid residual calculation
-      fnwrites_precond += fniters*fnnz_Af*sizeof(double); // Number of writes for fine grid residual calculation
-      fnreads_precond += fnumberOfPostsmootherSteps*fniters*(2.0*fnnz_Af*(sizeof(double)+sizeof(local_int_t)) + fnrow_Af*sizeof(double));  // number of postsmoother reads
-      fnwrites_precond += fnumberOfPostsmootherSteps*fniters*fnnz_Af*sizeof(double);  // number of postsmoother writes
+      double * levelReads = &fnreadsPerLevel[(i-1)*MG_NUMBER_OF_PHASES];
+      double * levelWrites = &fnwritesPerLevel[(i-1)*MG_NUMBER_OF_PHASES];
+      MGLevelMemoryModel(*Af, fniters*MGLevelVisits(cycle, i-1), levelReads, levelWrites);
+      // Restriction and prolongation are not part of the benchmark's bandwidth model
+      fnreads_precond += levelReads[MG_PRESMOOTH] + levelReads[MG_RESIDUAL] + levelReads[MG_POSTSMOOTH];
+      fnwrites_precond += levelWrites[MG_PRESMOOTH] + levelWrites[MG_RESIDUAL] + levelWrites[MG_POSTSMOOTH];
+      fnbytes_vcycle_precond += (levelReads[MG_PRESMOOTH] + levelReads[MG_RESIDUAL] + levelReads[MG_POSTSMOOTH]
+          + levelWrites[MG_PRESMOOTH] + levelWrites[MG_RESIDUAL] + levelWrites[MG_POSTSMOOTH])/MGLevelVisits(cycle, i-1);
       Af = Af->Ac; // Go to next coarse level
     }
 
     double fnnz_Af = Af->totalNumberOfNonzeros;
     double fnrow_Af = Af->totalNumberOfRows;
-    fnreads_precond += fniters*(2.0*fnnz_Af*(sizeof(double)+sizeof(local_int_t)) + fnrow_Af*sizeof(double));; // One symmetric GS sweep at the coarsest level
-    fnwrites_precond += fniters*fnrow_Af*sizeof(double); // One symmetric GS sweep at the coarsest level
+    double fnvisits_coarsest = fniters*MGLevelVisits(cycle, numberOfMgLevels-1);
+    double fnreads_coarsest = fnvisits_coarsest*(2.0*fnnz_Af*(sizeof(double)+sizeof(local_int_t)) + fnrow_Af*sizeof(double)); // One symmetric GS sweep at the coarsest level
+    double fnwrites_coarsest = fnvisits_coarsest*fnrow_Af*sizeof(double); // One symmetric GS sweep at the coarsest level
+    fnbytes_vcycle_precond += (fnreads_coarsest + fnwrites_coarsest)/MGLevelVisits(cycle, numberOfMgLevels-1); // The reference work, see frefnops
+#ifdef HPCG_REPLICATED_COARSE_SOLVE
+    if (Af->coarseCholesky!=0) { // Exact solve instead
+      double fnops_cholesky, fnreads_cholesky, fnwrites_cholesky;
+      CoarseCholeskySolveModel(*Af, fnops_cholesky, fnreads_cholesky, fnwrites_cholesky);
+      fnreads_coarsest = fnvisits_coarsest*fnreads_cholesky;
+      fnwrites_coarsest = fnvisits_coarsest*fnwrites_cholesky;
+    }
+#endif
+    fnreads_precond += fnreads_coarsest;
+    fnwrites_precond += fnwrites_coarsest;
+    fnreadsPerLevel[(numberOfMgLevels-1)*MG_NUMBER_OF_PHASES+MG_PRESMOOTH] = fnreads_coarsest;
+    fnwritesPerLevel[(numberOfMgLevels-1)*MG_NUMBER_OF_PHASES+MG_PRESMOOTH] = fnwrites_coarsest;
+    // The coarse solve of a level moves the data of all coarser levels
+    for (int i=numberOfMgLevels-2; i>=0; --i) {
+      for (int j=0; j<MG_NUMBER_OF_PHASES; ++j) {
+        fnreadsPerLevel[i*MG_NUMBER_OF_PHASES+MG_COARSE_SOLVE] += fnreadsPerLevel[(i+1)*MG_NUMBER_OF_PHASES+j];
+        fnwritesPerLevel[i*MG_NUMBER_OF_PHASES+MG_COARSE_SOLVE] += fnwritesPerLevel[(i+1)*MG_NUMBER_OF_PHASES+j];
+      }
+    }
     double fnreads = fnreads_ddot+fnreads_waxpby+fnreads_sparsemv+fnreads_precond;
     double fnwrites = fnwrites_ddot+fnwrites_waxpby+fnwrites_sparsemv+fnwrites_precond;
-    double frefnreads = fnreads * ((double) refMaxIters)/((double) optMaxIters);
-    double frefnwrites = fnwrites * ((double) refMaxIters)/((double) optMaxIters);
+    double frefnbytes = (fnreads + fnwrites - fnreads_precond - fnwrites_precond + fnbytes_vcycle_precond) * ((double) refMaxIters)/((double) optMaxIters);
 
 
     // ======================== Memory usage model =======================================
 
-    // Data in GenerateProblem_ref
-
-    double numberOfNonzerosPerRow = 27.0; // We are approximating a 27-point finite element/volume/difference 3D stencil
-    double size = ((double) A.geom->size); // Needed for estimating size of halo
-
-    double fnbytes = ((double) sizeof(Geometry));      // Geometry struct in main.cpp
-    fnbytes += ((double) sizeof(double)*fNumberOfCgSets); // testnorms_data in main.cpp
-
-    // Model for GenerateProblem_ref.cpp
-    fnbytes += fnrow*sizeof(char);      // array nonzerosInRow
-    fnbytes += fnrow*((double) sizeof(global_int_t*)); // mtxIndG
-    fnbytes += fnrow*((double) sizeof(local_int_t*));  // mtxIndL
-    fnbytes += fnrow*((double) sizeof(double*));      // matrixValues
-    fnbytes += fnrow*((double) sizeof(double*));      // matrixDiagonal
-    fnbytes += fnrow*numberOfNonzerosPerRow*((double) sizeof(local_int_t));  // mtxIndL[1..nrows]
-    fnbytes += fnrow*numberOfNonzerosPerRow*((double) sizeof(double));       // matrixValues[1..nrows]
-    fnbytes += fnrow*numberOfNonzerosPerRow*((double) sizeof(global_int_t)); // mtxIndG[1..nrows]
-    fnbytes += fnrow*((double) 3*sizeof(double)); // x, b, xexact
-
-    // Model for CGData.hpp
-    double fncol = ((global_int_t) A.localNumberOfColumns) * size; // Estimate of the global number of columns using the value from rank 0
-    fnbytes += fnrow*((double) 2*sizeof(double)); // r, Ap
-    fnbytes += fncol*((double) 2*sizeof(double)); // z, p
-
     std::vector<double> fnbytesPerLevel(numberOfMgLevels); // Count byte usage per level (level 0 is main CG level)
-    fnbytesPerLevel[0] = fnbytes;
+    double fnbytes = ComputeMemoryUseModel(A, numberOfMgLevels, fNumberOfCgSets, fnbytesPerLevel);
 
     // Benchmarker-provided model for OptimizeProblem.cpp
     double fnbytes_OptimizedProblem = OptimizeProblemMemoryUse(A);
     fnbytes += fnbytes_OptimizedProblem;
 
-    Af = A.Ac;
-    for (int i=1; i<numberOfMgLevels; ++i) {
-      double fnrow_Af = Af->totalNumberOfRows;
-      double fncol_Af = ((global_int_t) Af->localNumberOfColumns) * size; // Estimate of the global number of columns using the value from rank 0
-      double fnbytes_Af = 0.0;
-      // Model for GenerateCoarseProblem.cpp
-      fnbytes_Af += fnrow_Af*((double) sizeof(local_int_t)); // f2cOperator
-      fnbytes_Af += fnrow_Af*((double) sizeof(double)); // rc
-      fnbytes_Af += 2.0*fncol_Af*((double) sizeof(double)); // xc, Axf are estimated based on the size of these arrays on rank 0
-      fnbytes_Af += ((double) (sizeof(Geometry)+sizeof(SparseMatrix)+3*sizeof(Vector)+sizeof(MGData))); // Account for structs geomc, Ac, rc, xc, Axf - (minor)
-
-      // Model for GenerateProblem.cpp (called within GenerateCoarseProblem.cpp)
-      fnbytes_Af += fnrow_Af*sizeof(char);      // array nonzerosInRow
-      fnbytes_Af += fnrow_Af*((double) sizeof(global_int_t*)); // mtxIndG
-      fnbytes_Af += fnrow_Af*((double) sizeof(local_int_t*));  // mtxIndL
-      fnbytes_Af += fnrow_Af*((double) sizeof(double*));      // matrixValues
-      fnbytes_Af += fnrow_Af*((double) sizeof(double*));      // matrixDiagonal
-      fnbytes_Af += fnrow_Af*numberOfNonzerosPerRow*((double) sizeof(local_int_t));  // mtxIndL[1..nrows]
-      fnbytes_Af += fnrow_Af*numberOfNonzerosPerRow*((double) sizeof(double));       // matrixValues[1..nrows]
-      fnbytes_Af += fnrow_Af*numberOfNonzerosPerRow*((double) sizeof(global_int_t)); // mtxIndG[1..nrows]
-
-      // Model for SetupHalo_ref.cpp
-#ifndef HPCG_NO_MPI
-      fnbytes_Af += ((double) sizeof(double)*Af->totalToBeSent); //sendBuffer
-      fnbytes_Af += ((double) sizeof(local_int_t)*Af->totalToBeSent); // elementsToSend
-      fnbytes_Af += ((double) sizeof(int)*Af->numberOfSendNeighbors); // neighbors
-      fnbytes_Af += ((double) sizeof(local_int_t)*Af->numberOfSendNeighbors); // receiveLength, sendLength
-#endif
-      fnbytesPerLevel[i] = fnbytes_Af;
-      fnbytes += fnbytes_Af; // Running sum
-      Af = Af->Ac; // Go to next coarse level
-    }
-
-    assert(Af==0); // Make sure we got to the lowest grid level
-
     // Count number of bytes used per equation
     double fnbytesPerEquation = fnbytes/fnrow;
 
@@ -224,6 +444,7 @@ void ReportResults(const SparseMatrix & A, int numberOfMgLevels, int numberOfCgS
     doc.get("Processor Dimensions")->add("npx",A.geom->npx);
     doc.get("Processor Dimensions")->add("npy",A.geom->npy);
     doc.get("Processor Dimensions")->add("npz",A.geom->npz);
+    doc.get("Processor Dimensions")->add("Node-aware placement",A.geom->processRanks!=0 ? 1 : 0);
 
     doc.add("Local Domain Dimensions","");
     doc.get("Local Domain Dimensions")->add("nx",A.geom->nx);
@@ -246,19 +467,35 @@ void ReportResults(const SparseMatrix & A, int numberOfMgLevels, int numberOfCgS
     doc.add("Linear System Information","");
     doc.get("Linear System Information")->add("Number of Equations",A.totalNumberOfRows);
     doc.get("Linear System Information")->add("Number of Nonzero Terms",A.totalNumberOfNonzeros);
+    if (A.title) doc.get("Linear System Information")->add("Matrix File",A.title); // User-supplied system
 
     doc.add("Multigrid Information","");
     doc.get("Multigrid Information")->add("Number of coarse grid levels", numberOfMgLevels-1);
+    doc.get("Multigrid Information")->add("Coarsening", A.geom->rowOffsets ? "Aggregation" : "Geometric");
+    const char * cycleNames[] = {"V-cycle", "W-cycle", "F-cycle"};
+    doc.get("Multigrid Information")->add("Cycle", cycleNames[A.mgData!=0 ? A.mgData->cycle : MG_V_CYCLE]);
     Af = &A;
     doc.get("Multigrid Information")->add("Coarse Grids","");
     for (int i=1; i<numberOfMgLevels; ++i) {
       doc.get("Multigrid Information")->get("Coarse Grids")->add("Grid Level",i);
       doc.get("Multigrid Information")->get("Coarse Grids")->add("Number of Equations",Af->Ac->totalNumberOfRows);
       doc.get("Multigrid Information")->get("Coarse Grids")->add("Number of Nonzero Terms",Af->Ac->totalNumberOfNonzeros);
+      doc.get("Multigrid Information")->get("Coarse Grids")->add("Visits per Preconditioner Application",MGLevelVisits(cycle, i));
       doc.get("Multigrid Information")->get("Coarse Grids")->add("Number of Presmoother Steps",Af->mgData->numberOfPresmootherSteps);
       doc.get("Multigrid Information")->get("Coarse Grids")->add("Number of Postsmoother Steps",Af->mgData->numberOfPostsmootherSteps);
+      doc.get("Multigrid Information")->get("Coarse Grids")->add("Number of Threads",Af->Ac->numberOfThreads>0 ? Af->Ac->numberOfThreads : A.geom->numThreads);
+      doc.get("Multigrid Information")->get("Coarse Grids")->add("Number of Processes",Af->Ac->geom->npx*Af->Ac->geom->npy*Af->Ac->geom->npz);
+      doc.get("Multigrid Information")->get("Coarse Grids")->add("Transfer Operator",Af->mgData->f2cOffsets ? "Aggregation" : (Af->mgData->fullWeighting ? "Full weighting" : "Injection"));
       Af = Af->Ac;
     }
+#ifdef HPCG_REPLICATED_COARSE_SOLVE
+    if (Af->coarseCholesky!=0) {
+      doc.get("Multigrid Information")->add("Coarsest Level Solve","Replicated Cholesky");
+      doc.get("Multigrid Information")->add("Coarsest Level Cholesky Bandwidth",(long long) Af->coarseCholesky->bandwidth);
+    }
+    else
+#endif
+    doc.get("Multigrid Information")->add("Coarsest Level Solve","Symmetric Gauss-Seidel");
 
     doc.add("########## Memory Use Summary  ##########","");
 
@@ -308,6 +545,13 @@ void ReportResults(const SparseMatrix & A, int numberOfMgLevels, int numberOfCgS
     doc.get("Iteration Count Information")->add("Total number of reference iterations", refMaxIters*numberOfCgSets);
     doc.get("Iteration Count Information")->add("Total number of optimized iterations", optMaxIters*numberOfCgSets);
 
+    doc.add("Multigrid Transfer Summary","");
+    doc.get("Multigrid Transfer Summary")->add("Transfer Operator", A.mgData==0 ? "None" : (A.mgData->f2cOffsets ? "Aggregation" : (A.mgData->fullWeighting ? "Full weighting" : "Injection")));
+    doc.get("Multigrid Transfer Summary")->add("Cycle", cycleNames[A.mgData!=0 ? A.mgData->cycle : MG_V_CYCLE]);
+    doc.get("Multigrid Transfer Summary")->add("Reference tolerance from", "Injection, V-cycle");
+    doc.get("Multigrid Transfer Summary")->add("Iterations to tolerance", toleranceIters);
+    doc.get("Multigrid Transfer Summary")->add("Time to solution (sec)", toleranceTime);
+
     doc.add("########## Reproducibility Summary  ##########","");
     doc.add("Reproducibility Information","");
     if (testnorms_data.pass)
@@ -339,8 +583,86 @@ void ReportResults(const SparseMatrix & A, int numberOfMgLevels, int numberOfCgS
     doc.get("GB/s Summary")->add("Raw Read B/W",fnreads/times[0]/1.0E9);
     doc.get("GB/s Summary")->add("Raw Write B/W",fnwrites/times[0]/1.0E9);
     doc.get("GB/s Summary")->add("Raw Total B/W",(fnreads+fnwrites)/(times[0])/1.0E9);
-    doc.get("GB/s Summary")->add("Total with convergence and optimization phase overhead",(frefnreads+frefnwrites)/(times[0]+fNumberOfCgSets*(times[7]/10.0+times[9]/10.0))/1.0E9);
+    doc.get("GB/s Summary")->add("Total with convergence and optimization phase overhead",frefnbytes/(times[0]+fNumberOfCgSets*(times[7]/10.0+times[9]/10.0))/1.0E9);
+
+
+    doc.add("Multigrid Level Summary","");
+    const char * phaseNames[MG_NUMBER_OF_PHASES] = {"Pre-smoothing", "Residual SpMV", "Restriction", "Coarse solve", "Prolongation", "Post-smoothing"};
+    for (int i=0; i<numberOfMgLevels-1; ++i) {
+      std::ostringstream levelName;
+      levelName << "Grid Level " << i;
+      doc.get("Multigrid Level Summary")->add(levelName.str(),"");
+      OutputFile * level = doc.get("Multigrid Level Summary")->get(levelName.str());
+      double levelTime = 0.0, levelBytes = 0.0; // This level only, without the coarse solve
+      for (int j=0; j<MG_NUMBER_OF_PHASES; ++j) {
+        double t = mgTimes[i*MG_NUMBER_OF_PHASES+j];
+        double bytes = fnreadsPerLevel[i*MG_NUMBER_OF_PHASES+j]+fnwritesPerLevel[i*MG_NUMBER_OF_PHASES+j];
+        if (j==MG_RESIDUAL && bytes==0.0) continue; // Counted as pre-smoothing (HPCG_FUSED_RESIDUAL)
+        level->add(std::string(phaseNames[j])+" time (sec)",t);
+        level->add(std::string(phaseNames[j])+" GB/s",(t>0.0) ? bytes/t/1.0E9 : 0.0);
+        if (j!=MG_COARSE_SOLVE) {
+          levelTime += t;
+          levelBytes += bytes;
+        }
+      }
+      level->add("Level time without coarse solve (sec)",levelTime);
+      level->add("Level GB/s without coarse solve",(levelTime>0.0) ? levelBytes/levelTime/1.0E9 : 0.0);
+    }
 
+    // SYMGS share of the multigrid models and timers: smoothing on every level plus the sweep on the coarsest level, unless it is solved exactly
+    double fnops_symgs = 0.0, fnbytes_symgs = 0.0, time_symgs = 0.0;
+    Af = &A;
+    for (int i=0; i<numberOfMgLevels; ++i) {
+      int phase = i*MG_NUMBER_OF_PHASES;
+      if (i<numberOfMgLevels-1) {
+        double fnumberOfSweeps = Af->mgData->numberOfPresmootherSteps + Af->mgData->numberOfPostsmootherSteps;
+        fnops_symgs += fnumberOfSweeps*fniters*MGLevelVisits(cycle, i)*4.0*((double) Af->totalNumberOfNonzeros);
+#ifdef HPCG_FUSED_RESIDUAL
+        if (Af->mgData->numberOfPresmootherSteps>0) // The pre-smoothing bytes and time include the fused residual SpMV
+          fnops_symgs += fniters*MGLevelVisits(cycle, i)*2.0*((double) Af->totalNumberOfNonzeros);
+#endif
+        fnbytes_symgs += fnreadsPerLevel[phase+MG_PRESMOOTH] + fnwritesPerLevel[phase+MG_PRESMOOTH];
+        fnbytes_symgs += fnreadsPerLevel[phase+MG_POSTSMOOTH] + fnwritesPerLevel[phase+MG_POSTSMOOTH];
+        time_symgs += mgTimes[phase+MG_PRESMOOTH] + mgTimes[phase+MG_POSTSMOOTH];
+        Af = Af->Ac;
+      } else {
+#ifdef HPCG_REPLICATED_COARSE_SOLVE
+        if (Af->coarseCholesky!=0) continue; // Solved exactly, no SYMGS sweep
+#endif
+        fnops_symgs += fniters*MGLevelVisits(cycle, i)*4.0*((double) Af->totalNumberOfNonzeros);
+        fnbytes_symgs += fnreadsPerLevel[phase+MG_PRESMOOTH] + fnwritesPerLevel[phase+MG_PRESMOOTH];
+        time_symgs += (i>0) ? mgTimes[phase-MG_NUMBER_OF_PHASES+MG_COARSE_SOLVE] : times[5]; // The coarse solve of the level above
+      }
+    }
+
+    doc.add("Roofline","");
+    OutputFile * roofline = doc.get("Roofline");
+    roofline->add("STREAM array length per process",(long long) stream_data.arrayLength);
+    roofline->add("STREAM Copy GB/s",stream_data.copy);
+    roofline->add("STREAM Triad GB/s",stream_data.triad);
+    roofline->add("STREAM by thread count","");
+    for (size_t i=0; i<stream_data.threadCounts.size(); ++i) {
+      std::ostringstream name;
+      name << "Threads " << stream_data.threadCounts[i];
+      roofline->get("STREAM by thread count")->add(name.str(),"");
+      roofline->get("STREAM by thread count")->get(name.str())->add("Copy GB/s",stream_data.copyPerThreadCount[i]);
+      roofline->get("STREAM by thread count")->get(name.str())->add("Triad GB/s",stream_data.triadPerThreadCount[i]);
+    }
+    if (!stream_data.triadPerNumaNode.empty()) {
+      roofline->add("STREAM by NUMA node","");
+      for (size_t i=0; i<stream_data.triadPerNumaNode.size(); ++i) {
+        std::ostringstream name;
+        name << "Node " << i;
+        roofline->get("STREAM by NUMA node")->add(name.str(),"");
+        roofline->get("STREAM by NUMA node")->get(name.str())->add("Copy GB/s",stream_data.copyPerNumaNode[i]);
+        roofline->get("STREAM by NUMA node")->get(name.str())->add("Triad GB/s",stream_data.triadPerNumaNode[i]);
+      }
+    }
+    AddRooflineKernel(roofline, "SpMV", fnops_sparsemv, fnreads_sparsemv+fnwrites_sparsemv, times[3], stream_data.triad);
+    AddRooflineKernel(roofline, "SYMGS", fnops_symgs, fnbytes_symgs, time_symgs, stream_data.triad);
+    AddRooflineKernel(roofline, "WAXPBY", fnops_waxpby, fnreads_waxpby+fnwrites_waxpby, times[2], stream_data.triad);
+    AddRooflineKernel(roofline, "DDOT", fnops_ddot, fnreads_ddot+fnwrites_ddot, times[1], stream_data.triad);
+    AddRooflineKernel(roofline, "MG", fnops_precond, fnreads_precond+fnwrites_precond, times[5], stream_data.triad);
 
     doc.add("GFLOP/s Summary","");
     doc.get("GFLOP/s Summary")->add("Raw DDOT",fnops_ddot/times[1]/1.0E9);
@@ -367,6 +689,11 @@ void ReportResults(const SparseMatrix & A, int numberOfMgLevels, int numberOfCgS
     //doc.get("Sparse Operations Overheads")->add("Halo exchange time (sec)", (times[6]));
     //doc.get("Sparse Operations Overheads")->add("Halo exchange as percentage of SpMV time", (times[6])/totalSparseMVTime*100.0);
 #endif
+
+#ifdef HPCG_PERF_COUNTERS
+    ReportPerfCounters(doc);
+#endif
+
     doc.add("Final Summary","");
     bool isValidRun = (testcg_data.count_fail==0) && (testsymmetry_data.count_fail==0) && (testnorms_data.pass) && (!global_failure);
     if (isValidRun) {
@@ -14,12 +14,18 @@
 
 #ifndef REPORTRESULTS_HPP
 #define REPORTRESULTS_HPP
+#include <vector>
 #include "SparseMatrix.hpp"
 #include "TestCG.hpp"
 #include "TestSymmetry.hpp"
 #include "TestNorms.hpp"
+#include "StreamBenchmark.hpp"
 
-void ReportResults(const SparseMatrix & A, int numberOfMgLevels, int numberOfCgSets, int refMaxIters, int optMaxIters, double times[],
-    const TestCGData & testcg_data, const TestSymmetryData & testsymmetry_data, const TestNormsData & testnorms_data, int global_failure, bool quickPath);
+void ComputeFlopModel(const SparseMatrix & A, int numberOfMgLevels, double fniters, double fNumberOfCgSets, MGCycle cycle,
+    double & fnops_ddot, double & fnops_waxpby, double & fnops_sparsemv, double & fnops_precond);
+double ComputeMemoryUseModel(const SparseMatrix & A, int numberOfMgLevels, double fNumberOfCgSets, std::vector<double> & fnbytesPerLevel);
+void ReportResults(const SparseMatrix & A, int numberOfMgLevels, int numberOfCgSets, int refMaxIters, int optMaxIters,
+    int toleranceIters, double toleranceTime, double times[],
+    const TestCGData & testcg_data, const TestSymmetryData & testsymmetry_data, const TestNormsData & testnorms_data, const StreamData & stream_data, int global_failure, bool quickPath);
 
 #endif // REPORTRESULTS_HPP
@@ -31,6 +31,88 @@
 #include "SetupHalo.hpp"
 #include "SetupHalo_ref.hpp"
 
+#if defined(HPCG_SHARED_HALO) && !defined(HPCG_NO_MPI)
+/*!
+  Allocates the send buffer of this process in an MPI-3 shared memory window of its node and finds, for every
+  neighbor on the same node, where the values for this process are in the neighbor's send buffer, so that
+  ExchangeHalo can copy them directly instead of passing messages.
+
+  @param[inout] A The known system matrix, with the halo data of SetupHalo_ref
+
+  @see ExchangeHalo
+*/
+static void SetupSharedHalo(SparseMatrix & A) {
+
+  int numberOfNeighbors = A.numberOfSendNeighbors;
+  SharedHalo * halo = new SharedHalo;
+  MPI_Comm_split_type(A.geom->comm, MPI_COMM_TYPE_SHARED, A.geom->rank, MPI_INFO_NULL, &halo->nodeComm);
+
+  // Flags first, then the send buffer; each process' part may be allocated close to it
+  MPI_Info info;
+  MPI_Info_create(&info);
+  MPI_Info_set(info, (char *) "alloc_shared_noncontig", (char *) "true");
+  MPI_Aint windowSize = 2*sizeof(long long) + A.totalToBeSent*sizeof(double);
+  char * base = 0;
+  MPI_Win_allocate_shared(windowSize, 1, info, halo->nodeComm, &base, &halo->window);
+  MPI_Info_free(&info);
+  MPI_Win_lock_all(MPI_MODE_NOCHECK, halo->window); // Passive target epoch for the lifetime of the window
+  halo->flags = (volatile long long *) base;
+  halo->flags[0] = halo->flags[1] = 0;
+  halo->sendBuffer = (double *) (base + 2*sizeof(long long));
+  halo->numberOfExchanges = 0;
+
+  // Which neighbors are on this node, and their rank in the node communicator
+  int * nodeRanks = new int[numberOfNeighbors];
+  MPI_Group commGroup, nodeGroup;
+  MPI_Comm_group(A.geom->comm, &commGroup);
+  MPI_Comm_group(halo->nodeComm, &nodeGroup);
+  MPI_Group_translate_ranks(commGroup, numberOfNeighbors, A.neighbors, nodeGroup, nodeRanks);
+  MPI_Group_free(&commGroup);
+  MPI_Group_free(&nodeGroup);
+
+  // Tell every neighbor where its values start in this process' send buffer
+  local_int_t * sendOffsets = new local_int_t[numberOfNeighbors];
+  local_int_t * receiveOffsets = new local_int_t[numberOfNeighbors];
+  MPI_Request * requests = new MPI_Request[2*numberOfNeighbors];
+  local_int_t offset = 0;
+  for (int i=0; i<numberOfNeighbors; ++i) {
+    sendOffsets[i] = offset;
+    offset += A.sendLength[i];
+  }
+  for (int i=0; i<numberOfNeighbors; ++i) {
+    MPI_Irecv(receiveOffsets+i, sizeof(local_int_t), MPI_BYTE, A.neighbors[i], 98, A.geom->comm, requests+i);
+    MPI_Isend(sendOffsets+i, sizeof(local_int_t), MPI_BYTE, A.neighbors[i], 98, A.geom->comm, requests+numberOfNeighbors+i);
+  }
+  MPI_Waitall(2*numberOfNeighbors, requests, MPI_STATUSES_IGNORE);
+
+  halo->isOnNode = new bool[numberOfNeighbors];
+  halo->neighborValues = new const double *[numberOfNeighbors];
+  halo->neighborFlags = new volatile long long *[numberOfNeighbors];
+  for (int i=0; i<numberOfNeighbors; ++i) {
+    halo->isOnNode[i] = nodeRanks[i]!=MPI_UNDEFINED;
+    halo->neighborValues[i] = 0;
+    halo->neighborFlags[i] = 0;
+    if (halo->isOnNode[i]) {
+      MPI_Aint neighborSize;
+      int displacementUnit;
+      char * neighborBase = 0;
+      MPI_Win_shared_query(halo->window, nodeRanks[i], &neighborSize, &displacementUnit, &neighborBase);
+      halo->neighborFlags[i] = (volatile long long *) neighborBase;
+      halo->neighborValues[i] = ((const double *) (neighborBase + 2*sizeof(long long))) + receiveOffsets[i];
+    }
+  }
+  delete [] requests;
+  delete [] receiveOffsets;
+  delete [] sendOffsets;
+  delete [] nodeRanks;
+
+  MPI_Win_sync(halo->window);
+  MPI_Barrier(halo->nodeComm); // Flags are initialized before any process reads them
+  A.sharedHalo = halo;
+  return;
+}
+#endif
+
 /*!
   Prepares system matrix data structure and creates data necessary necessary
   for communication of boundary values of this process.
@@ -45,5 +127,9 @@ void SetupHalo(SparseMatrix & A) {
   // However, any code must work for general unstructured sparse matrices.  Special knowledge about the
   // specific nature of the sparsity pattern may not be explicitly used.
 
-  return(SetupHalo_ref(A));
+  SetupHalo_ref(A);
+#if defined(HPCG_SHARED_HALO) && !defined(HPCG_NO_MPI)
+  SetupSharedHalo(A);
+#endif
+  return;
 }
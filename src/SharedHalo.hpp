@@ -0,0 +1,56 @@
+
+//@HEADER
+// ***************************************************
+//
+// HPCG: High Performance Conjugate Gradient Benchmark
+//
+// Contact:
+// Michael A. Heroux ( maherou@sandia.gov)
+// Jack Dongarra     (dongarra@eecs.utk.edu)
+// Piotr Luszczek    (luszczek@eecs.utk.edu)
+//
+// ***************************************************
+//@HEADER
+
+
+/*!
+ @file SharedHalo.hpp
+
+ HPCG data structure for the intra-node halo exchange through an MPI-3 shared memory window
+ */
+
+#ifndef SHAREDHALO_HPP
+#define SHAREDHALO_HPP
+
+#if defined(HPCG_SHARED_HALO) && !defined(HPCG_NO_MPI)
+#include <mpi.h>
+
+struct SharedHalo_STRUCT {
+  MPI_Comm nodeComm; //!< the processes on this node
+  MPI_Win window; //!< shared window with the flags and the send buffer of every process of the node
+  volatile long long * flags; //!< this process' flags in the window: [0] last exchange packed, [1] last exchange whose on-node values were read
+  double * sendBuffer; //!< this process' send buffer in the window (replaces SparseMatrix::sendBuffer in ExchangeHalo)
+  long long numberOfExchanges; //!< number of halo exchanges so far
+  bool * isOnNode; //!< for each neighbor of the matrix: true if it is on this node
+  const double ** neighborValues; //!< for each on-node neighbor: the values for this process in its send buffer (0 for other neighbors)
+  volatile long long ** neighborFlags; //!< for each on-node neighbor: its flags (0 for other neighbors)
+};
+typedef struct SharedHalo_STRUCT SharedHalo;
+
+/*!
+  Deallocates the shared window and the data of the intra-node halo exchange.  Collective over the processes of the node.
+
+  @param[inout] halo the data structure whose storage is deallocated
+ */
+inline void DeleteSharedHalo(SharedHalo & halo) {
+  MPI_Win_unlock_all(halo.window);
+  MPI_Win_free(&halo.window);
+  MPI_Comm_free(&halo.nodeComm);
+  delete [] halo.isOnNode;
+  delete [] halo.neighborValues;
+  delete [] halo.neighborFlags;
+  return;
+}
+#endif // HPCG_SHARED_HALO
+
+#endif // SHAREDHALO_HPP
@@ -0,0 +1,228 @@
+
+//@HEADER
+// ***************************************************
+//
+// HPCG: High Performance Conjugate Gradient Benchmark
+//
+// Contact:
+// Michael A. Heroux ( maherou@sandia.gov)
+// Jack Dongarra     (dongarra@eecs.utk.edu)
+// Piotr Luszczek    (luszczek@eecs.utk.edu)
+//
+// ***************************************************
+//@HEADER
+
+/*!
+ @file Solver.cpp
+
+ HPCG routine
+ */
+
+#ifndef HPCG_NO_MPI
+#include <mpi.h>
+#endif
+
+#ifndef HPCG_NO_OPENMP
+#include <omp.h>
+#endif
+
+#include <cstring>
+
+#include "Solver.hpp"
+#include "CG.hpp"
+#include "CGMulti.hpp"
+#include "ComputeNodeAwareProcessGrid.hpp"
+#include "GenerateCoarseProblem.hpp"
+#include "GenerateGeometry.hpp"
+#include "GenerateProblem.hpp"
+#include "OptimizeProblem.hpp"
+#include "ReadProblem.hpp"
+#include "SetupHalo.hpp"
+
+Solver::Solver() : numberOfMultiDataVectors(0), numberOfMgLevels(0), isSetup(false), isOptimized(false), times(9, 0.0) {
+}
+
+Solver::~Solver() {
+  Teardown();
+}
+
+/*!
+  Constructs the linear system, its halo exchange data, the multigrid hierarchy and the CG work vectors,
+  in the same way as the benchmark driver.
+
+  @param[in] params The parameters of the run: the local grid dimensions and process grid, or the file names
+  of a user-supplied problem (see HPCG_Params)
+
+  @return Returns zero on success and a non-zero value otherwise.
+*/
+int Solver::Setup(const HPCG_Params & params) {
+
+  Teardown();
+
+  Geometry * geom = new Geometry(); // Zero-initialized so that a failed read can be cleaned up
+#ifndef HPCG_NO_MPI
+  geom->comm = params.comm;
+#endif
+  InitializeSparseMatrix(A, geom);
+  if (params.matrixFile[0]!='\0') {
+    int ierr = ReadProblem(params, geom, A, &b, &x, &xexact);
+    if (ierr) {
+      DeleteGeometry(*geom);
+      delete geom;
+      InitializeSparseMatrix(A, 0);
+      return ierr;
+    }
+  } else {
+    int npx = params.npx, npy = params.npy, npz = params.npz;
+    int * processRanks = 0; // Lexicographic placement of the ranks unless node-aware mapping is requested
+    if (params.nodeAwareMapping)
+      ComputeNodeAwareProcessGrid(params, params.nx, params.ny, params.nz, npx, npy, npz, processRanks);
+    GenerateGeometry(params.comm_size, params.comm_rank, params.numThreads, params.pz, params.zl, params.zu,
+        params.nx, params.ny, params.nz, npx, npy, npz, processRanks, geom);
+    delete [] processRanks;
+    GenerateProblem(A, &b, &x, &xexact);
+  }
+  SetupHalo(A);
+
+  numberOfMgLevels = 4; // Number of levels including first
+  SparseMatrix * curLevelMatrix = &A;
+  for (int level = 1; level< numberOfMgLevels; ++level) {
+    GenerateCoarseProblem(*curLevelMatrix);
+    if (curLevelMatrix->Ac==0) { // Aggregation-based coarsening may stop early
+      numberOfMgLevels = level;
+      break;
+    }
+    if (params.transferOperator==1) GenerateFullWeighting(*curLevelMatrix); // Instead of injection
+    curLevelMatrix->mgData->cycle = (MGCycle) params.multigridCycle;
+    curLevelMatrix = curLevelMatrix->Ac;
+  }
+
+  InitializeSparseCGData(A, data);
+  isSetup = true;
+  return 0;
+}
+
+/*!
+  Sets up the generated 27-point problem on a local grid of nx by ny by nz points per process, using all
+  processes of MPI_COMM_WORLD and all OpenMP threads.
+
+  @return Returns zero on success and a non-zero value otherwise.
+*/
+int Solver::Setup(local_int_t nx, local_int_t ny, local_int_t nz) {
+#ifndef HPCG_NO_MPI
+  return Setup(nx, ny, nz, MPI_COMM_WORLD);
+}
+
+/*!
+  Sets up the generated 27-point problem on a local grid of nx by ny by nz points per process, using the
+  processes of comm (collective over comm) and all OpenMP threads.
+
+  @return Returns zero on success and a non-zero value otherwise.
+*/
+int Solver::Setup(local_int_t nx, local_int_t ny, local_int_t nz, MPI_Comm comm) {
+#endif
+
+  HPCG_Params params;
+  memset(&params, 0, sizeof params);
+#ifndef HPCG_NO_MPI
+  params.comm = comm;
+  MPI_Comm_rank(comm, &params.comm_rank);
+  MPI_Comm_size(comm, &params.comm_size);
+#else
+  params.comm_rank = 0;
+  params.comm_size = 1;
+#endif
+#ifdef HPCG_NO_OPENMP
+  params.numThreads = 1;
+#else
+  #pragma omp parallel
+  params.numThreads = omp_get_num_threads();
+#endif
+  params.nx = nx;
+  params.ny = ny;
+  params.nz = nz;
+  return Setup(params);
+}
+
+/*!
+  Calls the user-tunable OptimizeProblem once for the current system.
+
+  @return Returns zero on success and a non-zero value otherwise.
+*/
+int Solver::Optimize() {
+  if (!isSetup) return -1;
+  if (isOptimized) return 0;
+  int ierr = OptimizeProblem(A, data, b, x, xexact);
+  isOptimized = (ierr==0);
+  return ierr;
+}
+
+/*!
+  Solves A*solution = rhs with the optimized multigrid-preconditioned CG.
+
+  @param[in]    rhs       The right hand side, one entry per local row of the matrix
+  @param[inout] solution  On entry: the initial guess; on exit: the approximate solution (one entry per local row)
+  @param[in]    maxIters  The maximum number of iterations to perform
+  @param[in]    tolerance The stopping criterion on the scaled residual norm
+  @param[out]   niters    The number of iterations actually performed
+  @param[out]   normr     The 2-norm of the residual vector after the last iteration
+  @param[out]   normr0    The 2-norm of the residual vector before the first iteration
+  @param[in]    doPreconditioning The flag to indicate whether the multigrid preconditioner should be used
+
+  @return Returns zero on success and a non-zero value otherwise.
+
+  @see CG
+*/
+int Solver::Solve(const Vector & rhs, Vector & solution, int maxIters, double tolerance, int & niters, double & normr, double & normr0,
+    bool doPreconditioning) {
+  if (!isSetup || rhs.localLength!=A.localNumberOfRows || solution.localLength<A.localNumberOfRows) return -1;
+  return CG(A, data, rhs, solution, maxIters, tolerance, niters, normr, normr0, &times[0], doPreconditioning);
+}
+
+/*!
+  Solves A*solution_j = rhs_j for a block of right hand sides with the block version of CG, which reads the
+  matrix once per kernel call for all of them.  The work blocks are kept for later solves with the same number
+  of right hand sides.
+
+  @param[in]    rhs       The block of right hand sides, one entry per local row of the matrix
+  @param[inout] solution  On entry: the initial guesses; on exit: the approximate solutions
+  @param[in]    maxIters  The maximum number of iterations to perform
+  @param[in]    tolerance The stopping criterion on the scaled residual norm of every right hand side
+  @param[out]   niters    The number of iterations actually performed
+  @param[out]   normr     The 2-norms of the residual vectors after the last iteration (one per right hand side)
+  @param[out]   normr0    The 2-norms of the residual vectors before the first iteration (one per right hand side)
+  @param[in]    doPreconditioning The flag to indicate whether the multigrid preconditioner should be used
+
+  @return Returns zero on success and a non-zero value otherwise.
+
+  @see CGMulti
+*/
+int Solver::Solve(const MultiVector & rhs, MultiVector & solution, int maxIters, double tolerance, int & niters, double * normr, double * normr0,
+    bool doPreconditioning) {
+  if (!isSetup || rhs.localLength!=A.localNumberOfRows || solution.localLength<A.localNumberOfRows
+      || rhs.numberOfVectors!=solution.numberOfVectors) return -1;
+  if (numberOfMultiDataVectors!=rhs.numberOfVectors) {
+    if (numberOfMultiDataVectors>0) DeleteCGMultiData(multiData);
+    InitializeCGMultiData(A, rhs.numberOfVectors, multiData);
+    numberOfMultiDataVectors = rhs.numberOfVectors;
+  }
+  return CGMulti(A, multiData, rhs, solution, maxIters, tolerance, niters, normr, normr0, &times[0], doPreconditioning);
+}
+
+/*!
+  Releases the matrix hierarchy, the vectors and the CG work space.  Safe to call more than once.
+*/
+void Solver::Teardown() {
+  if (!isSetup) return;
+  DeleteMatrix(A); // This delete will recursively delete all coarse grid data and the geometry
+  DeleteCGData(data);
+  if (numberOfMultiDataVectors>0) DeleteCGMultiData(multiData);
+  numberOfMultiDataVectors = 0;
+  DeleteVector(b);
+  DeleteVector(x);
+  DeleteVector(xexact);
+  numberOfMgLevels = 0;
+  isSetup = false;
+  isOptimized = false;
+  return;
+}
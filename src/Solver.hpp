@@ -0,0 +1,95 @@
+
+//@HEADER
+// ***************************************************
+//
+// HPCG: High Performance Conjugate Gradient Benchmark
+//
+// Contact:
+// Michael A. Heroux ( maherou@sandia.gov)
+// Jack Dongarra     (dongarra@eecs.utk.edu)
+// Piotr Luszczek    (luszczek@eecs.utk.edu)
+//
+// ***************************************************
+//@HEADER
+
+/*!
+ @file Solver.hpp
+
+ HPCG solver interface for applications linking against libhpcg
+ */
+
+#ifndef SOLVER_HPP
+#define SOLVER_HPP
+
+#include <vector>
+#include "hpcg.hpp"
+#include "Geometry.hpp"
+#include "SparseMatrix.hpp"
+#include "Vector.hpp"
+#include "CGData.hpp"
+#include "MultiVector.hpp"
+#include "CGMultiData.hpp"
+
+/*!
+  Owns one linear system together with its multigrid hierarchy and CG workspace, so that the
+  setup and optimization cost is paid once and amortized over many solves.
+
+  Typical use:
+
+    Solver solver;
+    solver.Setup(params);   // generated 27-point problem, or params.matrixFile
+    solver.Optimize();      // user-tunable OptimizeProblem
+    for (...) solver.Solve(rhs, solution, maxIters, tolerance, niters, normr, normr0);
+    solver.Solve(rhsBlock, solutionBlock, ...); // several right hand sides at once (see CGMulti)
+    solver.Teardown();      // also done by the destructor
+
+  MPI (if enabled) must be initialized by the caller.  HPCG_Init is optional: it fills the parameters
+  from the command line and opens the log file that HPCG_fout writes to.  The system is distributed over
+  params.comm, so that several solvers may run side by side on disjoint communicators.
+*/
+class Solver {
+public:
+  Solver();
+  ~Solver();
+
+  int Setup(const HPCG_Params & params);
+  int Setup(local_int_t nx, local_int_t ny, local_int_t nz);
+#ifndef HPCG_NO_MPI
+  int Setup(local_int_t nx, local_int_t ny, local_int_t nz, MPI_Comm comm);
+#endif
+  int Optimize();
+  int Solve(const Vector & rhs, Vector & solution, int maxIters, double tolerance, int & niters, double & normr, double & normr0,
+      bool doPreconditioning = true);
+  int Solve(const MultiVector & rhs, MultiVector & solution, int maxIters, double tolerance, int & niters, double * normr, double * normr0,
+      bool doPreconditioning = true);
+  void Teardown();
+
+  //! The system matrix; its local rows are the entries of the vectors passed to Solve
+  const SparseMatrix & GetMatrix() const { return A; }
+  //! The right hand side of the problem created by Setup
+  const Vector & GetRhs() const { return b; }
+  //! The exact solution of the problem created by Setup (see GenerateProblem and ReadProblem)
+  const Vector & GetExactSolution() const { return xexact; }
+  //! Number of multigrid levels, including the finest
+  int GetNumberOfMgLevels() const { return numberOfMgLevels; }
+  //! Accumulated time of the Solve calls, split as in CG (total, dot, WAXPBY, SpMV, allreduce, MG)
+  const std::vector< double > & GetTimes() const { return times; }
+
+private:
+  Solver(const Solver &); // Not copyable: owns the matrix hierarchy
+  Solver & operator=(const Solver &);
+
+  SparseMatrix A; //!< system matrix, owns the geometry and the coarse levels
+  CGData data; //!< CG work vectors
+  CGMultiData multiData; //!< block CG work vectors, allocated by the first block solve
+  int numberOfMultiDataVectors; //!< number of vectors of the blocks in multiData (0 if not allocated)
+  Vector b; //!< right hand side
+  Vector x; //!< work copy of the solution
+  Vector xexact; //!< exact solution
+  int numberOfMgLevels; //!< number of multigrid levels including the finest
+  bool isSetup; //!< true between Setup and Teardown
+  bool isOptimized; //!< true once OptimizeProblem has been called
+  std::vector< double > times; //!< timing information accumulated by CG
+};
+
+#endif // SOLVER_HPP
@@ -26,6 +26,9 @@
 #include "Geometry.hpp"
 #include "Vector.hpp"
 #include "MGData.hpp"
+#include "SharedHalo.hpp"
+#include "TriangularSplit.hpp"
+#include "CoarseCholesky.hpp"
 #if __cplusplus <= 201103L
 // for C++03
 #include <map>
@@ -33,7 +36,7 @@ typedef std::map< global_int_t, local_int_t > GlobalToLocalMap;
 #else
 // for C++11 or greater
 #include <unordered_map>
-using GlobalToLocalMap = std::unorderd_map< global_int_t, local_int_t >;
+using GlobalToLocalMap = std::unordered_map< global_int_t, local_int_t >;
 #endif
 
 struct SparseMatrix_STRUCT {
@@ -44,11 +47,21 @@ struct SparseMatrix_STRUCT {
   local_int_t localNumberOfRows; //!< number of rows local to this process
   local_int_t localNumberOfColumns;  //!< number of columns local to this process
   local_int_t localNumberOfNonzeros;  //!< number of nonzeros local to this process
+  int level; //!< multigrid level of this matrix, 0 is the finest level
+  int numberOfThreads; //!< OpenMP threads of the kernels on this level in ComputeMG (0 for all, set up by OptimizeProblem)
   char  * nonzerosInRow;  //!< The number of nonzeros in a row will always be 27 or fewer
   global_int_t ** mtxIndG; //!< matrix indices as global values
   local_int_t ** mtxIndL; //!< matrix indices as local values
   double ** matrixValues; //!< values of matrix entries
   double ** matrixDiagonal; //!< values of matrix diagonal entries
+  double * diagonalValues; //!< contiguous copy of the diagonal entries (0 until set up by OptimizeProblem)
+  double * inverseDiagonalValues; //!< reciprocals of the diagonal entries (0 unless set up by OptimizeProblem with HPCG_RECIPROCAL_DIAGONAL)
+#ifdef HPCG_SPLIT_TRIANGULAR
+  TriangularSplit * triangularSplit; //!< strictly lower and upper parts in CSR for ComputeSYMGS (0 until set up by OptimizeProblem)
+#endif
+#ifdef HPCG_REPLICATED_COARSE_SOLVE
+  CoarseCholesky * coarseCholesky; //!< replicated factor of the coarsest level for ComputeMG (0 unless set up by OptimizeProblem)
+#endif
   GlobalToLocalMap globalToLocalMap; //!< global-to-local mapping
   std::vector< global_int_t > localToGlobalMap; //!< local-to-global mapping
   mutable bool isDotProductOptimized;
@@ -72,6 +85,9 @@ struct SparseMatrix_STRUCT {
   local_int_t * receiveLength; //!< lenghts of messages received from neighboring processes
   local_int_t * sendLength; //!< lenghts of messages sent to neighboring processes
   double * sendBuffer; //!< send buffer for non-blocking sends
+#ifdef HPCG_SHARED_HALO
+  SharedHalo * sharedHalo; //!< intra-node halo exchange through shared memory (0 if not set up)
+#endif
 #endif
 };
 typedef struct SparseMatrix_STRUCT SparseMatrix;
@@ -89,11 +105,21 @@ inline void InitializeSparseMatrix(SparseMatrix & A, Geometry * geom) {
   A.localNumberOfRows = 0;
   A.localNumberOfColumns = 0;
   A.localNumberOfNonzeros = 0;
+  A.level = 0;
+  A.numberOfThreads = 0;
   A.nonzerosInRow = 0;
   A.mtxIndG = 0;
   A.mtxIndL = 0;
   A.matrixValues = 0;
   A.matrixDiagonal = 0;
+  A.diagonalValues = 0;
+  A.inverseDiagonalValues = 0;
+#ifdef HPCG_SPLIT_TRIANGULAR
+  A.triangularSplit = 0;
+#endif
+#ifdef HPCG_REPLICATED_COARSE_SOLVE
+  A.coarseCholesky = 0;
+#endif
 
   // Optimization is ON by default. The code that switches it OFF is in the
   // functions that are meant to be optimized.
@@ -111,6 +137,9 @@ inline void InitializeSparseMatrix(SparseMatrix & A, Geometry * geom) {
   A.receiveLength = 0;
   A.sendLength = 0;
   A.sendBuffer = 0;
+#ifdef HPCG_SHARED_HALO
+  A.sharedHalo = 0;
+#endif
 #endif
   A.mgData = 0; // Fine-to-coarse grid transfer initially not defined.
   A.Ac =0;
@@ -127,11 +156,15 @@ inline void CopyMatrixDiagonal(SparseMatrix & A, Vector & diagonal) {
     double ** curDiagA = A.matrixDiagonal;
     double * dv = diagonal.values;
     assert(A.localNumberOfRows==diagonal.localLength);
+    if (A.diagonalValues!=0) {
+      for (local_int_t i=0; i<A.localNumberOfRows; ++i) dv[i] = A.diagonalValues[i];
+      return;
+    }
     for (local_int_t i=0; i<A.localNumberOfRows; ++i) dv[i] = *(curDiagA[i]);
   return;
 }
 /*!
-  Replace specified matrix diagonal value.
+  Replace specified matrix diagonal value.  The contiguous diagonal and its reciprocals are updated too.
 
   @param[inout] A The system matrix.
   @param[in] diagonal  Vector of diagonal values that will replace existing matrix diagonal values.
@@ -141,6 +174,11 @@ inline void ReplaceMatrixDiagonal(SparseMatrix & A, Vector & diagonal) {
     double * dv = diagonal.values;
     assert(A.localNumberOfRows==diagonal.localLength);
     for (local_int_t i=0; i<A.localNumberOfRows; ++i) *(curDiagA[i]) = dv[i];
+    if (A.diagonalValues!=0)
+      for (local_int_t i=0; i<A.localNumberOfRows; ++i) {
+        A.diagonalValues[i] = dv[i];
+        if (A.inverseDiagonalValues!=0) A.inverseDiagonalValues[i] = 1.0/dv[i];
+      }
   return;
 }
 /*!
@@ -167,6 +205,14 @@ inline void DeleteMatrix(SparseMatrix & A) {
   if (A.mtxIndL) delete [] A.mtxIndL;
   if (A.matrixValues) delete [] A.matrixValues;
   if (A.matrixDiagonal)           delete [] A.matrixDiagonal;
+  if (A.diagonalValues)           delete [] A.diagonalValues;
+  if (A.inverseDiagonalValues)    delete [] A.inverseDiagonalValues;
+#ifdef HPCG_SPLIT_TRIANGULAR
+  if (A.triangularSplit) { DeleteTriangularSplit(*A.triangularSplit); delete A.triangularSplit; A.triangularSplit = 0; }
+#endif
+#ifdef HPCG_REPLICATED_COARSE_SOLVE
+  if (A.coarseCholesky) { DeleteCoarseCholesky(*A.coarseCholesky); delete A.coarseCholesky; A.coarseCholesky = 0; }
+#endif
 
 #ifndef HPCG_NO_MPI
   if (A.elementsToSend)       delete [] A.elementsToSend;
@@ -174,6 +220,9 @@ inline void DeleteMatrix(SparseMatrix & A) {
   if (A.receiveLength)            delete [] A.receiveLength;
   if (A.sendLength)            delete [] A.sendLength;
   if (A.sendBuffer)            delete [] A.sendBuffer;
+#ifdef HPCG_SHARED_HALO
+  if (A.sharedHalo) { DeleteSharedHalo(*A.sharedHalo); delete A.sharedHalo; A.sharedHalo = 0; }
+#endif
 #endif
 
   if (A.geom!=0) { DeleteGeometry(*A.geom); delete A.geom; A.geom = 0;}
@@ -0,0 +1,203 @@
+
+//@HEADER
+// ***************************************************
+//
+// HPCG: High Performance Conjugate Gradient Benchmark
+//
+// Contact:
+// Michael A. Heroux ( maherou@sandia.gov)
+// Jack Dongarra     (dongarra@eecs.utk.edu)
+// Piotr Luszczek    (luszczek@eecs.utk.edu)
+//
+// ***************************************************
+//@HEADER
+
+
+/*!
+ @file StreamBenchmark.cpp
+
+ HPCG routine
+ */
+
+#ifndef HPCG_NO_MPI
+#include <mpi.h>
+#endif
+
+#ifndef HPCG_NO_OPENMP
+#include <omp.h>
+#endif
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include <cstdio>
+#include <vector>
+#include "StreamBenchmark.hpp"
+#include "mytimer.hpp"
+
+static const local_int_t streamArrayLength = 1 << 22; //!< 32 MB per array, well beyond the last level cache of one core
+static const int streamNumberOfTrials = 5; //!< The best of this many trials is kept, as in STREAM
+
+/*!
+  Reads the CPUs of every NUMA node from sysfs.
+
+  @return one list of CPU numbers per node; empty if the topology is not available
+*/
+static std::vector< std::vector<int> > GetNumaNodeCpus(void) {
+  std::vector< std::vector<int> > nodes;
+#ifdef __linux__
+  for (int node=0; ; ++node) {
+    char fileName[128];
+    sprintf(fileName, "/sys/devices/system/node/node%d/cpulist", node);
+    FILE * file = fopen(fileName, "r");
+    if (!file) break;
+    std::vector<int> cpus;
+    int first, last;
+    while (fscanf(file, "%d", &first)==1) { // Format is a comma separated list of ranges: 0-3,8-11
+      last = first;
+      int c = fgetc(file);
+      if (c=='-') {
+        if (fscanf(file, "%d", &last)!=1) break;
+        c = fgetc(file);
+      }
+      for (int cpu=first; cpu<=last; ++cpu) cpus.push_back(cpu);
+      if (c!=',') break;
+    }
+    fclose(file);
+    nodes.push_back(cpus);
+  }
+#endif
+  return nodes;
+}
+
+/*!
+  Measures Copy (c = a) and Triad (a = b + s*c) bandwidth of this process, concurrently with all other processes.
+
+  @param[in]  geom       the geometry of the processes that measure together
+  @param[in]  n          the length of the arrays
+  @param[in]  numThreads the number of OpenMP threads to use
+  @param[in]  cpus       if not empty, the threads are bound to these CPUs during the measurement (and the first touch of the arrays)
+  @param[out] copy       Copy bandwidth (GB/s) summed over processes
+  @param[out] triad      Triad bandwidth (GB/s) summed over processes
+*/
+static void MeasureStream(const Geometry & geom, local_int_t n, int numThreads, const std::vector<int> & cpus, double & copy, double & triad) {
+  double * a = new double[n];
+  double * b = new double[n];
+  double * c = new double[n];
+  const double scalar = 3.0;
+#ifdef HPCG_NO_MPI
+  (void) geom;
+#endif
+
+#if defined(__linux__) && !defined(HPCG_NO_OPENMP)
+  std::vector<cpu_set_t> savedMasks(numThreads);
+  if (!cpus.empty()) {
+#pragma omp parallel num_threads(numThreads)
+    {
+      cpu_set_t mask;
+      CPU_ZERO(&mask);
+      for (size_t i=0; i<cpus.size(); ++i) CPU_SET(cpus[i], &mask);
+      sched_getaffinity(0, sizeof(cpu_set_t), &savedMasks[omp_get_thread_num()]);
+      sched_setaffinity(0, sizeof(cpu_set_t), &mask);
+    }
+  }
+#else
+  (void) cpus;
+  (void) numThreads;
+#endif
+
+  // First touch with the same threads and schedule as the measurement places pages on the right node
+#ifndef HPCG_NO_OPENMP
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+#endif
+  for (local_int_t i=0; i<n; ++i) {
+    a[i] = 1.0;
+    b[i] = 2.0;
+    c[i] = 0.0;
+  }
+
+  double bestCopy = 0.0, bestTriad = 0.0;
+  for (int k=0; k<streamNumberOfTrials; ++k) {
+#ifndef HPCG_NO_MPI
+    MPI_Barrier(geom.comm);
+#endif
+    double t0 = mytimer();
+#ifndef HPCG_NO_OPENMP
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+#endif
+    for (local_int_t i=0; i<n; ++i) c[i] = a[i];
+    double tCopy = mytimer() - t0;
+#ifndef HPCG_NO_MPI
+    MPI_Barrier(geom.comm);
+#endif
+    t0 = mytimer();
+#ifndef HPCG_NO_OPENMP
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+#endif
+    for (local_int_t i=0; i<n; ++i) a[i] = b[i] + scalar*c[i];
+    double tTriad = mytimer() - t0;
+    if (k==0 || tCopy<bestCopy) bestCopy = tCopy;
+    if (k==0 || tTriad<bestTriad) bestTriad = tTriad;
+  }
+
+#if defined(__linux__) && !defined(HPCG_NO_OPENMP)
+  if (!cpus.empty()) {
+#pragma omp parallel num_threads(numThreads)
+    sched_setaffinity(0, sizeof(cpu_set_t), &savedMasks[omp_get_thread_num()]);
+  }
+#endif
+
+  double bandwidth[2];
+  bandwidth[0] = 2.0*sizeof(double)*n/bestCopy/1.0E9; // Read a, write c
+  bandwidth[1] = 3.0*sizeof(double)*n/bestTriad/1.0E9; // Read b and c, write a
+#ifndef HPCG_NO_MPI
+  MPI_Allreduce(MPI_IN_PLACE, bandwidth, 2, MPI_DOUBLE, MPI_SUM, geom.comm);
+#endif
+  copy = bandwidth[0];
+  triad = bandwidth[1];
+
+  delete [] a;
+  delete [] b;
+  delete [] c;
+  return;
+}
+
+/*!
+  Runs a STREAM-style bandwidth probe on all processes at the same time, so that the
+  results are the bandwidth available to the whole job.
+
+  The probe sweeps the thread count (powers of two up to geom.numThreads) and, when
+  the NUMA topology is known, binds all threads of each process to one node at a time.
+
+  @param[in]  geom        The description of the problem's geometry.
+  @param[out] stream_data The measured bandwidths
+*/
+void RunStreamBenchmark(const Geometry & geom, StreamData & stream_data) {
+  local_int_t n = streamArrayLength;
+  std::vector<int> noCpus;
+  stream_data.arrayLength = n;
+
+  stream_data.threadCounts.clear();
+  for (int numThreads=1; numThreads<geom.numThreads; numThreads *= 2) stream_data.threadCounts.push_back(numThreads);
+  stream_data.threadCounts.push_back(geom.numThreads);
+  int numberOfCounts = stream_data.threadCounts.size();
+  stream_data.copyPerThreadCount.resize(numberOfCounts);
+  stream_data.triadPerThreadCount.resize(numberOfCounts);
+  for (int i=0; i<numberOfCounts; ++i)
+    MeasureStream(geom, n, stream_data.threadCounts[i], noCpus, stream_data.copyPerThreadCount[i], stream_data.triadPerThreadCount[i]);
+  stream_data.copy = stream_data.copyPerThreadCount[numberOfCounts-1];
+  stream_data.triad = stream_data.triadPerThreadCount[numberOfCounts-1];
+
+  // All processes must agree on the number of nodes, because every measurement is collective
+  std::vector< std::vector<int> > nodes = GetNumaNodeCpus();
+  int numberOfNodes = nodes.size();
+#ifndef HPCG_NO_MPI
+  MPI_Allreduce(MPI_IN_PLACE, &numberOfNodes, 1, MPI_INT, MPI_MIN, geom.comm);
+#endif
+  stream_data.copyPerNumaNode.resize(numberOfNodes);
+  stream_data.triadPerNumaNode.resize(numberOfNodes);
+  for (int node=0; node<numberOfNodes; ++node)
+    MeasureStream(geom, n, geom.numThreads, nodes[node], stream_data.copyPerNumaNode[node], stream_data.triadPerNumaNode[node]);
+  return;
+}
@@ -0,0 +1,42 @@
+
+//@HEADER
+// ***************************************************
+//
+// HPCG: High Performance Conjugate Gradient Benchmark
+//
+// Contact:
+// Michael A. Heroux ( maherou@sandia.gov)
+// Jack Dongarra     (dongarra@eecs.utk.edu)
+// Piotr Luszczek    (luszczek@eecs.utk.edu)
+//
+// ***************************************************
+//@HEADER
+
+
+/*!
+ @file StreamBenchmark.hpp
+
+ HPCG data structure and routine for the STREAM memory bandwidth probe
+ */
+
+#ifndef STREAMBENCHMARK_HPP
+#define STREAMBENCHMARK_HPP
+
+#include <vector>
+#include "Geometry.hpp"
+
+struct StreamData_STRUCT {
+  local_int_t arrayLength; //!< number of doubles in each of the three arrays of every process
+  double copy;  //!< Copy bandwidth (GB/s) with all threads, summed over processes
+  double triad; //!< Triad bandwidth (GB/s) with all threads, summed over processes
+  std::vector<int> threadCounts; //!< thread counts of the thread sweep
+  std::vector<double> copyPerThreadCount;  //!< Copy bandwidth (GB/s) for each entry of threadCounts
+  std::vector<double> triadPerThreadCount; //!< Triad bandwidth (GB/s) for each entry of threadCounts
+  std::vector<double> copyPerNumaNode;  //!< Copy bandwidth (GB/s) with threads and memory bound to each NUMA node (empty if unknown)
+  std::vector<double> triadPerNumaNode; //!< Triad bandwidth (GB/s) with threads and memory bound to each NUMA node (empty if unknown)
+};
+typedef struct StreamData_STRUCT StreamData;
+
+extern void RunStreamBenchmark(const Geometry & geom, StreamData & stream_data);
+
+#endif // STREAMBENCHMARK_HPP
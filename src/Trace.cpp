@@ -0,0 +1,205 @@
+
+//@HEADER
+// ***************************************************
+//
+// HPCG: High Performance Conjugate Gradient Benchmark
+//
+// Contact:
+// Michael A. Heroux ( maherou@sandia.gov)
+// Jack Dongarra     (dongarra@eecs.utk.edu)
+// Piotr Luszczek    (luszczek@eecs.utk.edu)
+//
+// ***************************************************
+//@HEADER
+
+
+/*!
+ @file Trace.cpp
+
+ HPCG routines for recording a timeline of kernel calls in Chrome trace-event format
+ */
+
+#ifndef HPCG_NO_MPI
+#include <mpi.h>
+#endif
+
+#ifndef HPCG_NO_OPENMP
+#include <omp.h>
+#endif
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "Trace.hpp"
+
+bool traceIsEnabled = false;
+
+struct TraceEvent {
+  const char * name;
+  double begin;
+  double end;
+};
+
+// Each thread only writes to its own ring buffer, so recording needs no locks.
+// When a buffer is full the oldest events are overwritten.
+struct TraceBuffer {
+  std::vector<TraceEvent> events; //!< ring of fixed capacity
+  long long count; //!< number of events recorded so far, the next one goes to events[count%capacity]
+  char padding[64]; //!< keeps the counters of different threads on different cache lines
+};
+
+static std::vector<TraceBuffer> traceBuffers;
+static double traceStart = 0.0; // Local time at which tracing started
+
+/*!
+  Allocates one ring buffer per OpenMP thread and turns tracing on.
+
+  @param[in] eventsPerThread the capacity of each ring buffer; 0 leaves tracing off
+*/
+void InitializeTrace(int eventsPerThread) {
+  int numThreads = 1;
+#ifndef HPCG_NO_OPENMP
+  numThreads = omp_get_max_threads();
+#endif
+  traceBuffers.resize(numThreads);
+  for (int t=0; t<numThreads; ++t) {
+    traceBuffers[t].events.resize(eventsPerThread);
+    traceBuffers[t].count = 0;
+  }
+  traceStart = mytimer();
+  traceIsEnabled = (eventsPerThread>0);
+  return;
+}
+
+/*!
+  Stores one complete event in the ring buffer of the calling thread.
+
+  @param[in] name  the name shown in the timeline
+  @param[in] begin the start time (mytimer) of the event
+  @param[in] end   the end time (mytimer) of the event
+*/
+void RecordTraceEvent(const char * name, double begin, double end) {
+  int thread = 0;
+#ifndef HPCG_NO_OPENMP
+  thread = omp_get_thread_num();
+#endif
+  if (thread>=(int) traceBuffers.size()) return; // Thread that did not exist at initialization
+  TraceBuffer & buffer = traceBuffers[thread];
+  TraceEvent & event = buffer.events[buffer.count % buffer.events.size()];
+  event.name = name;
+  event.begin = begin;
+  event.end = end;
+  ++buffer.count;
+  return;
+}
+
+/*!
+  Estimates the difference between the clock of rank 0 and the clock of this process.
+
+  Rank 0 exchanges time stamps with every other rank in turn and keeps the sample with
+  the shortest round trip, assuming that the message latency is symmetric.
+
+  @return the value to add to local times to express them on the clock of rank 0
+*/
+static double EstimateClockOffset(void) {
+  double offset = 0.0;
+#ifndef HPCG_NO_MPI
+  const int numberOfRounds = 16;
+  int size, rank;
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  for (int p=1; p<size; ++p) {
+    if (rank==0) {
+      double bestRoundTrip = -1.0, bestOffset = 0.0;
+      for (int i=0; i<numberOfRounds; ++i) {
+        double t0 = mytimer(), tp = 0.0;
+        MPI_Send(&t0, 1, MPI_DOUBLE, p, 98, MPI_COMM_WORLD);
+        MPI_Recv(&tp, 1, MPI_DOUBLE, p, 98, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        double t1 = mytimer();
+        if (bestRoundTrip<0.0 || t1-t0<bestRoundTrip) {
+          bestRoundTrip = t1-t0;
+          bestOffset = 0.5*(t0+t1) - tp;
+        }
+      }
+      MPI_Send(&bestOffset, 1, MPI_DOUBLE, p, 98, MPI_COMM_WORLD);
+    } else if (rank==p) {
+      for (int i=0; i<numberOfRounds; ++i) {
+        double t0 = 0.0;
+        MPI_Recv(&t0, 1, MPI_DOUBLE, 0, 98, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        double tp = mytimer();
+        MPI_Send(&tp, 1, MPI_DOUBLE, 0, 98, MPI_COMM_WORLD);
+      }
+      MPI_Recv(&offset, 1, MPI_DOUBLE, 0, 98, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    }
+  }
+#endif
+  return offset;
+}
+
+/*!
+  Writes the recorded events of all processes to one Chrome trace-event JSON file
+  (viewable with chrome://tracing or ui.perfetto.dev) and turns tracing off.
+
+  Every MPI rank appears as a process and every OpenMP thread as a thread of that
+  process; time stamps are shifted to the clock of rank 0. Must be called by all processes of
+  MPI_COMM_WORLD, even when HPCG runs on a derived communicator, so that the timeline covers the whole job.
+
+  @param[in] fileName the name of the file shared by all processes
+
+  @return returns 0 upon success and non-zero otherwise
+*/
+int WriteTrace(const char * fileName) {
+  traceIsEnabled = false;
+  int size = 1, rank = 0;
+#ifndef HPCG_NO_MPI
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+#endif
+  double offset = EstimateClockOffset();
+  double start = traceStart + offset; // Time zero of the timeline on the clock of rank 0
+#ifndef HPCG_NO_MPI
+  MPI_Bcast(&start, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+#endif
+
+  std::string text;
+  char line[256];
+  if (rank==0) text += "{\"traceEvents\":[\n";
+  else text += ",\n";
+  snprintf(line, sizeof line, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"Rank %d\"}}", rank, rank);
+  text += line;
+  for (size_t t=0; t<traceBuffers.size(); ++t) {
+    const TraceBuffer & buffer = traceBuffers[t];
+    if (buffer.count==0) continue;
+    snprintf(line, sizeof line, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"Thread %d\"}}", rank, (int) t, (int) t);
+    text += line;
+    long long capacity = buffer.events.size();
+    long long first = (buffer.count>capacity) ? buffer.count-capacity : 0; // Oldest event still in the ring
+    for (long long i=first; i<buffer.count; ++i) {
+      const TraceEvent & event = buffer.events[i%capacity];
+      snprintf(line, sizeof line, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+          event.name, rank, (int) t, (event.begin+offset-start)*1.0E6, (event.end-event.begin)*1.0E6);
+      text += line;
+    }
+  }
+  if (rank==size-1) text += "\n]}\n";
+
+  int ierr = 0;
+#ifndef HPCG_NO_MPI
+  long long length = text.size(), fileOffset = 0;
+  MPI_Exscan(&length, &fileOffset, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+  if (rank==0) fileOffset = 0; // MPI_Exscan leaves the result on rank 0 undefined
+  MPI_File file;
+  if (MPI_File_open(MPI_COMM_WORLD, (char *) fileName, MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS)
+    return -1;
+  MPI_File_set_size(file, 0);
+  if (MPI_File_write_at_all(file, fileOffset, (void *) text.data(), (int) length, MPI_CHAR, MPI_STATUS_IGNORE) != MPI_SUCCESS) ierr = -1;
+  MPI_File_close(&file);
+#else
+  FILE * file = fopen(fileName, "w");
+  if (!file) return -1;
+  if (fwrite(text.data(), 1, text.size(), file)!=text.size()) ierr = -1;
+  fclose(file);
+#endif
+  traceBuffers.clear();
+  return ierr;
+}
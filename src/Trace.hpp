@@ -0,0 +1,50 @@
+
+//@HEADER
+// ***************************************************
+//
+// HPCG: High Performance Conjugate Gradient Benchmark
+//
+// Contact:
+// Michael A. Heroux ( maherou@sandia.gov)
+// Jack Dongarra     (dongarra@eecs.utk.edu)
+// Piotr Luszczek    (luszczek@eecs.utk.edu)
+//
+// ***************************************************
+//@HEADER
+
+
+/*!
+ @file Trace.hpp
+
+ HPCG routines for recording a timeline of kernel calls in Chrome trace-event format
+ */
+
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include "mytimer.hpp"
+
+extern bool traceIsEnabled; //!< true between InitializeTrace and WriteTrace
+
+void InitializeTrace(int eventsPerThread);
+void RecordTraceEvent(const char * name, double begin, double end);
+int WriteTrace(const char * fileName);
+
+/*!
+  Returns the start time of a traced region, or zero when tracing is off.
+*/
+inline double TraceBegin(void) {
+  return traceIsEnabled ? mytimer() : 0.0;
+}
+
+/*!
+  Records a traced region that started at begin; does nothing when tracing is off.
+
+  @param[in] name  the name shown in the timeline (must be a string literal or otherwise outlive the trace)
+  @param[in] begin the value returned by TraceBegin at the start of the region
+*/
+inline void TraceEnd(const char * name, double begin) {
+  if (traceIsEnabled) RecordTraceEvent(name, begin, mytimer());
+}
+
+#endif // TRACE_HPP
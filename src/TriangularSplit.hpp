@@ -0,0 +1,63 @@
+
+//@HEADER
+// ***************************************************
+//
+// HPCG: High Performance Conjugate Gradient Benchmark
+//
+// Contact:
+// Michael A. Heroux ( maherou@sandia.gov)
+// Jack Dongarra     (dongarra@eecs.utk.edu)
+// Piotr Luszczek    (luszczek@eecs.utk.edu)
+//
+// ***************************************************
+//@HEADER
+
+
+/*!
+ @file TriangularSplit.hpp
+
+ HPCG data structure for the matrix split into strictly lower and strictly upper triangular parts
+ */
+
+#ifndef TRIANGULARSPLIT_HPP
+#define TRIANGULARSPLIT_HPP
+
+#ifdef HPCG_SPLIT_TRIANGULAR
+#include "Geometry.hpp"
+
+/*!
+  The off-diagonal entries of a matrix in two compressed sparse row arrays: the strictly lower part (local
+  columns before the row) and the strictly upper part (local columns after the row, followed by all external columns).
+  The diagonal is kept in SparseMatrix::diagonalValues (and its reciprocals in SparseMatrix::inverseDiagonalValues).
+*/
+struct TriangularSplit_STRUCT {
+  local_int_t * lowerRowStart; //!< start of each row in lowerColumns and lowerValues (localNumberOfRows+1 entries)
+  local_int_t * lowerColumns; //!< local column indices of the strictly lower part
+  double * lowerValues; //!< values of the strictly lower part
+  local_int_t * upperRowStart; //!< start of each row in upperColumns and upperValues (localNumberOfRows+1 entries)
+  local_int_t * upperExternalStart; //!< start of the external columns within each row of the upper part (localNumberOfRows entries)
+  local_int_t * upperColumns; //!< local column indices of the strictly upper part
+  double * upperValues; //!< values of the strictly upper part
+  double * work; //!< right hand side of the triangular solves (localNumberOfRows entries)
+};
+typedef struct TriangularSplit_STRUCT TriangularSplit;
+
+/*!
+  Deallocates the arrays of the triangular split.
+
+  @param[inout] split the data structure whose storage is deallocated
+ */
+inline void DeleteTriangularSplit(TriangularSplit & split) {
+  delete [] split.lowerRowStart;
+  delete [] split.lowerColumns;
+  delete [] split.lowerValues;
+  delete [] split.upperRowStart;
+  delete [] split.upperExternalStart;
+  delete [] split.upperColumns;
+  delete [] split.upperValues;
+  delete [] split.work;
+  return;
+}
+#endif // HPCG_SPLIT_TRIANGULAR
+
+#endif // TRIANGULARSPLIT_HPP
@@ -23,6 +23,20 @@
 #include <cassert>
 #include <cstdlib>
 #include "Geometry.hpp"
+#include "PersistentRegion.hpp"
+
+/*
+  The vector utilities split their loops with the static schedule of the kernels, so that the first touch
+  of a vector places its pages on the NUMA node of the threads that use them.  With HPCG_NONTEMPORAL_STORES,
+  the loops that only write their output ask for non-temporal stores (OpenMP 5.0 nontemporal clause; compilers
+  that do not implement it ignore the request).  Inside the persistent region of CG (HPCG_PERSISTENT_REGION),
+  ZeroVector and CopyVector share the loop among the threads of the region instead.
+*/
+#ifdef HPCG_NONTEMPORAL_STORES
+#define HPCG_NONTEMPORAL(array) nontemporal(array)
+#else
+#define HPCG_NONTEMPORAL(array)
+#endif
 
 struct Vector_STRUCT {
   local_int_t localLength;  //!< length of local portion of the vector
@@ -37,27 +51,38 @@ struct Vector_STRUCT {
 typedef struct Vector_STRUCT Vector;
 
 /*!
-  Initializes input vector.
+  Fill the input vector with zero values.
 
-  @param[in] v
-  @param[in] localLength Length of local portion of input vector
+  @param[inout] v - On entrance v is initialized, on exit all its values are zero.
  */
-inline void InitializeVector(Vector & v, local_int_t localLength) {
-  v.localLength = localLength;
-  v.values = new double[localLength];
-  v.optimizationData = 0;
+inline void ZeroVector(Vector & v) {
+  local_int_t localLength = v.localLength;
+  double * vv = v.values;
+#ifdef HPCG_PERSISTENT_REGION
+  if (InPersistentRegion()) {
+    #pragma omp for simd schedule(static) HPCG_NONTEMPORAL(vv)
+    for (local_int_t i=0; i<localLength; ++i) vv[i] = 0.0;
+    return;
+  }
+#endif
+#ifndef HPCG_NO_OPENMP
+  #pragma omp parallel for simd schedule(static) HPCG_NONTEMPORAL(vv)
+#endif
+  for (local_int_t i=0; i<localLength; ++i) vv[i] = 0.0;
   return;
 }
 
 /*!
-  Fill the input vector with zero values.
+  Initializes input vector.  The values are set to zero by the threads that will work on them.
 
-  @param[inout] v - On entrance v is initialized, on exit all its values are zero.
+  @param[in] v
+  @param[in] localLength Length of local portion of input vector
  */
-inline void ZeroVector(Vector & v) {
-  local_int_t localLength = v.localLength;
-  double * vv = v.values;
-  for (int i=0; i<localLength; ++i) vv[i] = 0.0;
+inline void InitializeVector(Vector & v, local_int_t localLength) {
+  v.values = new double[localLength];
+  v.localLength = localLength; // Stored after the allocation, so that the length of the first touch stays known
+  v.optimizationData = 0;
+  if (localLength>0) ZeroVector(v); // First touch, nothing to touch for the empty vectors of idle processes
   return;
 }
 /*!
@@ -74,14 +99,41 @@ inline void ScaleVectorValue(Vector & v, local_int_t index, double value) {
   return;
 }
 /*!
-  Fill the input vector with pseudo-random values.
+  Counter-based pseudo-random number generator: returns the value number counter of the sequence, uniformly
+  distributed in [1,2).  The value is a function of the counter only (the SplitMix64 finalizer of its
+  Weyl sequence), so any part of the sequence can be generated independently and in parallel.
+
+  @param[in] counter the position in the sequence
+
+  @return the pseudo-random value
+ */
+inline double RandomValue(unsigned long long counter) {
+  unsigned long long z = (counter + 1) * 0x9E3779B97F4A7C15ULL;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  z ^= z >> 31;
+  return 1.0 + (z >> 11) * (1.0/9007199254740992.0); // 53 random bits
+}
+
+/*!
+  Fill the input vector with pseudo-random values in [1,2).  Successive calls continue the sequence of
+  RandomValue, and the values do not depend on the number of threads.
 
   @param[in] v
  */
 inline void FillRandomVector(Vector & v) {
+  static unsigned long long sequenceCounter = 0; // Values used by earlier calls
   local_int_t localLength = v.localLength;
   double * vv = v.values;
-  for (int i=0; i<localLength; ++i) vv[i] = rand() / (double)(RAND_MAX) + 1.0;
+  unsigned long long first;
+#ifndef HPCG_NO_OPENMP
+  #pragma omp atomic capture
+#endif
+  { first = sequenceCounter; sequenceCounter += localLength; }
+#ifndef HPCG_NO_OPENMP
+  #pragma omp parallel for simd schedule(static) HPCG_NONTEMPORAL(vv)
+#endif
+  for (local_int_t i=0; i<localLength; ++i) vv[i] = RandomValue(first + i);
   return;
 }
 /*!
@@ -95,7 +147,17 @@ inline void CopyVector(const Vector & v, Vector & w) {
   assert(w.localLength >= localLength);
   double * vv = v.values;
   double * wv = w.values;
-  for (int i=0; i<localLength; ++i) wv[i] = vv[i];
+#ifdef HPCG_PERSISTENT_REGION
+  if (InPersistentRegion()) {
+    #pragma omp for simd schedule(static) HPCG_NONTEMPORAL(wv)
+    for (local_int_t i=0; i<localLength; ++i) wv[i] = vv[i];
+    return;
+  }
+#endif
+#ifndef HPCG_NO_OPENMP
+  #pragma omp parallel for simd schedule(static) HPCG_NONTEMPORAL(wv)
+#endif
+  for (local_int_t i=0; i<localLength; ++i) wv[i] = vv[i];
   return;
 }
 
@@ -18,75 +18,339 @@
  HPCG routine
  */
 
+#ifndef HPCG_NO_MPI
+#include <mpi.h>
+#include "ExchangeHalo.hpp"
+#endif
+
 #include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
 #include "WriteProblem.hpp"
 
+#ifndef HPCG_NO_MPI
+/*!
+  An output file shared by the processes of a communicator.
+*/
+struct ProblemFile {
+  MPI_File handle; //!< the MPI-IO file handle
+  MPI_Comm comm; //!< the communicator the file was opened on
+};
+#else
+typedef FILE * ProblemFile;
+#endif
+
+static const local_int_t rowsPerChunk = 16384; //!< Number of matrix rows formatted and written per collective call
+static const long long maxBytesPerWrite = 1 << 30; //!< Largest byte count handed to a single write call
+
+/*!
+  Opens (and truncates) an output file shared by all processes.
+
+  @param[in]  geom     The geometry of the processes sharing the file
+  @param[in]  fileName Name of the file to create
+  @param[out] file     The file handle
+
+  @return Returns zero on success and -1 otherwise
+*/
+static int OpenProblemFile(const Geometry & geom, const char * fileName, ProblemFile & file) {
+#ifndef HPCG_NO_MPI
+  file.comm = geom.comm;
+  if (MPI_File_open(file.comm, (char *) fileName, MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &file.handle) != MPI_SUCCESS)
+    return -1;
+  MPI_File_set_size(file.handle, 0); // Discard the contents of an older, possibly longer, file
+#else
+  (void) geom;
+  file = fopen(fileName, "wb");
+  if (!file) return -1;
+#endif
+  return 0;
+}
+
+static void CloseProblemFile(ProblemFile & file) {
+#ifndef HPCG_NO_MPI
+  MPI_File_close(&file.handle);
+#else
+  fclose(file);
+#endif
+  return;
+}
+
+/*!
+  Collectively writes a block of bytes at a given file offset.  Every process must call this function
+  the same number of times; processes with nothing to write pass a zero length.
+
+  @param[in] file   The file handle returned by OpenProblemFile
+  @param[in] offset Byte offset in the file where the block starts
+  @param[in] buffer The data to write
+  @param[in] length Number of bytes to write
+*/
+static void WriteProblemFileAt(ProblemFile & file, long long offset, const void * buffer, long long length) {
+  const char * bytes = (const char *) buffer;
+#ifndef HPCG_NO_MPI
+  // MPI counts are int, so split large blocks and make sure all processes issue the same number of calls
+  long long numberOfWrites = (length + maxBytesPerWrite - 1)/maxBytesPerWrite, maxNumberOfWrites = 0;
+  MPI_Allreduce(&numberOfWrites, &maxNumberOfWrites, 1, MPI_LONG_LONG_INT, MPI_MAX, file.comm);
+  for (long long i=0; i<maxNumberOfWrites; ++i) {
+    long long start = i*maxBytesPerWrite;
+    long long count = (start < length) ? length - start : 0;
+    if (count > maxBytesPerWrite) count = maxBytesPerWrite;
+    MPI_File_write_at_all(file.handle, (MPI_Offset) (offset + start), (void *) (count ? bytes + start : bytes), (int) count, MPI_BYTE, MPI_STATUS_IGNORE);
+  }
+#else
+  if (length > 0) {
+    fseek(file, (long) offset, SEEK_SET);
+    fwrite(bytes, 1, (size_t) length, file);
+  }
+#endif
+  return;
+}
 
 /*!
-  Routine to dump:
-   - matrix in row, col, val format for analysis with MATLAB
-   - x, xexact, b as simple arrays of numbers.
+  Computes the exclusive prefix sum and the total of a value over the processes of geom.
+*/
+static void ScanOverProcesses(const Geometry & geom, long long value, long long & offset, long long & total) {
+#ifndef HPCG_NO_MPI
+  offset = 0;
+  MPI_Exscan(&value, &offset, 1, MPI_LONG_LONG_INT, MPI_SUM, geom.comm);
+  if (geom.rank==0) offset = 0; // MPI_Exscan leaves the result undefined on the first process
+  MPI_Allreduce(&value, &total, 1, MPI_LONG_LONG_INT, MPI_SUM, geom.comm);
+#else
+  (void) geom;
+  offset = 0;
+  total = value;
+#endif
+  return;
+}
 
-   Writes to A.dat, x.dat, xexact.dat and b.dat, respectivly.
+/*!
+  Computes the number of every local column in the exported numbering, where the rows of
+  process 0 come first, followed by the rows of process 1, and so on.
 
-   NOTE:  THIS CODE ONLY WORKS ON SINGLE PROCESSOR RUNS
+  @param[in]  A         The known system matrix
+  @param[in]  rowOffset The exported number of the first local row
+  @param[out] columnIds On exit, the exported number of each local and external column
+*/
+static void ComputeExportedColumnIds(const SparseMatrix & A, long long rowOffset, std::vector<long long> & columnIds) {
+  local_int_t ncol = A.localNumberOfColumns;
+  columnIds.resize(ncol);
+#ifndef HPCG_NO_MPI
+  local_int_t nrow = A.localNumberOfRows;
+  // Let the halo exchange deliver the new numbers of the external columns; doubles hold integers up to 2^53 exactly
+  Vector ids;
+  InitializeVector(ids, ncol);
+  for (local_int_t i=0; i<nrow; ++i) ids.values[i] = (double) (rowOffset + i);
+  ExchangeHalo(A, ids);
+  for (local_int_t i=0; i<ncol; ++i) columnIds[i] = (long long) ids.values[i];
+  DeleteVector(ids);
+#else
+  for (local_int_t i=0; i<ncol; ++i) columnIds[i] = rowOffset + i;
+#endif
+  return;
+}
 
-   Read into MATLAB using:
+/*!
+  Writes the matrix as a symmetric Matrix Market coordinate file, storing only the lower triangle.
+  Rows are formatted in chunks; the chunks of all processes in one round are written with one collective call.
+*/
+static int WriteMatrixMarketMatrix(const char * fileName, const SparseMatrix & A, long long rowOffset, long long totalNumberOfRows,
+    const std::vector<long long> & columnIds, bool writeHeader) {
 
-       load A.dat
-       A=spconvert(A);
-       load x.dat
-       load xexact.dat
-       load b.dat
+  local_int_t nrow = A.localNumberOfRows;
+
+  long long localLowerNonzeros = 0, lowerNonzerosOffset = 0, totalLowerNonzeros = 0;
+  for (local_int_t i=0; i<nrow; ++i)
+    for (int j=0; j<A.nonzerosInRow[i]; ++j)
+      if (columnIds[A.mtxIndL[i][j]] <= rowOffset + i) ++localLowerNonzeros;
+  ScanOverProcesses(*A.geom, localLowerNonzeros, lowerNonzerosOffset, totalLowerNonzeros);
+
+  ProblemFile file;
+  if (OpenProblemFile(*A.geom, fileName, file)) return -1;
+
+  char line[128]; // 47 header characters, three 20-digit sizes, two blanks, a newline and the terminator
+  snprintf(line, sizeof line, "%%%%MatrixMarket matrix coordinate real symmetric\n%lld %lld %lld\n", totalNumberOfRows, totalNumberOfRows, totalLowerNonzeros);
+  std::string header(line);
+  WriteProblemFileAt(file, 0, header.data(), writeHeader ? (long long) header.size() : 0);
+
+  long long numberOfChunks = (nrow + rowsPerChunk - 1)/rowsPerChunk, maxNumberOfChunks = numberOfChunks;
+#ifndef HPCG_NO_MPI
+  MPI_Allreduce(&numberOfChunks, &maxNumberOfChunks, 1, MPI_LONG_LONG_INT, MPI_MAX, A.geom->comm);
+#endif
+
+  // Entries may appear in any order in a coordinate file, so each round simply appends the chunks of all processes
+  long long roundOffset = header.size();
+  std::string chunk;
+  for (long long k=0; k<maxNumberOfChunks; ++k) {
+    chunk.clear();
+    local_int_t firstRow = k*rowsPerChunk;
+    local_int_t lastRow = firstRow + rowsPerChunk < nrow ? firstRow + rowsPerChunk : nrow;
+    for (local_int_t i=firstRow; i<lastRow; ++i) {
+      long long globalRow = rowOffset + i;
+      for (int j=0; j<A.nonzerosInRow[i]; ++j) {
+        long long globalColumn = columnIds[A.mtxIndL[i][j]];
+        if (globalColumn > globalRow) continue;
+        int n = snprintf(line, sizeof line, "%lld %lld %22.16e\n", globalRow+1, globalColumn+1, A.matrixValues[i][j]);
+        chunk.append(line, n);
+      }
+    }
+    long long chunkOffset = 0, roundLength = 0;
+    ScanOverProcesses(*A.geom, chunk.size(), chunkOffset, roundLength);
+    WriteProblemFileAt(file, roundOffset + chunkOffset, chunk.data(), chunk.size());
+    roundOffset += roundLength;
+  }
+
+  CloseProblemFile(file);
+  return 0;
+}
+
+/*!
+  Writes the matrix in the binary CSR format described in WriteProblem.
+*/
+static int WriteBinaryMatrix(const char * fileName, const SparseMatrix & A, long long rowOffset, long long totalNumberOfRows,
+    const std::vector<long long> & columnIds, bool writeHeader) {
+
+  local_int_t nrow = A.localNumberOfRows;
+
+  long long nonzerosOffset = 0, totalNumberOfNonzeros = 0;
+  ScanOverProcesses(*A.geom, A.localNumberOfNonzeros, nonzerosOffset, totalNumberOfNonzeros);
+
+  ProblemFile file;
+  if (OpenProblemFile(*A.geom, fileName, file)) return -1;
+
+  char header[32];
+  long long dimensions[3] = {totalNumberOfRows, totalNumberOfRows, totalNumberOfNonzeros};
+  memcpy(header, "HPCGCSR1", 8);
+  memcpy(header+8, dimensions, sizeof(dimensions));
+  WriteProblemFileAt(file, 0, header, writeHeader ? (long long) sizeof(header) : 0);
+
+  const long long rowPointerStart = sizeof(header);
+  const long long columnIndexStart = rowPointerStart + (totalNumberOfRows+1)*sizeof(long long);
+  const long long valueStart = columnIndexStart + totalNumberOfNonzeros*sizeof(long long);
+
+  long long numberOfChunks = (nrow + rowsPerChunk - 1)/rowsPerChunk, maxNumberOfChunks = numberOfChunks;
+#ifndef HPCG_NO_MPI
+  MPI_Allreduce(&numberOfChunks, &maxNumberOfChunks, 1, MPI_LONG_LONG_INT, MPI_MAX, A.geom->comm);
+#endif
+
+  // The process owning the last row also writes the final row pointer entry
+  bool ownsLastRow = (nrow > 0 && rowOffset + nrow == totalNumberOfRows);
+  std::vector<long long> rowPointers, columnIndices;
+  std::vector<double> values;
+  long long nonzerosWritten = nonzerosOffset;
+  for (long long k=0; k<maxNumberOfChunks; ++k) {
+    rowPointers.clear();
+    columnIndices.clear();
+    values.clear();
+    local_int_t firstRow = k*rowsPerChunk;
+    local_int_t lastRow = firstRow + rowsPerChunk < nrow ? firstRow + rowsPerChunk : nrow;
+    for (local_int_t i=firstRow; i<lastRow; ++i) {
+      rowPointers.push_back(nonzerosWritten + columnIndices.size());
+      for (int j=0; j<A.nonzerosInRow[i]; ++j) {
+        columnIndices.push_back(columnIds[A.mtxIndL[i][j]]);
+        values.push_back(A.matrixValues[i][j]);
+      }
+    }
+    if (ownsLastRow && lastRow==nrow && firstRow<lastRow) rowPointers.push_back(totalNumberOfNonzeros);
+
+    long long numberOfNonzeros = columnIndices.size();
+    WriteProblemFileAt(file, rowPointerStart + (rowOffset+firstRow)*sizeof(long long), rowPointers.empty() ? 0 : &rowPointers[0], rowPointers.size()*sizeof(long long));
+    WriteProblemFileAt(file, columnIndexStart + nonzerosWritten*sizeof(long long), columnIndices.empty() ? 0 : &columnIndices[0], numberOfNonzeros*sizeof(long long));
+    WriteProblemFileAt(file, valueStart + nonzerosWritten*sizeof(double), values.empty() ? 0 : &values[0], numberOfNonzeros*sizeof(double));
+    nonzerosWritten += numberOfNonzeros;
+  }
+
+  CloseProblemFile(file);
+  return 0;
+}
+
+/*!
+  Writes the local part of a vector, either as a Matrix Market array file or as a binary vector file.
+*/
+static int WriteVector(const Geometry & geom, const char * fileName, const Vector & v, local_int_t nrow, long long rowOffset, long long totalNumberOfRows,
+    bool writeHeader, int format) {
+
+  ProblemFile file;
+  if (OpenProblemFile(geom, fileName, file)) return -1;
+
+  char line[128];
+  if (format==WRITE_PROBLEM_MATRIX_MARKET) {
+    snprintf(line, sizeof line, "%%%%MatrixMarket matrix array real general\n%lld 1\n", totalNumberOfRows);
+    std::string header(line);
+    std::string block;
+    for (local_int_t i=0; i<nrow; ++i) {
+      int n = snprintf(line, sizeof line, "%22.16e\n", v.values[i]);
+      block.append(line, n);
+    }
+    long long blockOffset = 0, totalLength = 0;
+    ScanOverProcesses(geom, block.size(), blockOffset, totalLength);
+    WriteProblemFileAt(file, 0, header.data(), writeHeader ? (long long) header.size() : 0);
+    WriteProblemFileAt(file, header.size() + blockOffset, block.data(), block.size());
+  } else {
+    memcpy(line, "HPCGVEC1", 8);
+    memcpy(line+8, &totalNumberOfRows, sizeof(long long));
+    const long long headerLength = 8 + sizeof(long long);
+    WriteProblemFileAt(file, 0, line, writeHeader ? headerLength : 0);
+    WriteProblemFileAt(file, headerLength + rowOffset*sizeof(double), v.values, nrow*sizeof(double));
+  }
+
+  CloseProblemFile(file);
+  return 0;
+}
+
+/*!
+  Routine to dump the distributed problem for offline analysis:
+   - the matrix to A.mtx (Matrix Market) or A.bin (binary CSR)
+   - x, xexact, b to x.mtx, xexact.mtx and b.mtx (Matrix Market) or to the corresponding .bin files.
+
+   All processes write their part of each file concurrently through MPI-IO collective writes
+   (plain stdio is used when HPCG is built without MPI).
+
+   Rows are numbered contiguously by process: the rows of process 0 come first in local order, followed
+   by those of process 1, and so on.  On a single process this is the natural ordering of the generated problem;
+   with several processes the files hold the symmetrically permuted system P*A*P', which has the same
+   spectrum and yields the same number of CG iterations.
+
+   Matrix Market files store the lower triangle of the symmetric matrix and can be read into MATLAB with mmread.
+
+   Binary files use the native byte order:
+     - matrix: char[8] "HPCGCSR1", int64 nrows, int64 ncols, int64 nnz, int64 rowPointers[nrows+1],
+       int64 columnIndices[nnz], double values[nnz] (0-based indices, all nonzeros stored)
+     - vector: char[8] "HPCGVEC1", int64 n, double values[n]
 
   @param[in] geom   The description of the problem's geometry.
   @param[in] A      The known system matrix
   @param[in] b      The known right hand side vector
   @param[in] x      The solution vector computed by CG iteration
   @param[in] xexact Generated exact solution
+  @param[in] format WRITE_PROBLEM_MATRIX_MARKET or WRITE_PROBLEM_BINARY_CSR
 
-  @return Returns with -1 if used with more than one MPI process. Returns with 0 otherwise.
+  @return Returns zero on success and -1 if any of the files could not be written.
 
   @see GenerateProblem
 */
 int WriteProblem( const Geometry & geom, const SparseMatrix & A,
-    const Vector b, const Vector x, const Vector xexact) {
-
-  if (geom.size!=1) return -1; //TODO Only works on one processor.  Need better error handler
-  const global_int_t nrow = A.totalNumberOfRows;
-
-  FILE * fA = 0, * fx = 0, * fxexact = 0, * fb = 0;
-  fA = fopen("A.dat", "w");
-  fx = fopen("x.dat", "w");
-  fxexact = fopen("xexact.dat", "w");
-  fb = fopen("b.dat", "w");
-
-  if (! fA || ! fx || ! fxexact || ! fb) {
-    if (fb) fclose(fb);
-    if (fxexact) fclose(fxexact);
-    if (fx) fclose(fx);
-    if (fA) fclose(fA);
-    return -1;
-  }
+    const Vector & b, const Vector & x, const Vector & xexact, int format) {
 
-  for (global_int_t i=0; i< nrow; i++) {
-    const double * const currentRowValues = A.matrixValues[i];
-    const global_int_t * const currentRowIndices = A.mtxIndG[i];
-    const int currentNumberOfNonzeros = A.nonzerosInRow[i];
-    for (int j=0; j< currentNumberOfNonzeros; j++)
-#ifdef HPCG_NO_LONG_LONG
-      fprintf(fA, " %d %d %22.16e\n",i+1,(global_int_t)(currentRowIndices[j]+1),currentRowValues[j]);
-#else
-      fprintf(fA, " %lld %lld %22.16e\n",i+1,(global_int_t)(currentRowIndices[j]+1),currentRowValues[j]);
-#endif
-    fprintf(fx, "%22.16e\n",x.values[i]);
-    fprintf(fxexact, "%22.16e\n",xexact.values[i]);
-    fprintf(fb, "%22.16e\n",b.values[i]);
-  }
+  if (format!=WRITE_PROBLEM_MATRIX_MARKET && format!=WRITE_PROBLEM_BINARY_CSR) return -1;
 
-  fclose(fA);
-  fclose(fx);
-  fclose(fxexact);
-  fclose(fb);
-  return 0;
+  local_int_t nrow = A.localNumberOfRows;
+  long long rowOffset = 0, totalNumberOfRows = 0;
+  ScanOverProcesses(geom, nrow, rowOffset, totalNumberOfRows);
+  bool writeHeader = (geom.rank==0);
+
+  std::vector<long long> columnIds;
+  ComputeExportedColumnIds(A, rowOffset, columnIds);
+
+  bool isMatrixMarket = (format==WRITE_PROBLEM_MATRIX_MARKET);
+  const char * suffix = isMatrixMarket ? ".mtx" : ".bin";
+  int ierr = 0;
+  if (isMatrixMarket)
+    ierr += WriteMatrixMarketMatrix("A.mtx", A, rowOffset, totalNumberOfRows, columnIds, writeHeader);
+  else
+    ierr += WriteBinaryMatrix("A.bin", A, rowOffset, totalNumberOfRows, columnIds, writeHeader);
+  ierr += WriteVector(geom, (std::string("x") + suffix).c_str(), x, nrow, rowOffset, totalNumberOfRows, writeHeader, format);
+  ierr += WriteVector(geom, (std::string("xexact") + suffix).c_str(), xexact, nrow, rowOffset, totalNumberOfRows, writeHeader, format);
+  ierr += WriteVector(geom, (std::string("b") + suffix).c_str(), b, nrow, rowOffset, totalNumberOfRows, writeHeader, format);
+
+  return ierr ? -1 : 0;
 }
@@ -17,5 +17,13 @@
 #include "Geometry.hpp"
 #include "SparseMatrix.hpp"
 
-int WriteProblem( const Geometry & geom, const SparseMatrix & A, const Vector b, const Vector x, const Vector xexact);
+/*!
+  File formats supported by WriteProblem
+ */
+enum WriteProblemFormat {
+  WRITE_PROBLEM_MATRIX_MARKET = 1, //!< Matrix Market coordinate (matrix) and array (vectors) text files
+  WRITE_PROBLEM_BINARY_CSR = 2     //!< Binary compressed sparse row matrix and binary vectors
+};
+
+int WriteProblem( const Geometry & geom, const SparseMatrix & A, const Vector & b, const Vector & x, const Vector & xexact, int format);
 #endif // WRITEPROBLEM_HPP
@@ -15,9 +15,11 @@
 #include <fstream>
 
 #include "hpcg.hpp"
+#include "NodeAllreduce.hpp"
 
 /*!
-  Closes the I/O stream used for logging information throughout the HPCG run.
+  Closes the I/O stream used for logging information throughout the HPCG run and frees the
+  communicators of the node-aware reductions.
 
   @return returns 0 upon success and non-zero otherwise
 
@@ -25,6 +27,7 @@
 */
 int
 HPCG_Finalize(void) {
+  DeleteNodeAllreduce();
   HPCG_fout.close();
   return 0;
 }
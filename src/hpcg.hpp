@@ -27,7 +27,10 @@
 extern std::ofstream HPCG_fout;
 
 struct HPCG_Params_STRUCT {
-  int comm_size; //!< Number of MPI processes in MPI_COMM_WORLD
+#ifndef HPCG_NO_MPI
+  MPI_Comm comm; //!< Communicator of the processes that run the benchmark (MPI_COMM_WORLD unless given to HPCG_Init)
+#endif
+  int comm_size; //!< Number of MPI processes in comm
   int comm_rank; //!< This process' MPI rank in the range [0 to comm_size - 1]
   int numThreads; //!< This process' number of threads
   local_int_t nx; //!< Number of processes in x-direction of 3D process grid
@@ -40,6 +43,16 @@ struct HPCG_Params_STRUCT {
   int pz; //!< Partition in the z processor dimension, default is npz
   local_int_t zl; //!< nz for processors in the z dimension with value less than pz
   local_int_t zu; //!< nz for processors in the z dimension with value greater than pz
+  int writeProblem; //!< File format used to export the generated problem (0 means no export, see WriteProblemFormat)
+  int numberOfRhs; //!< Number of right hand sides for the optional block CG phase (values below 2 skip it)
+  int traceEvents; //!< Capacity of the per-thread trace ring buffers (0 disables tracing)
+  int autotune; //!< Search for the local grid and thread count with the highest GFLOP/s before the run (see Autotune)
+  int memoryCap; //!< Memory budget of each process for the autotuner in MB (0 means half of the node's memory shared by its processes)
+  int nodeAwareMapping; //!< Choose the process grid and the placement of the ranks from their nodes (see ComputeNodeAwareProcessGrid)
+  int transferOperator; //!< Multigrid transfer between the levels: 0 for injection, 1 for full weighting and trilinear interpolation
+  int multigridCycle; //!< Multigrid cycle of the preconditioner: 0 for the V-cycle, 1 for the W-cycle, 2 for the F-cycle (see MGCycle)
+  char matrixFile[256]; //!< Matrix Market or binary CSR file with the matrix to solve instead of the generated problem (empty if none)
+  char rhsFile[256]; //!< Matrix Market or binary file with the right hand side for matrixFile (empty to use A times a vector of ones)
 };
 /*!
   HPCG_Params is a shorthand for HPCG_Params_STRUCT
@@ -47,6 +60,9 @@ struct HPCG_Params_STRUCT {
 typedef HPCG_Params_STRUCT HPCG_Params;
 
 extern int HPCG_Init(int * argc_p, char ** *argv_p, HPCG_Params & params);
+#ifndef HPCG_NO_MPI
+extern int HPCG_Init(int * argc_p, char ** *argv_p, HPCG_Params & params, MPI_Comm comm);
+#endif
 extern int HPCG_Finalize(void);
 
 #endif // HPCG_HPP
@@ -37,6 +37,7 @@ const char* NULLDEVICE="/dev/null";
 #include "hpcg.hpp"
 
 #include "ReadHpcgDat.hpp"
+#include "NodeAllreduce.hpp"
 
 std::ofstream HPCG_fout; //!< output file stream for logging activities during HPCG run
 
@@ -66,11 +67,36 @@ startswith(const char * s, const char * prefix) {
 */
 int
 HPCG_Init(int * argc_p, char ** *argv_p, HPCG_Params & params) {
+#ifndef HPCG_NO_MPI
+  return HPCG_Init(argc_p, argv_p, params, MPI_COMM_WORLD);
+}
+
+/*!
+  Initializes an HPCG run on the processes of a given communicator, so that
+  the benchmark can be run on a subset of the MPI processes or by several
+  independent groups of processes at once. Parameters read from hpcg.dat are
+  broadcast from rank 0 of comm, which also writes the log file. When comm is
+  not MPI_COMM_WORLD the log file names carry the MPI_COMM_WORLD rank so that
+  the groups do not overwrite each other's files.
+
+  @param[in] argc_p the pointer to the "argc" parameter passed to the main() function
+  @param[in] argv_p the pointer to the "argv" parameter passed to the main() function
+  @param[out] params the reference to the data structures that is filled the basic parameters of the run
+  @param[in] comm the communicator of the processes taking part in the run (collective over comm)
+
+  @return returns 0 upon success and non-zero otherwise
+
+  @see HPCG_Finalize
+*/
+int
+HPCG_Init(int * argc_p, char ** *argv_p, HPCG_Params & params, MPI_Comm comm) {
+#endif
   int argc = *argc_p;
   char ** argv = *argv_p;
   char fname[80];
   int i, j, *iparams;
-  char cparams[][7] = {"--nx=", "--ny=", "--nz=", "--rt=", "--pz=", "--zl=", "--zu=", "--npx=", "--npy=", "--npz="};
+  char cparams[][16] = {"--nx=", "--ny=", "--nz=", "--rt=", "--pz=", "--zl=", "--zu=", "--npx=", "--npy=", "--npz=", "--dump=", "--nrhs=",
+    "--trace=", "--tune=", "--mem=", "--nodemap=", "--transfer=", "--cycle="};
   time_t rawtime;
   tm * ptm;
   const int nparams = (sizeof cparams) / (sizeof cparams[0]);
@@ -114,7 +140,7 @@ HPCG_Init(int * argc_p, char ** *argv_p, HPCG_Params & params) {
 // Broadcast values of iparams to all MPI processes
 #ifndef HPCG_NO_MPI
   if (broadcastParams) {
-    MPI_Bcast( iparams, nparams, MPI_INT, 0, MPI_COMM_WORLD );
+    MPI_Bcast( iparams, nparams, MPI_INT, 0, comm );
   }
 #endif
 
@@ -131,9 +157,32 @@ HPCG_Init(int * argc_p, char ** *argv_p, HPCG_Params & params) {
   params.npy = iparams[8];
   params.npz = iparams[9];
 
+  params.writeProblem = iparams[10];
+  params.numberOfRhs = iparams[11];
+  params.traceEvents = (iparams[12]>0) ? iparams[12]*1024 : 0; // Given in thousands of events per thread
+  params.autotune = iparams[13];
+  params.memoryCap = iparams[14];
+  params.nodeAwareMapping = iparams[15];
+  params.transferOperator = iparams[16];
+  params.multigridCycle = (iparams[17]>=0 && iparams[17]<=2) ? iparams[17] : 0; // V-cycle unless a known cycle is chosen
+
+  // File names of a user-supplied problem are only taken from the command line
+  params.matrixFile[0] = params.rhsFile[0] = '\0';
+  for (i = 1; i < argc && argv[i]; ++i) {
+    if (startswith(argv[i], "--matrix=")) {
+      strncpy(params.matrixFile, argv[i]+strlen("--matrix="), sizeof params.matrixFile - 1);
+      params.matrixFile[sizeof params.matrixFile - 1] = '\0';
+    }
+    if (startswith(argv[i], "--rhs=")) {
+      strncpy(params.rhsFile, argv[i]+strlen("--rhs="), sizeof params.rhsFile - 1);
+      params.rhsFile[sizeof params.rhsFile - 1] = '\0';
+    }
+  }
+
 #ifndef HPCG_NO_MPI
-  MPI_Comm_rank( MPI_COMM_WORLD, &params.comm_rank );
-  MPI_Comm_size( MPI_COMM_WORLD, &params.comm_size );
+  params.comm = comm;
+  MPI_Comm_rank( comm, &params.comm_rank );
+  MPI_Comm_size( comm, &params.comm_size );
 #else
   params.comm_rank = 0;
   params.comm_size = 1;
@@ -147,17 +196,33 @@ HPCG_Init(int * argc_p, char ** *argv_p, HPCG_Params & params) {
 #endif
 //  for (i = 0; i < nparams; ++i) std::cout << "rank = "<< params.comm_rank << " iparam["<<i<<"] = " << iparams[i] << "\n";
 
+  // Groups of processes running on derived communicators name their files after the MPI_COMM_WORLD rank
+  int fileRank = params.comm_rank;
+  bool derivedComm = false;
+#ifndef HPCG_NO_MPI
+  int commCompare;
+  MPI_Comm_compare( comm, MPI_COMM_WORLD, &commCompare );
+  if (commCompare != MPI_IDENT && commCompare != MPI_CONGRUENT) {
+    MPI_Comm_rank( MPI_COMM_WORLD, &fileRank );
+    derivedComm = true;
+  }
+#endif
+
   time ( &rawtime );
   ptm = localtime(&rawtime);
-  sprintf( fname, "hpcg%04d%02d%02dT%02d%02d%02d.txt",
-      1900 + ptm->tm_year, ptm->tm_mon+1, ptm->tm_mday, ptm->tm_hour, ptm->tm_min, ptm->tm_sec );
+  if (derivedComm)
+    sprintf( fname, "hpcg%04d%02d%02dT%02d%02d%02d_%d.txt",
+        1900 + ptm->tm_year, ptm->tm_mon+1, ptm->tm_mday, ptm->tm_hour, ptm->tm_min, ptm->tm_sec, fileRank );
+  else
+    sprintf( fname, "hpcg%04d%02d%02dT%02d%02d%02d.txt",
+        1900 + ptm->tm_year, ptm->tm_mon+1, ptm->tm_mday, ptm->tm_hour, ptm->tm_min, ptm->tm_sec );
 
   if (0 == params.comm_rank) {
     HPCG_fout.open(fname);
   } else {
 #if defined(HPCG_DEBUG) || defined(HPCG_DETAILED_DEBUG)
     sprintf( fname, "hpcg%04d%02d%02dT%02d%02d%02d_%d.txt",
-        1900 + ptm->tm_year, ptm->tm_mon+1, ptm->tm_mday, ptm->tm_hour, ptm->tm_min, ptm->tm_sec, params.comm_rank );
+        1900 + ptm->tm_year, ptm->tm_mon+1, ptm->tm_mday, ptm->tm_hour, ptm->tm_min, ptm->tm_sec, fileRank );
     HPCG_fout.open(fname);
 #else
     HPCG_fout.open(NULLDEVICE);
@@ -166,5 +231,7 @@ HPCG_Init(int * argc_p, char ** *argv_p, HPCG_Params & params) {
 
   free( iparams );
 
+  InitializeNodeAllreduce(params); // Shared memory reductions for the dot products (only with HPCG_NODE_ALLREDUCE)
+
   return 0;
 }
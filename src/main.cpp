@@ -37,9 +37,12 @@ using std::endl;
 
 #include "hpcg.hpp"
 
+#include "Autotune.hpp"
 #include "CheckAspectRatio.hpp"
+#include "ComputeNodeAwareProcessGrid.hpp"
 #include "GenerateGeometry.hpp"
 #include "GenerateProblem.hpp"
+#include "ReadProblem.hpp"
 #include "GenerateCoarseProblem.hpp"
 #include "SetupHalo.hpp"
 #include "CheckProblem.hpp"
@@ -47,16 +50,22 @@ using std::endl;
 #include "OptimizeProblem.hpp"
 #include "WriteProblem.hpp"
 #include "ReportResults.hpp"
+#include "StreamBenchmark.hpp"
+#include "PerfCounters.hpp"
+#include "Trace.hpp"
 #include "mytimer.hpp"
 #include "ComputeSPMV_ref.hpp"
 #include "ComputeMG_ref.hpp"
 #include "ComputeResidual.hpp"
 #include "CG.hpp"
 #include "CG_ref.hpp"
+#include "CGMulti.hpp"
 #include "Geometry.hpp"
 #include "SparseMatrix.hpp"
 #include "Vector.hpp"
 #include "CGData.hpp"
+#include "CGMultiData.hpp"
+#include "MultiVector.hpp"
 #include "TestCG.hpp"
 #include "TestSymmetry.hpp"
 #include "TestNorms.hpp"
@@ -80,6 +89,13 @@ int main(int argc, char * argv[]) {
 
   HPCG_Init(&argc, &argv, params);
 
+  if (params.autotune) { // Replace the local grid and thread count by the fastest ones that fit in memory
+    int ierr = Autotune(params);
+    if (ierr) return ierr;
+  }
+
+  if (params.traceEvents>0) InitializeTrace(params.traceEvents); // Timeline of kernel calls, written at the end
+
   // Check if QuickPath option is enabled.
   // If the running time is set to zero, we minimize all paths through the program
   bool quickPath = (params.runningTime==0);
@@ -95,7 +111,7 @@ int main(int argc, char * argv[]) {
     std::cin.get(c);
   }
 #ifndef HPCG_NO_MPI
-  MPI_Barrier(MPI_COMM_WORLD);
+  MPI_Barrier(params.comm);
 #endif
 #endif
 
@@ -118,12 +134,22 @@ int main(int argc, char * argv[]) {
 #endif
 
   // Construct the geometry and linear system
+  bool isProblemFromFile = params.matrixFile[0]!='\0'; // Solve a user-supplied system instead of the generated one
   Geometry * geom = new Geometry;
-  GenerateGeometry(size, rank, params.numThreads, params.pz, params.zl, params.zu, nx, ny, nz, params.npx, params.npy, params.npz, geom);
-
-  ierr = CheckAspectRatio(0.125, geom->npx, geom->npy, geom->npz, "process grid", rank==0);
-  if (ierr)
-    return ierr;
+#ifndef HPCG_NO_MPI
+  geom->comm = params.comm;
+#endif
+  if (!isProblemFromFile) {
+    int npx = params.npx, npy = params.npy, npz = params.npz;
+    int * processRanks = 0; // Lexicographic placement of the ranks unless node-aware mapping is requested
+    if (params.nodeAwareMapping) ComputeNodeAwareProcessGrid(params, nx, ny, nz, npx, npy, npz, processRanks);
+    GenerateGeometry(size, rank, params.numThreads, params.pz, params.zl, params.zu, nx, ny, nz, npx, npy, npz, processRanks, geom);
+    delete [] processRanks;
+
+    ierr = CheckAspectRatio(0.125, geom->npx, geom->npy, geom->npz, "process grid", rank==0);
+    if (ierr)
+      return ierr;
+  }
 
   // Use this array for collecting timing information
   std::vector< double > times(10,0.0);
@@ -134,23 +160,43 @@ int main(int argc, char * argv[]) {
   InitializeSparseMatrix(A, geom);
 
   Vector b, x, xexact;
-  GenerateProblem(A, &b, &x, &xexact);
+  if (isProblemFromFile) {
+    ierr = ReadProblem(params, geom, A, &b, &x, &xexact);
+    if (ierr) {
+      HPCG_Finalize();
+#ifndef HPCG_NO_MPI
+      MPI_Finalize();
+#endif
+      return ierr;
+    }
+  } else {
+    GenerateProblem(A, &b, &x, &xexact);
+  }
   SetupHalo(A);
   int numberOfMgLevels = 4; // Number of levels including first
   SparseMatrix * curLevelMatrix = &A;
   for (int level = 1; level< numberOfMgLevels; ++level) {
     GenerateCoarseProblem(*curLevelMatrix);
+    if (curLevelMatrix->Ac==0) { // Aggregation-based coarsening may stop early
+      numberOfMgLevels = level;
+      break;
+    }
     curLevelMatrix = curLevelMatrix->Ac; // Make the just-constructed coarse grid the next level
   }
 
   setup_time = mytimer() - setup_time; // Capture total time of setup
   times[9] = setup_time; // Save it for reporting
 
+  // Measure the memory bandwidth of the machine for the roofline comparison (not part of the setup time)
+  StreamData stream_data;
+  RunStreamBenchmark(*geom, stream_data);
+
   curLevelMatrix = &A;
   Vector * curb = &b;
   Vector * curx = &x;
   Vector * curxexact = &xexact;
-  for (int level = 0; level< numberOfMgLevels; ++level) {
+  // A matrix read from a file has no generated reference to be checked against
+  for (int level = 0; level< numberOfMgLevels && !isProblemFromFile; ++level) {
      CheckProblem(*curLevelMatrix, curb, curx, curxexact);
      curLevelMatrix = curLevelMatrix->Ac; // Make the nextcoarse grid the next level
      curb = 0; // No vectors after the top level
@@ -159,6 +205,12 @@ int main(int argc, char * argv[]) {
   }
 
 
+  // Export the problem for offline analysis if requested (not part of any timed phase)
+  if (params.writeProblem) {
+    ierr = WriteProblem(*geom, A, b, x, xexact, params.writeProblem);
+    if (ierr && rank==0) HPCG_fout << "Error in call to WriteProblem: " << ierr << ".\n" << endl;
+  }
+
   CGData data;
   InitializeSparseCGData(A, data);
 
@@ -225,6 +277,14 @@ int main(int argc, char * argv[]) {
   if (rank == 0 && err_count) HPCG_fout << err_count << " error(s) in call(s) to reference CG." << endl;
   double refTolerance = normr / normr0;
 
+  // The reference tolerance comes from injection, the optimized runs apply the selected transfer
+  if (params.transferOperator==1)
+    for (SparseMatrix * level = &A; level->mgData!=0; level = level->Ac) GenerateFullWeighting(*level);
+
+  // The reference tolerance comes from the V-cycle, the optimized runs apply the selected multigrid cycle.
+  // The iterations they need to reach it are reported as the iterations to tolerance.
+  for (SparseMatrix * level = &A; level->mgData!=0; level = level->Ac) level->mgData->cycle = (MGCycle) params.multigridCycle;
+
   // Call user-tunable set up function.
   double t7 = mytimer();
   OptimizeProblem(A, data, b, x, xexact);
@@ -234,10 +294,6 @@ int main(int argc, char * argv[]) {
   if (rank==0) HPCG_fout << "Total problem setup time in main (sec) = " << mytimer() - t1 << endl;
 #endif
 
-#ifdef HPCG_DETAILED_DEBUG
-  if (geom->size == 1) WriteProblem(*geom, A, b, x, xexact);
-#endif
-
 
   //////////////////////////////
   // Validation Testing Phase //
@@ -273,6 +329,7 @@ int main(int argc, char * argv[]) {
 
   int optMaxIters = 10*refMaxIters;
   int optNiters = refMaxIters;
+  int toleranceIters = 0; // Iterations to the reference tolerance, not raised to refMaxIters like optNiters
   double opt_worst_time = 0.0;
 
   std::vector< double > opt_times(9,0.0);
@@ -287,6 +344,7 @@ int main(int argc, char * argv[]) {
 
     // pick the largest number of iterations to guarantee convergence
     if (niters > optNiters) optNiters = niters;
+    if (niters > toleranceIters) toleranceIters = niters;
 
     double current_time = opt_times[0] - last_cummulative_time;
     if (current_time > opt_worst_time) opt_worst_time = current_time;
@@ -295,7 +353,7 @@ int main(int argc, char * argv[]) {
 #ifndef HPCG_NO_MPI
 // Get the absolute worst time across all MPI ranks (time in CG can be different)
   double local_opt_worst_time = opt_worst_time;
-  MPI_Allreduce(&local_opt_worst_time, &opt_worst_time, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+  MPI_Allreduce(&local_opt_worst_time, &opt_worst_time, 1, MPI_DOUBLE, MPI_MAX, params.comm);
 #endif
 
 
@@ -331,6 +389,12 @@ int main(int argc, char * argv[]) {
   testnorms_data.samples = numberOfCgSets;
   testnorms_data.values = new double[numberOfCgSets];
 
+  // Per-level multigrid timers report the timed CG sets only
+  for (SparseMatrix * Af = &A; Af->mgData!=0; Af = Af->Ac) ZeroMGDataTimes(*Af->mgData);
+#ifdef HPCG_PERF_COUNTERS
+  InitializePerfCounters();
+  EnablePerfCounters(true); // Count only the timed CG sets
+#endif
   for (int i=0; i< numberOfCgSets; ++i) {
     ZeroVector(x); // Zero out x
     ierr = CG( A, data, b, x, optMaxIters, optTolerance, niters, normr, normr0, &times[0], true);
@@ -338,12 +402,15 @@ int main(int argc, char * argv[]) {
     if (rank==0) HPCG_fout << "Call [" << i << "] Scaled Residual [" << normr/normr0 << "]" << endl;
     testnorms_data.values[i] = normr/normr0; // Record scaled residual from this run
   }
+#ifdef HPCG_PERF_COUNTERS
+  EnablePerfCounters(false);
+#endif
 
   // Compute difference between known exact solution and computed solution
   // All processors are needed here.
 #ifdef HPCG_DEBUG
   double residual = 0;
-  ierr = ComputeResidual(A.localNumberOfRows, x, xexact, residual);
+  ierr = ComputeResidual(*A.geom, A.localNumberOfRows, x, xexact, residual);
   if (ierr) HPCG_fout << "Error in call to compute_residual: " << ierr << ".\n" << endl;
   if (rank==0) HPCG_fout << "Difference between computed and exact  = " << residual << ".\n" << endl;
 #endif
@@ -351,12 +418,48 @@ int main(int argc, char * argv[]) {
   // Test Norm Results
   ierr = TestNorms(testnorms_data);
 
+  //////////////////////////////////
+  // Optional Multiple RHS Phase  //
+  //////////////////////////////////
+
+  // Solve for several right hand sides at once with block CG (not part of the benchmark rating)
+  if (params.numberOfRhs>1) {
+    int numberOfRhs = params.numberOfRhs;
+    CGMultiData multiData;
+    InitializeCGMultiData(A, numberOfRhs, multiData);
+    MultiVector B, X;
+    InitializeMultiVector(B, nrow, numberOfRhs);
+    InitializeMultiVector(X, nrow, numberOfRhs);
+    Vector rhs;
+    InitializeVector(rhs, nrow);
+    SetMultiVectorColumn(b, B, 0);
+    for (int j=1; j<numberOfRhs; ++j) {
+      FillRandomVector(rhs);
+      SetMultiVectorColumn(rhs, B, j);
+    }
+    ZeroMultiVector(X);
+    std::vector< double > multi_times(9,0.0), multi_normr(numberOfRhs), multi_normr0(numberOfRhs);
+    ierr = CGMulti(A, multiData, B, X, optMaxIters, 0.0, niters, &multi_normr[0], &multi_normr0[0], &multi_times[0], true);
+    if (ierr) HPCG_fout << "Error in call to CGMulti: " << ierr << ".\n" << endl;
+    if (rank==0) {
+      HPCG_fout << "Block CG with " << numberOfRhs << " right hand sides: " << niters << " iterations in "
+        << multi_times[0] << " seconds, " << multi_times[0]/numberOfRhs << " seconds per right hand side ("
+        << times[0]/numberOfCgSets << " seconds for one CG solve)" << endl;
+      for (int j=0; j<numberOfRhs; ++j)
+        HPCG_fout << "RHS [" << j << "] Scaled Residual [" << multi_normr[j]/multi_normr0[j] << "]" << endl;
+    }
+    DeleteVector(rhs);
+    DeleteMultiVector(B);
+    DeleteMultiVector(X);
+    DeleteCGMultiData(multiData);
+  }
+
   ////////////////////
   // Report Results //
   ////////////////////
 
   // Report results to YAML file
-  ReportResults(A, numberOfMgLevels, numberOfCgSets, refMaxIters, optMaxIters, &times[0], testcg_data, testsymmetry_data, testnorms_data, global_failure, quickPath);
+  ReportResults(A, numberOfMgLevels, numberOfCgSets, refMaxIters, optMaxIters, toleranceIters, opt_worst_time, &times[0], testcg_data, testsymmetry_data, testnorms_data, stream_data, global_failure, quickPath);
 
   // Clean up
   DeleteMatrix(A); // This delete will recursively delete all coarse grid data
@@ -367,7 +470,13 @@ int main(int argc, char * argv[]) {
   DeleteVector(x_overlap);
   DeleteVector(b_computed);
   delete [] testnorms_data.values;
-
+#ifdef HPCG_PERF_COUNTERS
+  DeletePerfCounters();
+#endif
+  if (params.traceEvents>0) {
+    ierr = WriteTrace("hpcg_trace.json");
+    if (ierr) HPCG_fout << "Error in call to WriteTrace: " << ierr << ".\n" << endl;
+  }
 
 
   HPCG_Finalize();
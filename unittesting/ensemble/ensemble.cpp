@@ -0,0 +1,291 @@
+
+//@HEADER
+// ***************************************************
+//
+// HPCG: High Performance Conjugate Gradient Benchmark
+//
+// Contact:
+// Michael A. Heroux ( maherou@sandia.gov)
+// Jack Dongarra     (dongarra@eecs.utk.edu)
+// Piotr Luszczek    (luszczek@eecs.utk.edu)
+//
+// ***************************************************
+//@HEADER
+
+
+/*!
+ @file ensemble.cpp
+
+ HPCG ensemble driver: runs many independent solves at the same time and reports their throughput
+ */
+
+#ifndef HPCG_NO_MPI
+#include <mpi.h>
+#endif
+
+#ifndef HPCG_NO_OPENMP
+#include <omp.h>
+#endif
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "hpcg.hpp"
+#include "Solver.hpp"
+#include "OutputFile.hpp"
+#include "mytimer.hpp"
+
+static const int ensembleMaxIters = 50; //!< iterations of every solve, as in the timed CG sets of the benchmark
+
+/*!
+  Returns the value at quantile p of sorted samples.
+*/
+static double Quantile(const std::vector<double> & sorted, double p) {
+  size_t index = (size_t) (p*(sorted.size()-1) + 0.5);
+  return sorted[index];
+}
+
+/*!
+  Waits until every instance of the ensemble reaches this point: the thread teams of this process meet at an
+  OpenMP barrier (this is a no-op outside of a parallel region) and one thread waits for the other processes.
+*/
+static void WaitForAllInstances(void) {
+#ifndef HPCG_NO_OPENMP
+  #pragma omp barrier
+  #pragma omp master
+#endif
+  {
+#ifndef HPCG_NO_MPI
+    MPI_Barrier(MPI_COMM_WORLD);
+#endif
+  }
+#ifndef HPCG_NO_OPENMP
+  #pragma omp barrier
+#endif
+  return;
+}
+
+/*!
+  Sets up and optimizes the generated problem of one instance, then times repeated solves of it.  The setup
+  and the solves of all instances are separated by WaitForAllInstances, so that every instance solves while
+  the others do too; it is called twice even if the setup fails.
+
+  @param[in]  params         the parameters of the instance; params.comm holds its processes and params.numThreads its threads
+  @param[in]  numberOfSolves the number of solves to time
+  @param[out] setupTime      the time of the problem setup and optimization
+  @param[out] samples        on exit, the time of every solve (of the slowest process of the instance)
+  @param[out] solvePhaseTime the time from the start of the first solve of all instances to the end of the last one
+
+  @return returns 0 upon success and non-zero otherwise
+*/
+static int RunInstance(const HPCG_Params & params, int numberOfSolves, double & setupTime, std::vector<double> & samples,
+    double & solvePhaseTime) {
+
+  double t0 = mytimer();
+  Solver solver;
+  int ierr = solver.Setup(params);
+  if (ierr==0) ierr = solver.Optimize();
+  setupTime = mytimer() - t0;
+  samples.assign(numberOfSolves, 0.0);
+
+  Vector x;
+  bool hasSolution = (ierr==0);
+  if (hasSolution) InitializeVector(x, solver.GetMatrix().localNumberOfColumns);
+  WaitForAllInstances();
+  double phaseStart = mytimer();
+  for (int i=0; i<numberOfSolves && ierr==0; ++i) {
+    ZeroVector(x);
+#ifndef HPCG_NO_MPI
+    MPI_Barrier(params.comm);
+#endif
+    double t1 = mytimer();
+    int niters = 0;
+    double normr = 0.0, normr0 = 0.0;
+    ierr += solver.Solve(solver.GetRhs(), x, ensembleMaxIters, 0.0, niters, normr, normr0);
+    samples[i] = mytimer() - t1;
+  }
+  WaitForAllInstances();
+  solvePhaseTime = mytimer() - phaseStart;
+#ifndef HPCG_NO_MPI
+  MPI_Allreduce(MPI_IN_PLACE, &samples[0], numberOfSolves, MPI_DOUBLE, MPI_MAX, params.comm);
+  MPI_Allreduce(MPI_IN_PLACE, &setupTime, 1, MPI_DOUBLE, MPI_MAX, params.comm);
+#endif
+
+  if (hasSolution) DeleteVector(x);
+  solver.Teardown();
+  return ierr;
+}
+
+/*!
+  Runs an ensemble of independent HPCG solvers at the same time and reports the aggregate throughput.
+
+  Options (besides the usual --nx, --ny, --nz, --npx, ...): --instances=<n> solvers (default one per process)
+  and --solves=<n> solves per instance (default 10), each of 50 preconditioned CG iterations.  With at most as
+  many instances as processes, MPI_COMM_WORLD is split into contiguous groups of processes, one per instance.
+  With more instances than processes, every process runs its share of them in OpenMP thread teams, each
+  instance with its own communicator (MPI_THREAD_MULTIPLE is required for this with MPI).  Every instance
+  generates and optimizes its own problem.  Results are written to HPCG-Ensemble_3.0_<date>.txt and to
+  standard output.
+*/
+int main(int argc, char * argv[]) {
+
+  int worldSize = 1, worldRank = 0;
+#ifndef HPCG_NO_MPI
+  int threadSupport = MPI_THREAD_SINGLE;
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &threadSupport);
+  MPI_Comm_size(MPI_COMM_WORLD, &worldSize);
+  MPI_Comm_rank(MPI_COMM_WORLD, &worldRank);
+#endif
+
+  int numberOfInstances = worldSize, numberOfSolves = 10;
+  for (int i=1; i<argc; ++i) {
+    if (strncmp(argv[i], "--instances=", 12)==0) numberOfInstances = std::max(1, atoi(argv[i]+12));
+    if (strncmp(argv[i], "--solves=", 9)==0) numberOfSolves = std::max(1, atoi(argv[i]+9));
+  }
+
+  // Thread teams are only used when there are more instances than processes
+  int numberOfTeams = 1;
+  if (numberOfInstances>worldSize) {
+    numberOfTeams = numberOfInstances/worldSize + (worldRank < numberOfInstances%worldSize ? 1 : 0);
+#ifdef HPCG_NO_OPENMP
+    numberOfTeams = 1;
+#endif
+#ifndef HPCG_NO_MPI
+    if (threadSupport<MPI_THREAD_MULTIPLE) numberOfTeams = 1;
+#endif
+  }
+
+  HPCG_Params params;
+#ifndef HPCG_NO_MPI
+  // One group of processes per instance; with thread teams every process is a group on its own
+  MPI_Comm instanceComm;
+  int color = numberOfTeams>1 ? worldRank : (int) (((long long) worldRank*numberOfInstances)/worldSize);
+  MPI_Comm_split(MPI_COMM_WORLD, color, worldRank, &instanceComm);
+  HPCG_Init(&argc, &argv, params, instanceComm);
+  std::vector<MPI_Comm> teamComms(numberOfTeams, instanceComm);
+  if (numberOfTeams>1)
+    for (int team=0; team<numberOfTeams; ++team) MPI_Comm_dup(instanceComm, &teamComms[team]);
+#else
+  HPCG_Init(&argc, &argv, params);
+#endif
+  int threadsPerTeam = std::max(1, params.numThreads/numberOfTeams);
+
+  std::vector<double> setupTimes(numberOfTeams, 0.0), solvePhaseTimes(numberOfTeams, 0.0);
+  std::vector< std::vector<double> > samples(numberOfTeams);
+  std::vector<int> errors(numberOfTeams, 0);
+  if (numberOfTeams==1) {
+    errors[0] = RunInstance(params, numberOfSolves, setupTimes[0], samples[0], solvePhaseTimes[0]);
+  } else {
+#ifndef HPCG_NO_OPENMP
+    // The log stream is shared by the teams and is not thread safe, so detach it while they run
+    std::streambuf * logBuffer = HPCG_fout.std::ios::rdbuf(0);
+    omp_set_max_active_levels(2);
+    #pragma omp parallel num_threads(numberOfTeams)
+    {
+      int team = omp_get_thread_num();
+      HPCG_Params teamParams = params;
+#ifndef HPCG_NO_MPI
+      teamParams.comm = teamComms[team];
+#endif
+      teamParams.numThreads = threadsPerTeam;
+      omp_set_num_threads(threadsPerTeam);
+      errors[team] = RunInstance(teamParams, numberOfSolves, setupTimes[team], samples[team], solvePhaseTimes[team]);
+    }
+    HPCG_fout.std::ios::rdbuf(logBuffer);
+#endif
+  }
+
+  // Every instance contributes one record from its first process: its process count, setup time and solve times
+  const int recordLength = 2 + numberOfSolves;
+  std::vector<double> records;
+  int localErrors = 0;
+  double solvePhaseTime = 0.0;
+  for (int team=0; team<numberOfTeams; ++team) {
+    localErrors += errors[team];
+    solvePhaseTime = std::max(solvePhaseTime, solvePhaseTimes[team]);
+    if (params.comm_rank!=0) continue;
+    records.push_back(params.comm_size);
+    records.push_back(setupTimes[team]);
+    records.insert(records.end(), samples[team].begin(), samples[team].end());
+  }
+  int totalErrors = localErrors;
+  std::vector<double> allRecords(records);
+#ifndef HPCG_NO_MPI
+  MPI_Allreduce(&localErrors, &totalErrors, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+  MPI_Allreduce(MPI_IN_PLACE, &solvePhaseTime, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+  int localLength = records.size();
+  std::vector<int> lengths(worldSize), offsets(worldSize+1, 0);
+  MPI_Gather(&localLength, 1, MPI_INT, &lengths[0], 1, MPI_INT, 0, MPI_COMM_WORLD);
+  for (int i=0; i<worldSize; ++i) offsets[i+1] = offsets[i] + lengths[i];
+  allRecords.resize(worldRank==0 ? offsets[worldSize] : 0);
+  MPI_Gatherv(records.empty() ? 0 : &records[0], localLength, MPI_DOUBLE, allRecords.empty() ? 0 : &allRecords[0],
+      &lengths[0], &offsets[0], MPI_DOUBLE, 0, MPI_COMM_WORLD);
+#endif
+
+  if (worldRank==0) {
+    int numberOfRecords = allRecords.size()/recordLength;
+    std::vector<double> latencies;
+    double maxSetupTime = 0.0;
+    for (int i=0; i<numberOfRecords; ++i) {
+      maxSetupTime = std::max(maxSetupTime, allRecords[i*recordLength+1]);
+      latencies.insert(latencies.end(), allRecords.begin()+i*recordLength+2, allRecords.begin()+(i+1)*recordLength);
+    }
+    std::sort(latencies.begin(), latencies.end());
+    double mean = 0.0;
+    for (size_t i=0; i<latencies.size(); ++i) mean += latencies[i];
+    mean /= latencies.size();
+
+    OutputFile doc("HPCG-Ensemble", "3.0");
+    doc.add("Distributed Processes",worldSize);
+    doc.add("Threads per processes",params.numThreads);
+    doc.add("Local nx",(int) params.nx);
+    doc.add("Local ny",(int) params.ny);
+    doc.add("Local nz",(int) params.nz);
+    doc.add("Instances",numberOfRecords);
+    doc.add("Thread teams per process",numberOfTeams);
+    doc.add("Threads per instance process",numberOfTeams>1 ? threadsPerTeam : params.numThreads);
+    doc.add("Solves per instance",numberOfSolves);
+    doc.add("Iterations per solve",ensembleMaxIters);
+    doc.add("Throughput","");
+    doc.get("Throughput")->add("Solves per second",latencies.size()/solvePhaseTime);
+    doc.get("Throughput")->add("Solve phase time (sec)",solvePhaseTime);
+    doc.get("Throughput")->add("Max setup time (sec)",maxSetupTime);
+    doc.add("Latency","");
+    OutputFile * latency = doc.get("Latency");
+    latency->add("Min time (sec)",latencies[0]);
+    latency->add("P10 time (sec)",Quantile(latencies, 0.10));
+    latency->add("Median time (sec)",Quantile(latencies, 0.5));
+    latency->add("P90 time (sec)",Quantile(latencies, 0.90));
+    latency->add("P99 time (sec)",Quantile(latencies, 0.99));
+    latency->add("Max time (sec)",latencies[latencies.size()-1]);
+    latency->add("Mean time (sec)",mean);
+    doc.add("Instance Latency","");
+    for (int i=0; i<numberOfRecords; ++i) {
+      std::vector<double> instanceSamples(allRecords.begin()+i*recordLength+2, allRecords.begin()+(i+1)*recordLength);
+      std::sort(instanceSamples.begin(), instanceSamples.end());
+      std::ostringstream name;
+      name << "Instance " << i;
+      doc.get("Instance Latency")->add(name.str(),"");
+      OutputFile * entry = doc.get("Instance Latency")->get(name.str());
+      entry->add("Processes",(int) allRecords[i*recordLength]);
+      entry->add("Min time (sec)",instanceSamples[0]);
+      entry->add("Median time (sec)",Quantile(instanceSamples, 0.5));
+      entry->add("Max time (sec)",instanceSamples[numberOfSolves-1]);
+    }
+    if (totalErrors) doc.add("Solver errors",totalErrors);
+    std::cout << doc.generate();
+  }
+
+  HPCG_Finalize();
+#ifndef HPCG_NO_MPI
+  if (numberOfTeams>1)
+    for (int team=0; team<numberOfTeams; ++team) MPI_Comm_free(&teamComms[team]);
+  MPI_Comm_free(&instanceComm);
+  MPI_Finalize();
+#endif
+  return totalErrors!=0;
+}
@@ -0,0 +1,282 @@
+
+//@HEADER
+// ***************************************************
+//
+// HPCG: High Performance Conjugate Gradient Benchmark
+//
+// Contact:
+// Michael A. Heroux ( maherou@sandia.gov)
+// Jack Dongarra     (dongarra@eecs.utk.edu)
+// Piotr Luszczek    (luszczek@eecs.utk.edu)
+//
+// ***************************************************
+//@HEADER
+
+
+/*!
+ @file kbench.cpp
+
+ HPCG kernel microbenchmark: times each kernel in isolation on the generated problem
+ */
+
+#ifndef HPCG_NO_MPI
+#include <mpi.h>
+#endif
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "hpcg.hpp"
+#include "Solver.hpp"
+#include "OutputFile.hpp"
+#include "mytimer.hpp"
+#include "ComputeSPMV.hpp"
+#include "ComputeSYMGS.hpp"
+#include "ComputeMG.hpp"
+#include "ComputeWAXPBY.hpp"
+#include "ComputeDotProduct.hpp"
+#include "ComputeRestriction_ref.hpp"
+#include "ComputeProlongation_ref.hpp"
+#include "ExchangeHalo.hpp"
+
+enum Kernel { SPMV, SYMGS, MG, WAXPBY, DDOT, HALO, RESTRICTION, PROLONGATION, CG_ITERATION, FORK_JOIN, NUMBER_OF_KERNELS };
+static const char * kernelNames[NUMBER_OF_KERNELS] = {"ComputeSPMV", "ComputeSYMGS", "ComputeMG", "ComputeWAXPBY",
+  "ComputeDotProduct", "ExchangeHalo", "ComputeRestriction_ref", "ComputeProlongation_ref", "CG iteration", "OpenMP fork/join"};
+
+static const int numberOfWarmupCalls = 2;
+
+/*!
+  Calls one kernel once.  The CG iteration is a call of CG with one preconditioned iteration (including the
+  initial residual); the fork/join is an empty OpenMP parallel region, the overhead that every kernel with a
+  parallel region of its own pays and that HPCG_PERSISTENT_REGION pays once per CG call.
+
+  @return returns 0 upon success and non-zero otherwise
+*/
+static int RunKernel(int kernel, Solver & solver, Vector & x, Vector & y, Vector & w) {
+  const SparseMatrix & A = solver.GetMatrix();
+  bool isOptimized = true;
+  double result = 0.0, time_allreduce = 0.0;
+  int niters = 0;
+  double normr = 0.0, normr0 = 0.0;
+  switch (kernel) {
+    case SPMV: return ComputeSPMV(A, x, y);
+    case SYMGS: return ComputeSYMGS(A, y, x);
+    case MG: return ComputeMG(A, y, x);
+    case WAXPBY: return ComputeWAXPBY(A.localNumberOfRows, 1.0, x, 0.5, y, w, isOptimized);
+    case DDOT: return ComputeDotProduct(*A.geom, A.localNumberOfRows, x, y, result, time_allreduce, isOptimized);
+#ifndef HPCG_NO_MPI
+    case HALO: ExchangeHalo(A, x); return 0;
+#endif
+    case RESTRICTION: return ComputeRestriction_ref(A, y);
+    case PROLONGATION: return ComputeProlongation_ref(A, x);
+    case CG_ITERATION: return solver.Solve(solver.GetRhs(), x, 1, 0.0, niters, normr, normr0);
+    case FORK_JOIN:
+#ifndef HPCG_NO_OPENMP
+      #pragma omp parallel
+      {
+      }
+#endif
+      return 0;
+  }
+  return 0;
+}
+
+/*!
+  Modeled floating point operations and memory traffic of one call, summed over all processes.
+  The counts follow the models in ReportResults.
+*/
+static void KernelModel(int kernel, const SparseMatrix & A, int numberOfMgLevels, double & flops, double & bytes) {
+  double fnrow = A.totalNumberOfRows;
+  double fnnz = A.totalNumberOfNonzeros;
+  double fnrowc = (A.Ac!=0) ? A.Ac->totalNumberOfRows : 0.0;
+  double fntransfer = (A.mgData!=0 && A.mgData->f2cOffsets!=0) ? fnrow : fnrowc;
+  flops = bytes = 0.0;
+  switch (kernel) {
+    case SPMV:
+      flops = 2.0*fnnz;
+      bytes = fnnz*(sizeof(double)+sizeof(local_int_t)) + 2.0*fnrow*sizeof(double);
+      break;
+    case SYMGS:
+      flops = 4.0*fnnz;
+      bytes = 2.0*fnnz*(sizeof(double)+sizeof(local_int_t)) + 2.0*fnrow*sizeof(double);
+      break;
+    case MG: {
+      const SparseMatrix * Af = &A;
+      for (int i=1; i<numberOfMgLevels; ++i) {
+        double fnnz_Af = Af->totalNumberOfNonzeros;
+        double fnrow_Af = Af->totalNumberOfRows;
+        double fnumberOfSweeps = Af->mgData->numberOfPresmootherSteps + Af->mgData->numberOfPostsmootherSteps;
+        flops += fnumberOfSweeps*4.0*fnnz_Af + 2.0*fnnz_Af;
+        bytes += fnumberOfSweeps*(2.0*fnnz_Af*(sizeof(double)+sizeof(local_int_t)) + 2.0*fnrow_Af*sizeof(double));
+        bytes += fnnz_Af*(sizeof(double)+sizeof(local_int_t)) + 2.0*fnrow_Af*sizeof(double);
+        Af = Af->Ac;
+      }
+      flops += 4.0*Af->totalNumberOfNonzeros;
+      bytes += 2.0*Af->totalNumberOfNonzeros*(sizeof(double)+sizeof(local_int_t)) + 2.0*Af->totalNumberOfRows*sizeof(double);
+      break;
+    }
+    case WAXPBY:
+      flops = 2.0*fnrow;
+      bytes = 3.0*fnrow*sizeof(double);
+      break;
+    case DDOT:
+      flops = 2.0*fnrow;
+      bytes = 2.0*fnrow*sizeof(double);
+      break;
+    case HALO: {
+#ifndef HPCG_NO_MPI
+      double sent = A.totalToBeSent;
+      MPI_Allreduce(MPI_IN_PLACE, &sent, 1, MPI_DOUBLE, MPI_SUM, A.geom->comm);
+      bytes = 2.0*sent*sizeof(double); // Every value sent is also received
+#endif
+      break;
+    }
+    case RESTRICTION:
+      flops = fntransfer;
+      bytes = fntransfer*(2.0*sizeof(double)+sizeof(local_int_t)) + fnrowc*sizeof(double);
+      break;
+    case PROLONGATION:
+      flops = fntransfer;
+      bytes = fnrowc*sizeof(double) + fntransfer*(2.0*sizeof(double)+sizeof(local_int_t));
+      break;
+    case CG_ITERATION: { // Two SpMVs, one V-cycle, four WAXPBYs and four dot products
+      const int parts[] = {SPMV, SPMV, MG, WAXPBY, WAXPBY, WAXPBY, WAXPBY, DDOT, DDOT, DDOT, DDOT};
+      for (size_t i=0; i<sizeof(parts)/sizeof(parts[0]); ++i) {
+        double partFlops, partBytes;
+        KernelModel(parts[i], A, numberOfMgLevels, partFlops, partBytes);
+        flops += partFlops;
+        bytes += partBytes;
+      }
+      break;
+    }
+    case FORK_JOIN:
+      break;
+  }
+  return;
+}
+
+/*!
+  Returns the p-th quantile (0 <= p <= 1) of sorted samples.
+*/
+static double Quantile(const std::vector<double> & sorted, double p) {
+  size_t index = (size_t) (p*(sorted.size()-1) + 0.5);
+  return sorted[index];
+}
+
+/*!
+  Benchmarks the HPCG kernels on the finest level of the generated problem.
+
+  Options (besides the usual --nx, --ny, --nz, --npx, ...): --reps=<n> calls per kernel (default 100).
+  Every call is timed separately; with MPI, all processes start each call together and the slowest
+  process defines its time. Results are written to HPCG-KBench_3.0_<date>.txt and to standard output.
+*/
+int main(int argc, char * argv[]) {
+
+#ifndef HPCG_NO_MPI
+  MPI_Init(&argc, &argv);
+#endif
+
+  HPCG_Params params;
+  HPCG_Init(&argc, &argv, params);
+
+  int numberOfReps = 100;
+  for (int i=1; i<argc; ++i)
+    if (strncmp(argv[i], "--reps=", 7)==0) numberOfReps = std::max(1, atoi(argv[i]+7));
+
+  Solver solver;
+  int ierr = solver.Setup(params);
+  if (ierr==0) ierr = solver.Optimize();
+  if (ierr) {
+    if (params.comm_rank==0) std::cerr << "Problem setup failed: " << ierr << std::endl;
+    HPCG_Finalize();
+#ifndef HPCG_NO_MPI
+    MPI_Finalize();
+#endif
+    return ierr;
+  }
+  const SparseMatrix & A = solver.GetMatrix();
+  int numberOfMgLevels = solver.GetNumberOfMgLevels();
+
+  Vector x, y, w;
+  InitializeVector(x, A.localNumberOfColumns);
+  InitializeVector(y, A.localNumberOfColumns);
+  InitializeVector(w, A.localNumberOfColumns);
+  FillRandomVector(x);
+  FillRandomVector(y);
+
+  OutputFile doc("HPCG-KBench", "3.0");
+  doc.add("Distributed Processes",params.comm_size);
+  doc.add("Threads per processes",params.numThreads);
+  doc.add("Local nx",(int) params.nx);
+  doc.add("Local ny",(int) params.ny);
+  doc.add("Local nz",(int) params.nz);
+  doc.add("Number of Equations",(long long) A.totalNumberOfRows);
+  doc.add("Number of Nonzero Terms",(long long) A.totalNumberOfNonzeros);
+  doc.add("Calls per kernel",numberOfReps);
+  doc.add("Kernels","");
+
+  std::vector<double> samples(numberOfReps);
+  for (int kernel=0; kernel<NUMBER_OF_KERNELS; ++kernel) {
+#ifdef HPCG_NO_MPI
+    if (kernel==HALO) continue;
+#endif
+#ifdef HPCG_NO_OPENMP
+    if (kernel==FORK_JOIN) continue;
+#endif
+    if ((kernel==RESTRICTION || kernel==PROLONGATION) && A.mgData==0) continue;
+    if (kernel==RESTRICTION || kernel==PROLONGATION) ComputeSPMV(A, x, *A.mgData->Axf); // Residual needed by the restriction
+
+    for (int i=0; i<numberOfWarmupCalls; ++i) ierr += RunKernel(kernel, solver, x, y, w);
+    for (int i=0; i<numberOfReps; ++i) {
+#ifndef HPCG_NO_MPI
+      MPI_Barrier(A.geom->comm);
+#endif
+      double t0 = mytimer();
+      ierr += RunKernel(kernel, solver, x, y, w);
+      samples[i] = mytimer() - t0;
+    }
+#ifndef HPCG_NO_MPI
+    MPI_Allreduce(MPI_IN_PLACE, &samples[0], numberOfReps, MPI_DOUBLE, MPI_MAX, A.geom->comm);
+#endif
+    std::sort(samples.begin(), samples.end());
+    double mean = 0.0;
+    for (int i=0; i<numberOfReps; ++i) mean += samples[i];
+    mean /= numberOfReps;
+    double flops, bytes;
+    KernelModel(kernel, A, numberOfMgLevels, flops, bytes);
+    double median = Quantile(samples, 0.5);
+
+    OutputFile * kernels = doc.get("Kernels");
+    kernels->add(kernelNames[kernel],"");
+    OutputFile * entry = kernels->get(kernelNames[kernel]);
+    entry->add("Min time (sec)",samples[0]);
+    entry->add("P10 time (sec)",Quantile(samples, 0.10));
+    entry->add("Median time (sec)",median);
+    entry->add("P90 time (sec)",Quantile(samples, 0.90));
+    entry->add("P99 time (sec)",Quantile(samples, 0.99));
+    entry->add("Max time (sec)",samples[numberOfReps-1]);
+    entry->add("Mean time (sec)",mean);
+    if (kernel!=FORK_JOIN) {
+      entry->add("GB/s at median",bytes/median/1.0E9);
+      entry->add("GFLOP/s at median",flops/median/1.0E9);
+    }
+  }
+  if (ierr) doc.add("Kernel errors",ierr);
+
+  if (params.comm_rank==0) std::cout << doc.generate();
+
+  DeleteVector(x);
+  DeleteVector(y);
+  DeleteVector(w);
+  solver.Teardown();
+
+  HPCG_Finalize();
+#ifndef HPCG_NO_MPI
+  MPI_Finalize();
+#endif
+  return ierr!=0;
+}